@@ -1,20 +1,68 @@
 #include "stdafx.h"
 
 extern "C" DLL_PUBLIC bool API_Initialize(void) {
-	// When Plugin gets loaded
+	// When Plugin gets loaded, register the EventBus handlers here
 	API::Server::PrintMessage(L"Initialized");
+	EntityManager::Initialize();
+	EventBus::Subscribe<PlayerCommandEvent>(CommandRouter::OnPlayerCommand, nullptr, 0, "CommandRouter");
+	// To drop spam and banned words, configure SpamDetector and ChatFilter, then subscribe the filter:
+	// EventBus::Subscribe<PlayerMessageEvent>(ChatFilter::OnPlayerMessage, nullptr, 100, "ChatFilter");
 	return true;
 }
 
 extern "C" DLL_PUBLIC bool API_Close(void) {
-	// When plugin gets unloaded
+	// When plugin gets unloaded, the handlers may still save player state so the pools and stores are up
+	EventBus::Dispatch(CloseEvent());
+
+	// Profile reads and saves in flight finish and the dirty records are written before the workers stop and the store closes
+	ProfileStore::Close();
+	WriteBehindCache::FlushAll();
+	WorkerPool::Stop();
+	LogStore::Close();
+	Parallel::Stop();
+	EventBus::Clear();
+	TaskScheduler::Clear();
+	TimerWheel::Clear();
+	SystemScheduler::Clear();
+	CommandBuffer::Replay();
+	OutboundQueue::Clear();
+	JoinPipeline::Clear();
+
+	EntityPool::Clear();
+	EntityManager::Shutdown();
 	API::Server::PrintMessage(L"Closed");
 	return true;
 }
 
 extern "C" DLL_PUBLIC bool API_OnTick(void) {
-	// Every server tick this gets called
+	// Every server tick this gets called, the clock goes first so everything below sees this tick's delta time
+	TickClock::Tick();
 	API::Server::PrintMessage(L"Tick");
+
+	// Results of worker jobs come first, then expired timers, then the tick handlers and the registered systems
+	WorkerPool::Drain();
+	ProfileStore::Poll();
+	TimerWheel::Tick();
+	EventBus::Dispatch(TickEvent());
+	SystemScheduler::Tick();
+
+	// Setup of the players that joined, then the coroutine tasks, each within its own budget
+	JoinPipeline::Tick();
+	TaskScheduler::Tick();
+
+	// API calls recorded on other threads (and by the tick thread through the buffers) during this tick
+	CommandBuffer::Replay();
+
+	// Per player messages go out as their channels' token buckets allow
+	OutboundQueue::Drain();
+
+	// One small batch of the player records changed this tick and before goes to the log store on a worker
+	WriteBehindCache::Tick();
+
+	// Collect abandoned vehicles, evict idle pooled entities and destroy the entities released by handles during this tick
+	VehicleCollector::Tick();
+	EntityPool::Tick();
+	EntityManager::Flush();
 	return true;
 }
 
@@ -22,6 +70,15 @@ extern "C" DLL_PUBLIC bool API_OnPlayerConnecting(const std::string guid)
 {
 	// When a player connects (still loading everything from the server)	
 	API::Server::PrintMessage(L"Connecting");
+
+	// Start loading the saved profile now, it is usually ready by the time the player is connected.
+	// Unclaimed profiles (players that drop or never get paired with their guid) expire in ProfileStore::Poll.
+	JoinPipeline::OnConnecting(guid);
+	ProfileStore::Prefetch(guid);
+
+	PlayerConnectingEvent event;
+	event.Guid = ToRef(guid);
+	EventBus::Dispatch(event);
 	return true;
 }
 
@@ -29,6 +86,20 @@ extern "C" DLL_PUBLIC bool API_OnPlayerConnected(int entity)
 {
 	// When the player is successfully connected (loaded in, but not spawned yet)
 	API::Server::PrintMessage(L"Connected");
+
+	// Keeps the vehicles around the player alive and makes it findable by name in commands,
+	// remove the player again when it disconnects
+	VehicleCollector::AddPlayer(entity);
+	CommandRouter::AddPlayer(entity);
+
+	// The per player setup runs from API_OnTick, PlayerReadyEvent follows once it is done.
+	// The server gives no guid here, so the player is only linked to its guid (and prefetched profile) while no
+	// one else is connecting. Pass the guid as second argument if the plugin can tell it, e.g. during a connection storm.
+	JoinPipeline::OnConnected(entity);
+
+	PlayerConnectedEvent event;
+	event.Entity = entity;
+	EventBus::Dispatch(event);
 	return true;
 }
 
@@ -36,22 +107,42 @@ extern "C" DLL_PUBLIC bool API_OnPlayerConnected(int entity)
 extern "C" DLL_PUBLIC void API_OnEntityEnterCheckpoint(int checkpoint, int entity)
 {
 	API::Server::PrintMessage(L"OnEntityEnterCheckpoint");
+
+	EntityEnterCheckpointEvent event;
+	event.Checkpoint = checkpoint;
+	event.Entity = entity;
+	EventBus::Dispatch(event);
 }
 
 // When a entity exits a checkpoint (only players right now)
 extern "C" DLL_PUBLIC void API_OnEntityExitCheckpoint(int checkpoint, int entity)
 {
 	API::Server::PrintMessage(L"OnEntityExitCheckpoint");
+
+	EntityExitCheckpointEvent event;
+	event.Checkpoint = checkpoint;
+	event.Entity = entity;
+	EventBus::Dispatch(event);
 }
 
 // When a player sends a command
 extern "C" DLL_PUBLIC void API_OnPlayerCommand(const int entity, const std::string message)
 {
 	API::Server::PrintMessage(L"OnPlayerCommand");
+
+	PlayerCommandEvent event;
+	event.Entity = entity;
+	event.Message = ToRef(message);
+	EventBus::Dispatch(event);
 }
 
 // When a player sends a message
 extern "C" DLL_PUBLIC void API_OnPlayerMessage(const int entity, const std::string message)
 {
 	API::Server::PrintMessage(L"OnPlayerMessage");
+
+	PlayerMessageEvent event;
+	event.Entity = entity;
+	event.Message = ToRef(message);
+	EventBus::Dispatch(event);
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+/**
+File:
+	ParallelCheck.cpp
+	Checks that Parallel loops cover every index exactly once and that Reduce combines every chunk,
+	then times the fork/join of a small loop with spinning and with sleeping helpers. Built and run by "make check".
+*/
+
+#include "../stdafx.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	size_t Failures = 0;
+
+	void Expect(const bool condition, const char *what, const size_t count)
+	{
+		if (!condition && Failures++ < 10)
+			printf("FAIL %s (count %zu)\n", what, count);
+	}
+
+	void CheckCoverage(const size_t count, const size_t grain)
+	{
+		std::vector<std::atomic<uint32_t>> visits(count);
+		Parallel::For(count, [&visits](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				visits[i].fetch_add(1, std::memory_order_relaxed);
+		}, grain);
+
+		bool once = true;
+		for (size_t i = 0; i < count; i++)
+			once = once && visits[i].load() == 1;
+		Expect(once, "For visits every index once", count);
+
+		const uint64_t sum = Parallel::Reduce<uint64_t>(count, 0, [](const size_t begin, const size_t end)
+		{
+			uint64_t partial = 0;
+			for (size_t i = begin; i < end; i++)
+				partial += i;
+			return partial;
+		}, [](const uint64_t a, const uint64_t b) { return a + b; }, grain);
+		Expect(sum == (uint64_t)count * (count - (count ? 1 : 0)) / 2, "Reduce sum", count);
+	}
+
+	// Median fork/join time of a loop over a few indices, each index sized so that every participant gets work
+	double MeasureForkJoin(const size_t runs, const std::chrono::microseconds pause)
+	{
+		std::vector<double> samples;
+		const size_t count = Parallel::GetSlotCount() * 4;
+		std::vector<uint64_t> sink(count);
+		for (size_t run = 0; run < runs; run++)
+		{
+			if (pause.count())
+				std::this_thread::sleep_for(pause);
+
+			const Clock::time_point start = Clock::now();
+			Parallel::For(count, [&sink](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					sink[i]++;
+			}, 1);
+			samples.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / 1000.0);
+		}
+
+		std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+		return samples[samples.size() / 2];
+	}
+}
+
+// Optional argument: the number of helper threads, one less than the hardware threads by default
+int main(int argc, char **argv)
+{
+	Parallel::Start(argc > 1 ? (size_t)atoi(argv[1]) : 0);
+	const size_t counts[] = { 0, 1, 7, 255, 256, 1000, 4096, 100003 };
+	const size_t grains[] = { 0, 1, 64 };
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+	{
+		for (size_t j = 0; j < sizeof(grains) / sizeof(grains[0]); j++)
+		{
+			// Twice, the second run of a body picks its grain from the measured cost
+			CheckCoverage(counts[i], grains[j]);
+			CheckCoverage(counts[i], grains[j]);
+		}
+	}
+
+	ParallelStats stats = Parallel::GetStats();
+	printf("checked coverage and reduce, %zu failures (%zu helpers, %llu parallel runs, %llu serial runs, %llu steals)\n\n",
+		Failures, stats.Threads, (unsigned long long)stats.Runs, (unsigned long long)stats.SerialRuns, (unsigned long long)stats.Steals);
+
+	printf("fork/join of %zu indices over %zu participants, median\n", Parallel::GetSlotCount() * 4, Parallel::GetSlotCount());
+	Parallel::SetSpinMicroseconds(200);
+	printf("  back to back, spinning helpers   %8.2f us\n", MeasureForkJoin(20000, std::chrono::microseconds(0)));
+	Parallel::SetSpinMicroseconds(0);
+	printf("  1 ms apart, sleeping helpers     %8.2f us\n", MeasureForkJoin(500, std::chrono::microseconds(1000)));
+
+	// With the WorkerPool running the helpers do not spin by default
+	Parallel::SetSpinMicroseconds(0xFFFFFFFFu);
+	WorkerPool::Start();
+	printf("  back to back, WorkerPool running %8.2f us\n", MeasureForkJoin(2000, std::chrono::microseconds(0)));
+	WorkerPool::Stop();
+
+	// A cheap body is timed once and then runs on the calling thread
+	std::vector<float> values(2000, 1.0f);
+	const uint64_t serialBefore = Parallel::GetStats().SerialRuns;
+	for (size_t run = 0; run < 10; run++)
+		Parallel::For(values.size(), [&values](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				values[i] *= 1.0001f;
+		});
+	printf("\ncheap %zu index loop: %llu of 10 runs serial\n", values.size(), (unsigned long long)(Parallel::GetStats().SerialRuns - serialBefore));
+
+	Parallel::Stop();
+	return Failures ? 1 : 0;
+}
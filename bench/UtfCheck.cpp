@@ -0,0 +1,315 @@
+/**
+File:
+	UtfCheck.cpp
+	Checks the Utf transcoders against a plain scalar reference on random and invalid input,
+	then measures their throughput on chat sized and CEF sized strings. Built and run by "make check".
+*/
+
+#include "../stdafx.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+	const char32_t Replacement = 0xFFFD;
+
+	// One code point at a time, no fast paths, same replacement policy as Utf (one U+FFFD per bad byte)
+	size_t ReferenceDecode(const uint8_t *s, const size_t available, char32_t &codepoint)
+	{
+		size_t length;
+		char32_t minimum;
+		if (s[0] < 0x80)
+		{
+			codepoint = s[0];
+			return 1;
+		}
+		if ((s[0] & 0xE0) == 0xC0) { length = 2; minimum = 0x80; codepoint = s[0] & 0x1F; }
+		else if ((s[0] & 0xF0) == 0xE0) { length = 3; minimum = 0x800; codepoint = s[0] & 0x0F; }
+		else if ((s[0] & 0xF8) == 0xF0) { length = 4; minimum = 0x10000; codepoint = s[0] & 0x07; }
+		else
+			return 0;
+
+		if (available < length)
+			return 0;
+		for (size_t i = 1; i < length; i++)
+		{
+			if ((s[i] & 0xC0) != 0x80)
+				return 0;
+			codepoint = (codepoint << 6) | (s[i] & 0x3F);
+		}
+		if (codepoint < minimum || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+			return 0;
+		return length;
+	}
+
+	// Decodes to code points, false on the first invalid sequence when strict
+	bool ReferenceUtf8(const std::string &input, std::u32string &output, const bool strict)
+	{
+		output.clear();
+		for (size_t i = 0; i < input.size();)
+		{
+			char32_t codepoint;
+			size_t size = ReferenceDecode((const uint8_t *)input.data() + i, input.size() - i, codepoint);
+			if (!size)
+			{
+				if (strict)
+					return false;
+				codepoint = Replacement;
+				size = 1;
+			}
+			output += codepoint;
+			i += size;
+		}
+		return true;
+	}
+
+	// Validates UTF-16 / UTF-32 units to code points, false on the first invalid unit when strict
+	template <typename Unit>
+	bool ReferenceUnits(const std::basic_string<Unit> &input, std::u32string &output, const bool strict)
+	{
+		output.clear();
+		for (size_t i = 0; i < input.size(); i++)
+		{
+			char32_t codepoint = (char32_t)input[i];
+			if (sizeof(Unit) == 2 && codepoint >= 0xD800 && codepoint <= 0xDBFF && i + 1 < input.size() && input[i + 1] >= 0xDC00 && input[i + 1] <= 0xDFFF)
+				codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + ((char32_t)input[++i] - 0xDC00);
+			else if (codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+			{
+				if (strict)
+					return false;
+				codepoint = Replacement;
+			}
+			output += codepoint;
+		}
+		return true;
+	}
+
+	std::string EncodeUtf8(const std::u32string &codepoints)
+	{
+		std::string output;
+		for (size_t i = 0; i < codepoints.size(); i++)
+		{
+			const char32_t c = codepoints[i];
+			if (c < 0x80)
+				output += (char)c;
+			else if (c < 0x800)
+				output += { (char)(0xC0 | (c >> 6)), (char)(0x80 | (c & 0x3F)) };
+			else if (c < 0x10000)
+				output += { (char)(0xE0 | (c >> 12)), (char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+			else
+				output += { (char)(0xF0 | (c >> 18)), (char)(0x80 | ((c >> 12) & 0x3F)), (char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+		}
+		return output;
+	}
+
+	std::u16string EncodeUtf16(const std::u32string &codepoints)
+	{
+		std::u16string output;
+		for (size_t i = 0; i < codepoints.size(); i++)
+		{
+			const char32_t c = codepoints[i];
+			if (c < 0x10000)
+				output += (char16_t)c;
+			else
+				output += { (char16_t)(0xD800 + ((c - 0x10000) >> 10)), (char16_t)(0xDC00 + ((c - 0x10000) & 0x3FF)) };
+		}
+		return output;
+	}
+
+	std::wstring ToWideString(const std::u32string &codepoints)
+	{
+		if (sizeof(wchar_t) == 4)
+			return std::wstring(codepoints.begin(), codepoints.end());
+		const std::u16string units = EncodeUtf16(codepoints);
+		return std::wstring(units.begin(), units.end());
+	}
+
+	char32_t RandomCodepoint(std::mt19937 &random)
+	{
+		// Weighted towards the encoding boundaries
+		static const char32_t Ranges[][2] = { { 0x20, 0x7E }, { 0x80, 0x7FF }, { 0x800, 0xD7FF }, { 0xE000, 0xFFFF }, { 0x10000, 0x10FFFF } };
+		const char32_t *range = Ranges[random() % 5];
+		return range[0] + random() % (range[1] - range[0] + 1);
+	}
+
+	// ASCII runs of every length around the 16 byte blocks, mixed with valid text and optionally garbage
+	std::string RandomUtf8(std::mt19937 &random, const bool invalid)
+	{
+		std::string text;
+		const size_t parts = random() % 12;
+		for (size_t part = 0; part < parts; part++)
+		{
+			switch (random() % (invalid ? 4 : 3))
+			{
+			case 0:
+				text.append(random() % 40, (char)('a' + random() % 26));
+				break;
+			case 1:
+			case 2:
+				text += EncodeUtf8(std::u32string(1 + random() % 4, RandomCodepoint(random)));
+				break;
+			default:
+			{
+				// Random bytes, or a valid sequence cut short
+				if (random() % 2)
+				{
+					for (size_t i = random() % 6; i > 0; i--)
+						text += (char)(0x80 + random() % 0x80);
+				}
+				else
+				{
+					const std::string sequence = EncodeUtf8(std::u32string(1, RandomCodepoint(random)));
+					text += sequence.substr(0, random() % sequence.size());
+				}
+				break;
+			}
+			}
+		}
+		return text;
+	}
+
+	template <typename Unit>
+	std::basic_string<Unit> RandomUnits(std::mt19937 &random, const bool invalid)
+	{
+		std::basic_string<Unit> text;
+		const size_t length = random() % 80;
+		for (size_t i = 0; i < length; i++)
+		{
+			const uint32_t kind = random() % (invalid ? 4 : 3);
+			if (kind == 0)
+				text.append(random() % 20, (Unit)('a' + random() % 26));
+			else if (kind < 3)
+			{
+				const std::u32string codepoint(1, RandomCodepoint(random));
+				if (sizeof(Unit) == 2)
+					text += (const Unit *)EncodeUtf16(codepoint).c_str();
+				else
+					text += (Unit)codepoint[0];
+			}
+			else if (sizeof(Unit) == 2)
+				text += (Unit)(0xD800 + random() % 0x800);
+			else
+				text += (Unit)(random() % 2 ? 0xD800 + random() % 0x800 : 0x110000 + random() % 0x1000);
+		}
+		return text;
+	}
+
+	size_t Failures = 0;
+
+	void Expect(const bool condition, const char *what, const size_t iteration)
+	{
+		if (!condition && Failures++ < 10)
+			printf("FAIL %s (iteration %zu)\n", what, iteration);
+	}
+
+	void CheckUtf8(std::mt19937 &random, const size_t iteration)
+	{
+		const std::string input = RandomUtf8(random, iteration % 2 == 1);
+		std::u32string reference;
+		const bool valid = ReferenceUtf8(input, reference, true);
+
+		std::vector<char16_t> utf16(input.size() + 1);
+		std::vector<char32_t> utf32(input.size() + 1);
+		const ptrdiff_t written16 = Utf::Utf8ToUtf16(input.data(), input.size(), utf16.data());
+		const ptrdiff_t written32 = Utf::Utf8ToUtf32(input.data(), input.size(), utf32.data());
+
+		Expect(Utf::IsValidUtf8(input.data(), input.size()) == valid, "IsValidUtf8", iteration);
+		if (valid)
+		{
+			Expect(std::u16string(utf16.data(), written16 < 0 ? 0 : written16) == EncodeUtf16(reference), "Utf8ToUtf16", iteration);
+			Expect(std::u32string(utf32.data(), written32 < 0 ? 0 : written32) == reference, "Utf8ToUtf32", iteration);
+		}
+		else
+			Expect(written16 == -1 && written32 == -1, "Utf8ToUtf16/32 rejects", iteration);
+
+		ReferenceUtf8(input, reference, false);
+		Expect(Utf::ToWide(input) == ToWideString(reference), "ToWide", iteration);
+	}
+
+	template <typename Unit>
+	void CheckUnits(std::mt19937 &random, const size_t iteration)
+	{
+		const std::basic_string<Unit> input = RandomUnits<Unit>(random, iteration % 2 == 1);
+		std::u32string reference;
+		const bool valid = ReferenceUnits(input, reference, true);
+
+		std::vector<char> output(input.size() * 4 + 1);
+		const ptrdiff_t written = sizeof(Unit) == 2
+			? Utf::Utf16ToUtf8((const char16_t *)input.data(), input.size(), output.data())
+			: Utf::Utf32ToUtf8((const char32_t *)input.data(), input.size(), output.data());
+		if (valid)
+			Expect(std::string(output.data(), written < 0 ? 0 : written) == EncodeUtf8(reference), sizeof(Unit) == 2 ? "Utf16ToUtf8" : "Utf32ToUtf8", iteration);
+		else
+			Expect(written == -1, sizeof(Unit) == 2 ? "Utf16ToUtf8 rejects" : "Utf32ToUtf8 rejects", iteration);
+
+		if (sizeof(Unit) == sizeof(wchar_t))
+		{
+			ReferenceUnits(input, reference, false);
+			Expect(Utf::ToUtf8(std::wstring_view((const wchar_t *)input.data(), input.size())) == EncodeUtf8(reference), "ToUtf8", iteration);
+		}
+	}
+
+	template <typename Function>
+	void Measure(const char *name, const size_t bytes, Function function)
+	{
+		typedef std::chrono::steady_clock Clock;
+		size_t iterations = 0;
+		const Clock::time_point start = Clock::now();
+		Clock::duration elapsed;
+		do
+		{
+			for (size_t i = 0; i < 64; i++)
+				function();
+			iterations += 64;
+			elapsed = Clock::now() - start;
+		} while (elapsed < std::chrono::milliseconds(250));
+
+		const double seconds = std::chrono::duration<double>(elapsed).count();
+		printf("  %-26s %9.1f MB/s %9.0f ns/call\n", name, (double)bytes * iterations / seconds / 1e6, seconds * 1e9 / iterations);
+	}
+
+	void Benchmark(const char *name, const std::string &text)
+	{
+		printf("%s, %zu bytes\n", name, text.size());
+		const std::wstring wide = Utf::ToWide(text);
+		std::u32string reference;
+		volatile size_t sink = 0;
+
+		Measure("ToWide", text.size(), [&]() { sink = sink + Utf::ToWide(text).size(); });
+		Measure("ToWide scalar reference", text.size(), [&]() { ReferenceUtf8(text, reference, false); sink = sink + ToWideString(reference).size(); });
+		Measure("ToUtf8", text.size(), [&]() { sink = sink + Utf::ToUtf8(wide).size(); });
+		Measure("IsValidUtf8", text.size(), [&]() { sink = sink + Utf::IsValidUtf8(text.data(), text.size()); });
+	}
+
+	std::string Repeat(const std::string &part, const size_t bytes)
+	{
+		std::string text;
+		while (text.size() + part.size() <= bytes)
+			text += part;
+		return text;
+	}
+}
+
+int main()
+{
+	std::mt19937 random(12345);
+	const size_t iterations = 200000;
+	for (size_t i = 0; i < iterations; i++)
+	{
+		CheckUtf8(random, i);
+		CheckUnits<char16_t>(random, i);
+		CheckUnits<char32_t>(random, i);
+	}
+	printf("checked %zu random inputs per transcoder, %zu failures\n\n", iterations, Failures);
+
+	// A chat line is at most a few hundred bytes, a CEF JavaScriptCall payload tens of kilobytes
+	const std::string ascii = "Meet me at the Legion Square garage, bring the car and 500$ ";
+	const std::string mixed = "Grüße aus München, встретимся в гараже 🚗 ";
+	Benchmark("chat, ASCII", ascii.substr(0, 48));
+	Benchmark("chat, mixed", mixed);
+	Benchmark("CEF, ASCII", Repeat("{\"id\":42,\"name\":\"player\",\"pos\":[1.5,-2.25,30.0]},", 64 * 1024));
+	Benchmark("CEF, mixed", Repeat(mixed, 64 * 1024));
+	return Failures ? 1 : 0;
+}
@@ -69,9 +69,10 @@ extern "C" {
 
 class Checkpoint {
 private:
-	int Entity;
+	int Entity = -1;
 public:
 	const int GetEntity() { return Entity; }
+	void SetEntity(const int entity) { Entity = entity; }
 
 	void Create(const CVector3 position, const CVector3 pointto, const int type, const float radius, const Color color, const int reserved)
 	{
@@ -80,7 +81,7 @@ public:
 
 	void Destroy() 
 	{
-		API::Entity::Destroy(Entity);
+		EntityManager::Destroy(Entity);
 		Entity = -1;
 	}
 
@@ -24,18 +24,33 @@ extern "C" {
 
 class NPC {
 private:
-	int Entity;
+	int Entity = -1;
 public:
 	const int GetEntity() { return Entity; }
+	void SetEntity(const int entity) { Entity = entity; }
 
-	void Create(const std::wstring model, const CVector3 position, const CVector3 rotation)
+	// Looks the name up without interning it, arbitrary model strings would fill the atom table
+	void Create(const std::wstring_view model, const CVector3 position, const CVector3 rotation)
 	{
-		Entity = API::NPC::Create(model, position, rotation);
+		const Atom atom = Atoms::Find(model);
+		Entity = API::NPC::Create(atom.IsValid() ? Atoms::Name(atom) : std::wstring(model), position, rotation);
+	}
+
+	// Creates the npc from a model hash, the model name has to be registered with ModelNames
+	void Create(const uint32_t model, const CVector3 position, const CVector3 rotation)
+	{
+		const std::wstring *name = ModelNames::Find(model);
+		Entity = name ? API::NPC::Create(*name, position, rotation) : -1;
+	}
+
+	void Create(const Atom model, const CVector3 position, const CVector3 rotation)
+	{
+		Entity = API::NPC::Create(Atoms::Name(model), position, rotation);
 	}
 
 	void Destroy() 
 	{
-		API::Entity::Destroy(Entity);
+		EntityManager::Destroy(Entity);
 		Entity = -1;
 	}
 
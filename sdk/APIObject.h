@@ -49,13 +49,14 @@ extern "C" {
 
 class Object {
 private:
-	int Entity;
+	int Entity = -1;
 public:
 	const int GetEntity() { return Entity; }
+	void SetEntity(const int entity) { Entity = entity; }
 
-	void Create(const std::wstring model, const CVector3 position, const CVector3 rotation, const bool dynamic)
+	void Create(const std::wstring_view model, const CVector3 position, const CVector3 rotation, const bool dynamic)
 	{
-		Entity = API::Object::Create(model, position, rotation, dynamic);
+		Entity = API::Object::Create(std::wstring(model), position, rotation, dynamic);
 	}
 
 	void Create(const int hash, const CVector3 position, const CVector3 rotation, const bool dynamic)
@@ -65,7 +66,7 @@ public:
 
 	void Destroy()
 	{
-		API::Entity::Destroy(Entity);
+		EntityManager::Destroy(Entity);
 		Entity = -1;
 	}
 
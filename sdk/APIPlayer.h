@@ -141,25 +141,59 @@ public:
 		return API::Player::GetModel(Entity);
 	}
 
-	void SetModel(const std::wstring model)
+	void SetModel(const std::wstring_view model)
 	{
-		API::Player::SetModel(Entity, model);
+		API::Player::SetModel(Entity, std::wstring(model));
+	}
+
+	const uint32_t GetModelHash()
+	{
+		return Hash::Joaat(API::Player::GetModel(Entity));
+	}
+
+	const Atom GetModelAtom()
+	{
+		return Atoms::Intern(API::Player::GetModel(Entity));
+	}
+
+	void SetModel(const Atom model)
+	{
+		API::Player::SetModel(Entity, Atoms::Name(model));
+	}
+
+	// Sets the model from a model hash, the model name has to be registered with ModelNames
+	void SetModel(const uint32_t model)
+	{
+		const std::wstring *name = ModelNames::Find(model);
+		if (name)
+			API::Player::SetModel(Entity, *name);
 	}
 
 	// Sends a Message above the map for this player.
-	void ShowMessageAboveMap(const std::wstring message, const std::wstring pic, const int icontype, const std::wstring sender, const std::wstring subject)
+	void ShowMessageAboveMap(const std::wstring_view message, const std::wstring_view pic, const int icontype, const std::wstring_view sender, const std::wstring_view subject)
 	{
-		API::Visual::ShowMessageAboveMapToPlayer(Entity, message, pic, icontype, sender, subject);
+		API::Visual::ShowMessageAboveMapToPlayer(Entity, std::wstring(message), std::wstring(pic), icontype, std::wstring(sender), std::wstring(subject));
 	}
 
-	void SendChatMessage(const std::string message)
+	// UTF-8 variant, e.g. for notifications that contain usernames or chat text
+	void ShowMessageAboveMap(const std::string_view message, const std::string_view pic, const int icontype, const std::string_view sender, const std::string_view subject)
 	{
-		API::Visual::SendChatMessageToPlayer(Entity, message);
+		API::Visual::ShowMessageAboveMapToPlayer(Entity, ToRef(message), ToRef(pic), icontype, ToRef(sender), ToRef(subject));
+	}
+
+	void SendChatMessage(const std::string_view message)
+	{
+		API::Visual::SendChatMessageToPlayer(Entity, std::string(message));
 	}
 
 	const std::string GetUsername()
 	{
-		API::Player::GetUsername(Entity);
+		return API::Player::GetUsername(Entity);
+	}
+
+	const std::wstring GetUsernameWide()
+	{
+		return Utf::ToWide(API::Player::GetUsername(Entity));
 	}
 
 	void ShowCursor(const bool show)
@@ -167,14 +201,14 @@ public:
 		API::Visual::ShowCursor(Entity, show);
 	}
 
-	void LoadURL(const std::string url, const std::string appcode = "", const bool remote = false)
+	void LoadURL(const std::string_view url, const std::string_view appcode = "", const bool remote = false)
 	{
-		API::CEF::LoadURL(Entity, url, appcode, remote);
+		API::CEF::LoadURL(Entity, std::string(url), std::string(appcode), remote);
 	}
 
-	void JavaScriptCall(std::string call)
+	void JavaScriptCall(const std::string_view call)
 	{
-		API::CEF::JavaScriptCall(Entity, call);
+		API::CEF::JavaScriptCall(Entity, std::string(call));
 	}
 
 	const bool IsControllable()
@@ -9,6 +9,11 @@ extern "C" {
 		{
 		public:
 			DLL_PUBLIC_I static void PrintMessage(const std::wstring  message);
+
+			/// <summary>
+			/// UTF-8 variant of PrintMessage
+			/// </summary>
+			static void PrintMessage(const StringRef message) { PrintMessage(Utf::ToWide(ToView(message))); }
 		};
 	}
 #ifdef __cplusplus
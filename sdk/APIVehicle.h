@@ -153,24 +153,68 @@ extern "C" {
 
 class Vehicle {
 private:
-	int Entity;
+	int Entity = -1;
+	uint32_t Model = 0;
+
 public:
 	const int GetEntity() { return Entity; }
+	void SetEntity(const int entity) { Entity = entity; Model = 0; }
+
+	// Hands the vehicle to the VehicleCollector, which destroys it once nobody used it for a while
+	void Track()
+	{
+		if (Entity != -1)
+			VehicleCollector::Track(Entity);
+	}
+
+	// Looks the name up without interning it, arbitrary model strings would fill the atom table
+	void Create(const std::wstring_view model, const CVector3 position, const float heading)
+	{
+		const Atom atom = Atoms::Find(model);
+		Entity = API::Vehicle::Create(atom.IsValid() ? Atoms::Name(atom) : std::wstring(model), position, heading);
+		Model = Hash::Joaat(model);
+	}
+
+	void Create(const std::wstring_view model, const CVector3 position, const CVector3 rotation)
+	{
+		const Atom atom = Atoms::Find(model);
+		Entity = API::Vehicle::Create(atom.IsValid() ? Atoms::Name(atom) : std::wstring(model), position, rotation);
+		Model = Hash::Joaat(model);
+	}
+
+	// Creates the vehicle from a model hash, the model name has to be registered with ModelNames
+	void Create(const uint32_t model, const CVector3 position, const float heading)
+	{
+		const std::wstring *name = ModelNames::Find(model);
+		Entity = name ? API::Vehicle::Create(*name, position, heading) : -1;
+		Model = name ? model : 0;
+	}
+
+	// Creates the vehicle from a model hash, the model name has to be registered with ModelNames
+	void Create(const uint32_t model, const CVector3 position, const CVector3 rotation)
+	{
+		const std::wstring *name = ModelNames::Find(model);
+		Entity = name ? API::Vehicle::Create(*name, position, rotation) : -1;
+		Model = name ? model : 0;
+	}
 
-	void Create(const std::wstring model, const CVector3 position, const float heading)
+	void Create(const Atom model, const CVector3 position, const float heading)
 	{
-		Entity = API::Vehicle::Create(model, position, heading);
+		Entity = API::Vehicle::Create(Atoms::Name(model), position, heading);
+		Model = Atoms::HashOf(model);
 	}
 
-	void Create(const std::wstring model, const CVector3 position, const CVector3 rotation)
+	void Create(const Atom model, const CVector3 position, const CVector3 rotation)
 	{
-		Entity = API::Vehicle::Create(model, position, rotation);
+		Entity = API::Vehicle::Create(Atoms::Name(model), position, rotation);
+		Model = Atoms::HashOf(model);
 	}
 
 	void Destroy()
 	{
-		API::Entity::Destroy(Entity);
+		EntityManager::Destroy(Entity);
 		Entity = -1;
+		Model = 0;
 	}
 
 	const CVector3 GetPosition()
@@ -218,9 +262,10 @@ public:
 		return API::Vehicle::GetNumberPlate(Entity);
 	}
 
-	void SetNumberPlate(const std::wstring plate)
+	void SetNumberPlate(const std::wstring_view plate)
 	{
-		API::Vehicle::SetNumberPlate(Entity, plate);
+		API::Vehicle::SetNumberPlate(Entity, std::wstring(plate));
+		PlateIndex::Set(Entity, plate);
 	}
 
 	const int GetMod(const int modType)
@@ -263,6 +308,19 @@ public:
 		return API::Vehicle::GetModel(Entity);
 	}
 
+	const uint32_t GetModelHash()
+	{
+		if (!Model)
+			Model = Hash::Joaat(API::Vehicle::GetModel(Entity));
+		return Model;
+	}
+
+	const Atom GetModelAtom()
+	{
+		const Atom atom = Atoms::FindHash(GetModelHash());
+		return atom.IsValid() ? atom : Atoms::Intern(API::Vehicle::GetModel(Entity));
+	}
+
 	const int GetNumberPlateStyle() 
 	{
 		return API::Vehicle::GetNumberPlateStyle(Entity);
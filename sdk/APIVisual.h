@@ -19,6 +19,11 @@ extern "C" {
 			/// <returns></returns>
 			DLL_PUBLIC_I static void ShowMessageAboveMap(const std::wstring message, const std::wstring pic, const int icontype, const std::wstring sender, const std::wstring subject);
 
+			/// <summary>
+			/// UTF-8 variant of ShowMessageAboveMap
+			/// </summary>
+			static void ShowMessageAboveMap(const StringRef message, const StringRef pic, const int icontype, const StringRef sender, const StringRef subject) { ShowMessageAboveMap(Utf::ToWide(ToView(message)), Utf::ToWide(ToView(pic)), icontype, Utf::ToWide(ToView(sender)), Utf::ToWide(ToView(subject))); }
+
 			/// <summary>
 			/// Sends a notification message that displays above the game minimap to a specific client.
 			/// </summary>
@@ -31,6 +36,11 @@ extern "C" {
 			/// <returns></returns>
 			DLL_PUBLIC_I static void ShowMessageAboveMapToPlayer(const int entity, const std::wstring message, const std::wstring pic, const int icontype, const std::wstring sender, const std::wstring subject);
 
+			/// <summary>
+			/// UTF-8 variant of ShowMessageAboveMapToPlayer
+			/// </summary>
+			static void ShowMessageAboveMapToPlayer(const int entity, const StringRef message, const StringRef pic, const int icontype, const StringRef sender, const StringRef subject) { ShowMessageAboveMapToPlayer(entity, Utf::ToWide(ToView(message)), Utf::ToWide(ToView(pic)), icontype, Utf::ToWide(ToView(sender)), Utf::ToWide(ToView(subject))); }
+
 			/// <summary>
 			/// Sends a chat message to all clients.
 			/// </summary>
@@ -59,4 +59,38 @@ extern "C" {
 	}
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
+
+class World {
+public:
+	// Read from the server every time, the weather can also change through the raw API or the server itself
+	static const Atom GetWeatherAtom()
+	{
+		return Atoms::Intern(API::World::GetWeather());
+	}
+
+	static void SetWeather(const Atom weather)
+	{
+		API::World::SetWeather(Atoms::Name(weather));
+	}
+
+	static void LoadIPL(const Atom ipl)
+	{
+		API::World::LoadIPL(Atoms::Name(ipl));
+	}
+
+	static void LoadIPL(const int entity, const Atom ipl)
+	{
+		API::World::LoadIPL(entity, Atoms::Name(ipl));
+	}
+
+	static void UnloadIPL(const Atom ipl)
+	{
+		API::World::UnloadIPL(Atoms::Name(ipl));
+	}
+
+	static void UnloadIPL(const int entity, const Atom ipl)
+	{
+		API::World::UnloadIPL(entity, Atoms::Name(ipl));
+	}
+};
\ No newline at end of file
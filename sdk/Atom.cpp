@@ -0,0 +1,176 @@
+/**
+File:
+	Atom.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+	const uint32_t IndexSize = Atoms::Capacity * 2;
+	const uint32_t PerfectBits = 5;
+
+	const wchar_t *const BuiltinNames[Atoms::BuiltinCount] = {
+		L"EXTRASUNNY", L"CLEAR", L"CLOUDS", L"SMOG", L"FOGGY", L"OVERCAST", L"RAIN", L"THUNDER",
+		L"CLEARING", L"NEUTRAL", L"SNOW", L"BLIZZARD", L"SNOWLIGHT", L"XMAS", L"HALLOWEEN"
+	};
+
+	struct AtomEntry
+	{
+		std::wstring Name;
+		uint32_t Hash;
+	};
+
+	bool EqualsNoCase(const std::wstring &a, const std::wstring_view b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (Hash::Detail::Lower((uint32_t)a[i]) != Hash::Detail::Lower((uint32_t)b[i]))
+				return false;
+		}
+		return true;
+	}
+
+	class AtomTable
+	{
+	public:
+		AtomEntry Entries[Atoms::Capacity];
+		std::atomic<uint16_t> Count;
+		std::atomic<uint16_t> Index[IndexSize];
+		std::mutex WriteMutex;
+
+		// The built-in names get a collision free table, so they always resolve with a single probe
+		uint32_t PerfectSeed;
+		uint16_t Perfect[1 << PerfectBits];
+
+		AtomTable() : Count(0), PerfectSeed(0)
+		{
+			Entries[0].Hash = 0;
+			for (uint32_t i = 0; i < IndexSize; i++)
+				Index[i].store(0, std::memory_order_relaxed);
+
+			for (uint16_t i = 0; i < Atoms::BuiltinCount; i++)
+				Insert(BuiltinNames[i], Hash::Joaat(BuiltinNames[i]));
+
+			for (uint32_t seed = 1; PerfectSeed == 0; seed += 2)
+			{
+				memset(Perfect, 0, sizeof(Perfect));
+
+				bool collision = false;
+				for (uint16_t id = 1; id <= Atoms::BuiltinCount && !collision; id++)
+				{
+					uint16_t &slot = Perfect[PerfectSlot(Entries[id].Hash, seed)];
+					collision = slot != 0;
+					slot = id;
+				}
+
+				if (!collision)
+					PerfectSeed = seed;
+			}
+		}
+
+		static uint32_t PerfectSlot(const uint32_t hash, const uint32_t seed)
+		{
+			return (hash * seed) >> (32 - PerfectBits);
+		}
+
+		uint16_t Lookup(const std::wstring_view name, const uint32_t hash) const
+		{
+			const uint16_t builtin = Perfect[PerfectSlot(hash, PerfectSeed)];
+			if (builtin && Entries[builtin].Hash == hash && EqualsNoCase(Entries[builtin].Name, name))
+				return builtin;
+
+			for (uint32_t slot = hash & (IndexSize - 1);; slot = (slot + 1) & (IndexSize - 1))
+			{
+				const uint16_t id = Index[slot].load(std::memory_order_acquire);
+				if (id == 0)
+					return 0;
+				if (Entries[id].Hash == hash && EqualsNoCase(Entries[id].Name, name))
+					return id;
+			}
+		}
+
+		// Callers must hold WriteMutex (or be the constructor)
+		uint16_t Insert(const std::wstring_view name, const uint32_t hash)
+		{
+			const uint16_t id = Count.load(std::memory_order_relaxed) + 1;
+			if (id >= Atoms::Capacity)
+				return 0;
+
+			Entries[id].Name = name;
+			Entries[id].Hash = hash;
+			Count.store(id, std::memory_order_release);
+
+			uint32_t slot = hash & (IndexSize - 1);
+			while (Index[slot].load(std::memory_order_relaxed) != 0)
+				slot = (slot + 1) & (IndexSize - 1);
+			Index[slot].store(id, std::memory_order_release);
+			return id;
+		}
+	};
+
+	AtomTable &Table()
+	{
+		static AtomTable table;
+		return table;
+	}
+}
+
+Atom Atoms::Intern(const std::wstring_view name)
+{
+	AtomTable &table = Table();
+	const uint32_t hash = Hash::Joaat(name);
+
+	uint16_t id = table.Lookup(name, hash);
+	if (id)
+		return Atom(id);
+
+	std::lock_guard<std::mutex> lock(table.WriteMutex);
+	id = table.Lookup(name, hash);
+	if (!id)
+		id = table.Insert(name, hash);
+	return Atom(id);
+}
+
+Atom Atoms::Find(const std::wstring_view name)
+{
+	return Atom(Table().Lookup(name, Hash::Joaat(name)));
+}
+
+Atom Atoms::FindHash(const uint32_t hash)
+{
+	const AtomTable &table = Table();
+	for (uint32_t slot = hash & (IndexSize - 1);; slot = (slot + 1) & (IndexSize - 1))
+	{
+		const uint16_t id = table.Index[slot].load(std::memory_order_acquire);
+		if (id == 0 || table.Entries[id].Hash == hash)
+			return Atom(id);
+	}
+}
+
+const std::wstring &Atoms::Name(const Atom atom)
+{
+	const AtomTable &table = Table();
+	if (atom.Id > table.Count.load(std::memory_order_acquire))
+		return table.Entries[0].Name;
+	return table.Entries[atom.Id].Name;
+}
+
+uint32_t Atoms::HashOf(const Atom atom)
+{
+	const AtomTable &table = Table();
+	if (atom.Id > table.Count.load(std::memory_order_acquire))
+		return 0;
+	return table.Entries[atom.Id].Hash;
+}
+
+uint16_t Atoms::Count()
+{
+	return Table().Count.load(std::memory_order_acquire);
+}
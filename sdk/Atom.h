@@ -0,0 +1,81 @@
+#pragma once
+
+/// <summary>
+/// Small integer id of an interned model, weather or IPL name.
+/// Atoms compare as integers and resolve back to their name without allocating.
+/// </summary>
+struct Atom
+{
+	uint16_t Id;
+
+	Atom() : Id(0) { }
+	explicit Atom(const uint16_t id) : Id(id) { }
+
+	const bool IsValid() const { return Id != 0; }
+	bool operator==(const Atom other) const { return Id == other.Id; }
+	bool operator!=(const Atom other) const { return Id != other.Id; }
+};
+
+/// <summary>
+/// Global intern table.
+/// Lookups and name resolution are lock-free, only interning a new name takes a lock.
+/// Names are matched case insensitively, like the game does.
+/// </summary>
+class Atoms
+{
+public:
+	/// <summary>
+	/// Maximum number of atoms, including the built-in ones
+	/// </summary>
+	static const uint16_t Capacity = 4096;
+
+	/// <summary>
+	/// Built-in weather atoms, always interned
+	/// </summary>
+	enum Weather : uint16_t
+	{
+		ExtraSunny = 1, Clear, Clouds, Smog, Foggy, Overcast, Rain, Thunder,
+		Clearing, Neutral, Snow, Blizzard, SnowLight, Xmas, Halloween,
+		BuiltinCount = Halloween
+	};
+
+	/// <summary>
+	/// Interns a name
+	/// </summary>
+	/// <param name="name">The name to intern</param>
+	/// <returns name="atom">The atom of the name, invalid if the table is full</returns>
+	static Atom Intern(const std::wstring_view name);
+
+	/// <summary>
+	/// Finds the atom of a name without interning it
+	/// </summary>
+	/// <param name="name">The name to look up</param>
+	/// <returns name="atom">The atom of the name, invalid if it was never interned</returns>
+	static Atom Find(const std::wstring_view name);
+
+	/// <summary>
+	/// Finds the atom of a name by its model hash (see Hash::Joaat)
+	/// </summary>
+	/// <param name="hash">The hash of the name</param>
+	/// <returns name="atom">The atom of the name, invalid if it was never interned</returns>
+	static Atom FindHash(const uint32_t hash);
+
+	/// <summary>
+	/// Gets the name of an atom
+	/// </summary>
+	/// <param name="atom">The atom</param>
+	/// <returns name="name">The name, empty for invalid atoms</returns>
+	static const std::wstring &Name(const Atom atom);
+
+	/// <summary>
+	/// Gets the model hash of an atom
+	/// </summary>
+	/// <param name="atom">The atom</param>
+	/// <returns name="hash">The hash of the name, 0 for invalid atoms</returns>
+	static uint32_t HashOf(const Atom atom);
+
+	/// <summary>
+	/// Gets the number of interned atoms
+	/// </summary>
+	static uint16_t Count();
+};
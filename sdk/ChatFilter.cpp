@@ -0,0 +1,521 @@
+/**
+File:
+	ChatFilter.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <chrono>
+#include <unordered_map>
+
+namespace
+{
+	const uint32_t RawByte = 0xFFFFFFFF;
+
+	struct Pattern
+	{
+		std::string Folded;
+		bool WholeWord;
+	};
+
+	struct FilterState
+	{
+		std::vector<Pattern> Patterns;
+
+		// Compiled automaton, rebuilt by Build
+		uint16_t Classes[256] = {};
+		size_t ClassCount = 1;
+		std::vector<int32_t> Delta;
+		std::vector<int32_t> Output;
+		std::vector<int32_t> OutputLink;
+		bool Built = false;
+	};
+
+	FilterState &State()
+	{
+		static FilterState state;
+		return state;
+	}
+
+	// Decodes one code point, invalid bytes come back one at a time as RawByte
+	size_t Decode(const std::string_view text, const size_t i, uint32_t &codepoint)
+	{
+		const uint8_t lead = (uint8_t)text[i];
+		if (lead < 0x80)
+		{
+			codepoint = lead;
+			return 1;
+		}
+
+		size_t length;
+		uint32_t value;
+		if ((lead & 0xE0) == 0xC0)
+		{
+			length = 2;
+			value = lead & 0x1F;
+		}
+		else if ((lead & 0xF0) == 0xE0)
+		{
+			length = 3;
+			value = lead & 0x0F;
+		}
+		else if ((lead & 0xF8) == 0xF0)
+		{
+			length = 4;
+			value = lead & 0x07;
+		}
+		else
+		{
+			codepoint = RawByte;
+			return 1;
+		}
+
+		if (i + length > text.size())
+		{
+			codepoint = RawByte;
+			return 1;
+		}
+		for (size_t j = 1; j < length; j++)
+		{
+			const uint8_t next = (uint8_t)text[i + j];
+			if ((next & 0xC0) != 0x80)
+			{
+				codepoint = RawByte;
+				return 1;
+			}
+			value = (value << 6) | (next & 0x3F);
+		}
+
+		codepoint = value;
+		return length;
+	}
+
+	// Encodes a code point with the given UTF-8 length, Fold never changes the length
+	void Encode(const uint32_t codepoint, const size_t length, uint8_t *bytes)
+	{
+		switch (length)
+		{
+		case 1:
+			bytes[0] = (uint8_t)codepoint;
+			break;
+		case 2:
+			bytes[0] = (uint8_t)(0xC0 | (codepoint >> 6));
+			bytes[1] = (uint8_t)(0x80 | (codepoint & 0x3F));
+			break;
+		case 3:
+			bytes[0] = (uint8_t)(0xE0 | (codepoint >> 12));
+			bytes[1] = (uint8_t)(0x80 | ((codepoint >> 6) & 0x3F));
+			bytes[2] = (uint8_t)(0x80 | (codepoint & 0x3F));
+			break;
+		default:
+			bytes[0] = (uint8_t)(0xF0 | (codepoint >> 18));
+			bytes[1] = (uint8_t)(0x80 | ((codepoint >> 12) & 0x3F));
+			bytes[2] = (uint8_t)(0x80 | ((codepoint >> 6) & 0x3F));
+			bytes[3] = (uint8_t)(0x80 | (codepoint & 0x3F));
+			break;
+		}
+	}
+
+	// Calls visit with every byte of the folded text and the offset of the byte in the original text
+	template <typename Visit>
+	bool ForEachFoldedByte(const std::string_view text, Visit visit)
+	{
+		for (size_t i = 0; i < text.size();)
+		{
+			const uint8_t c = (uint8_t)text[i];
+			if (c < 0x80)
+			{
+				if (!visit((uint8_t)(c >= 'A' && c <= 'Z' ? c + 32 : c), i))
+					return false;
+				i++;
+				continue;
+			}
+
+			uint32_t codepoint;
+			const size_t length = Decode(text, i, codepoint);
+
+			uint8_t bytes[4];
+			if (codepoint == RawByte)
+				bytes[0] = (uint8_t)text[i];
+			else
+				Encode(ChatFilter::Fold(codepoint), length, bytes);
+
+			for (size_t j = 0; j < length; j++)
+			{
+				if (!visit(bytes[j], i + j))
+					return false;
+			}
+			i += length;
+		}
+		return true;
+	}
+
+	bool IsWordByte(const uint8_t c)
+	{
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+	}
+
+	// Runs the automaton and calls match for every match that passes the whole word check
+	template <typename Match>
+	void Scan(const FilterState &state, const std::string_view message, Match match)
+	{
+		if (!state.Built)
+			return;
+
+		int32_t current = 0;
+		ForEachFoldedByte(message, [&](const uint8_t byte, const size_t offset)
+		{
+			current = state.Delta[(size_t)current * state.ClassCount + state.Classes[byte]];
+			for (int32_t out = state.Output[current] >= 0 ? current : state.OutputLink[current]; out != -1; out = state.OutputLink[out])
+			{
+				const Pattern &pattern = state.Patterns[state.Output[out]];
+				const size_t end = offset + 1;
+				const size_t start = end - pattern.Folded.size();
+				if (pattern.WholeWord && ((start > 0 && IsWordByte((uint8_t)message[start - 1])) || (end < message.size() && IsWordByte((uint8_t)message[end]))))
+					continue;
+
+				ChatMatch found;
+				found.Offset = start;
+				found.Length = pattern.Folded.size();
+				found.Pattern = (uint32_t)state.Output[out];
+				if (!match(found))
+					return false;
+			}
+			return true;
+		});
+	}
+}
+
+uint32_t ChatFilter::Fold(const uint32_t c)
+{
+	if (c < 0x80)
+		return c >= 'A' && c <= 'Z' ? c + 32 : c;
+	// Latin-1
+	if (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+		return c + 32;
+	// Latin Extended-A, upper and lower case alternate
+	if ((c >= 0x100 && c <= 0x137) || (c >= 0x14A && c <= 0x177))
+		return c | 1;
+	if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+		return (c & 1) ? c + 1 : c;
+	if (c == 0x178)
+		return 0xFF;
+	// Greek
+	if (c >= 0x391 && c <= 0x3A9 && c != 0x3A2)
+		return c + 32;
+	// Cyrillic
+	if (c >= 0x400 && c <= 0x40F)
+		return c + 80;
+	if (c >= 0x410 && c <= 0x42F)
+		return c + 32;
+	return c;
+}
+
+void ChatFilter::Add(const std::string_view pattern, const bool wholeWord)
+{
+	if (pattern.empty())
+		return;
+
+	Pattern added;
+	added.WholeWord = wholeWord;
+	added.Folded.reserve(pattern.size());
+	ForEachFoldedByte(pattern, [&](const uint8_t byte, const size_t) { added.Folded += (char)byte; return true; });
+	State().Patterns.push_back(added);
+}
+
+void ChatFilter::Build()
+{
+	FilterState &state = State();
+
+	// Bytes that appear in no pattern share class 0
+	memset(state.Classes, 0, sizeof(state.Classes));
+	state.ClassCount = 1;
+	for (size_t i = 0; i < state.Patterns.size(); i++)
+	{
+		for (size_t j = 0; j < state.Patterns[i].Folded.size(); j++)
+		{
+			uint16_t &cls = state.Classes[(uint8_t)state.Patterns[i].Folded[j]];
+			if (cls == 0)
+				cls = (uint16_t)state.ClassCount++;
+		}
+	}
+	const size_t classes = state.ClassCount;
+
+	// Trie
+	state.Delta.assign(classes, -1);
+	state.Output.assign(1, -1);
+	for (size_t i = 0; i < state.Patterns.size(); i++)
+	{
+		size_t current = 0;
+		const std::string &folded = state.Patterns[i].Folded;
+		for (size_t j = 0; j < folded.size(); j++)
+		{
+			int32_t &next = state.Delta[current * classes + state.Classes[(uint8_t)folded[j]]];
+			if (next == -1)
+			{
+				next = (int32_t)state.Output.size();
+				state.Output.push_back(-1);
+				state.Delta.resize(state.Delta.size() + classes, -1);
+			}
+			current = (size_t)state.Delta[current * classes + state.Classes[(uint8_t)folded[j]]];
+		}
+
+		// Duplicates keep the first pattern, a plain duplicate lifts the whole word restriction
+		if (state.Output[current] == -1)
+			state.Output[current] = (int32_t)i;
+		else if (!state.Patterns[i].WholeWord)
+			state.Patterns[state.Output[current]].WholeWord = false;
+	}
+
+	// Failure links in breadth first order, turning the trie into a complete automaton
+	const size_t states = state.Output.size();
+	std::vector<int32_t> fail(states, 0);
+	std::vector<int32_t> queue;
+	queue.reserve(states);
+	state.OutputLink.assign(states, -1);
+
+	for (size_t c = 0; c < classes; c++)
+	{
+		int32_t &next = state.Delta[c];
+		if (next == -1)
+			next = 0;
+		else
+			queue.push_back(next);
+	}
+
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		const int32_t current = queue[head];
+		for (size_t c = 0; c < classes; c++)
+		{
+			int32_t &next = state.Delta[(size_t)current * classes + c];
+			const int32_t fallback = state.Delta[(size_t)fail[current] * classes + c];
+			if (next == -1)
+			{
+				next = fallback;
+				continue;
+			}
+
+			fail[next] = fallback;
+			state.OutputLink[next] = state.Output[fallback] >= 0 ? fallback : state.OutputLink[fallback];
+			queue.push_back(next);
+		}
+	}
+
+	state.Built = true;
+}
+
+void ChatFilter::Clear()
+{
+	FilterState &state = State();
+	state.Patterns.clear();
+	state.Delta.clear();
+	state.Output.clear();
+	state.OutputLink.clear();
+	state.Built = false;
+}
+
+bool ChatFilter::Contains(const std::string_view message)
+{
+	bool found = false;
+	Scan(State(), message, [&](const ChatMatch &) { found = true; return false; });
+	return found;
+}
+
+size_t ChatFilter::Find(const std::string_view message, std::vector<ChatMatch> &matches)
+{
+	matches.clear();
+	Scan(State(), message, [&](const ChatMatch &match) { matches.push_back(match); return true; });
+	return matches.size();
+}
+
+std::string ChatFilter::Censor(const std::string_view message, const char mask)
+{
+	std::vector<ChatMatch> matches;
+	if (!Find(message, matches))
+		return std::string(message);
+
+	std::vector<uint8_t> masked(message.size(), 0);
+	for (size_t i = 0; i < matches.size(); i++)
+		memset(masked.data() + matches[i].Offset, 1, matches[i].Length);
+
+	// One mask character per masked code point
+	std::string censored;
+	censored.reserve(message.size());
+	for (size_t i = 0; i < message.size();)
+	{
+		uint32_t codepoint;
+		const size_t length = Decode(message, i, codepoint);
+		if (masked[i])
+			censored += mask;
+		else
+			censored.append(message.data() + i, length);
+		i += length;
+	}
+	return censored;
+}
+
+size_t ChatFilter::GetPatternCount()
+{
+	return State().Patterns.size();
+}
+
+bool ChatFilter::OnPlayerMessage(void *context, const PlayerMessageEvent &event)
+{
+	(void)context;
+	const std::string_view message = ToView(event.Message);
+
+	const SpamVerdict verdict = SpamDetector::Check(event.Entity, message);
+	if (verdict != SpamVerdict::Ok)
+	{
+		API::Visual::SendChatMessageToPlayer(event.Entity, verdict == SpamVerdict::Flood ? "You are sending messages too fast" : "Please do not repeat yourself");
+		return false;
+	}
+
+	if (Contains(message))
+	{
+		API::Visual::SendChatMessageToPlayer(event.Entity, "Your message contains words that are not allowed");
+		return false;
+	}
+	return true;
+}
+
+namespace
+{
+	struct SpamHistory
+	{
+		int64_t Times[SpamDetector::HistorySize];
+		uint32_t Signatures[SpamDetector::HistorySize][SpamDetector::SignatureSize];
+		size_t Next;
+		size_t Count;
+	};
+
+	struct SpamState
+	{
+		SpamConfig Config;
+		std::unordered_map<int, SpamHistory> Players;
+	};
+
+	SpamState &Spam()
+	{
+		static SpamState state;
+		return state;
+	}
+
+	uint64_t Mix(uint64_t x)
+	{
+		x ^= x >> 33;
+		x *= 0xFF51AFD7ED558CCDULL;
+		x ^= x >> 33;
+		x *= 0xC4CEB9FE1A85EC53ULL;
+		x ^= x >> 33;
+		return x;
+	}
+
+	// Folds a 4-gram hash into the signature, the 16 MinHash functions are derived from one 64 bit hash
+	void AddGram(const uint64_t gram, uint32_t (&signature)[SpamDetector::SignatureSize])
+	{
+		const uint64_t hash = Mix(gram);
+		const uint32_t a = (uint32_t)hash;
+		const uint32_t b = (uint32_t)(hash >> 32) | 1;
+		for (uint32_t k = 0; k < SpamDetector::SignatureSize; k++)
+		{
+			const uint32_t value = a + k * b;
+			if (value < signature[k])
+				signature[k] = value;
+		}
+	}
+}
+
+void SpamDetector::Configure(const SpamConfig &config)
+{
+	Spam().Config = config;
+}
+
+const SpamConfig &SpamDetector::GetConfig()
+{
+	return Spam().Config;
+}
+
+void SpamDetector::Sign(const std::string_view message, uint32_t (&signature)[SignatureSize])
+{
+	const uint64_t Base = 0x100000001B3ULL;
+	const uint64_t BaseOut = Base * Base * Base * Base;
+
+	for (size_t k = 0; k < SignatureSize; k++)
+		signature[k] = 0xFFFFFFFF;
+
+	// Rolling hash over the last four folded letters and digits, spaces and punctuation are skipped
+	uint32_t window[4] = {};
+	uint64_t rolling = 0;
+	size_t count = 0;
+	for (size_t i = 0; i < message.size();)
+	{
+		uint32_t codepoint;
+		i += Decode(message, i, codepoint);
+		if (codepoint < 0x80 && !IsWordByte((uint8_t)codepoint))
+			continue;
+
+		codepoint = codepoint == RawByte ? 0xFFFD : ChatFilter::Fold(codepoint);
+		rolling = rolling * Base + codepoint - window[count % 4] * BaseOut;
+		window[count % 4] = codepoint;
+		count++;
+
+		if (count >= 4)
+			AddGram(rolling, signature);
+	}
+
+	// Short messages are one gram
+	if (count > 0 && count < 4)
+		AddGram(rolling, signature);
+}
+
+float SpamDetector::Compare(const uint32_t (&a)[SignatureSize], const uint32_t (&b)[SignatureSize])
+{
+	size_t equal = 0;
+	for (size_t k = 0; k < SignatureSize; k++)
+		equal += a[k] == b[k];
+	return (float)equal / (float)SignatureSize;
+}
+
+SpamVerdict SpamDetector::Check(const int entity, const std::string_view message)
+{
+	SpamState &state = Spam();
+	const SpamConfig &config = state.Config;
+	const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	SpamHistory &history = state.Players[entity];
+
+	uint32_t signature[SignatureSize];
+	Sign(message, signature);
+
+	uint32_t recent = 0;
+	uint32_t repeats = 0;
+	for (size_t i = 0; i < history.Count; i++)
+	{
+		if (now - history.Times[i] > (int64_t)config.Window)
+			continue;
+
+		recent++;
+		if (Compare(signature, history.Signatures[i]) >= config.Similarity)
+			repeats++;
+	}
+
+	// Recorded even when rejected, so a player who keeps spamming stays rejected
+	history.Times[history.Next] = now;
+	memcpy(history.Signatures[history.Next], signature, sizeof(signature));
+	history.Next = (history.Next + 1) % HistorySize;
+	if (history.Count < HistorySize)
+		history.Count++;
+
+	if (recent >= config.MaxMessages)
+		return SpamVerdict::Flood;
+	if (repeats >= config.MaxRepeats)
+		return SpamVerdict::Repeated;
+	return SpamVerdict::Ok;
+}
+
+void SpamDetector::RemovePlayer(const int entity)
+{
+	Spam().Players.erase(entity);
+}
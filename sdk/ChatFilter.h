@@ -0,0 +1,127 @@
+#pragma once
+
+struct ChatMatch
+{
+	// Byte range in the message
+	size_t Offset;
+	size_t Length;
+	// Index of the pattern in the order it was added
+	uint32_t Pattern;
+};
+
+/// <summary>
+/// Banned word matcher over UTF-8 chat messages.
+/// All patterns are compiled into one Aho-Corasick automaton with a byte class compressed transition table,
+/// so matching costs one table lookup per byte no matter how many patterns there are.
+/// Matching is case insensitive for Latin, Greek and Cyrillic (simple case folding that keeps the UTF-8 length,
+/// so match offsets point into the original message). Tick thread only.
+/// </summary>
+class ChatFilter
+{
+public:
+	/// <summary>
+	/// Adds a pattern, takes effect on the next Build
+	/// </summary>
+	/// <param name="pattern">The UTF-8 pattern</param>
+	/// <param name="wholeWord">Only match when the pattern is not part of a longer word</param>
+	static void Add(const std::string_view pattern, const bool wholeWord = false);
+
+	/// <summary>
+	/// Compiles the added patterns, call once after adding them
+	/// </summary>
+	static void Build();
+
+	/// <summary>
+	/// Removes every pattern
+	/// </summary>
+	static void Clear();
+
+	/// <summary>
+	/// Checks if a message contains any pattern, stops at the first match
+	/// </summary>
+	static bool Contains(const std::string_view message);
+
+	/// <summary>
+	/// Finds every match in a message
+	/// </summary>
+	/// <param name="message">The UTF-8 message</param>
+	/// <param name="matches">Receives the matches, cleared first</param>
+	/// <returns name="count">The number of matches</returns>
+	static size_t Find(const std::string_view message, std::vector<ChatMatch> &matches);
+
+	/// <summary>
+	/// Replaces every character of every match with a mask character
+	/// </summary>
+	static std::string Censor(const std::string_view message, const char mask = '*');
+
+	static size_t GetPatternCount();
+
+	/// <summary>
+	/// EventBus handler for PlayerMessageEvent, stops spam and messages with banned words.
+	/// It is not subscribed by default, the plugin subscribes it in API_Initialize.
+	/// </summary>
+	static bool OnPlayerMessage(void *context, const PlayerMessageEvent &event);
+
+	/// <summary>
+	/// Folds a code point for case insensitive matching (Latin, Greek and Cyrillic)
+	/// </summary>
+	static uint32_t Fold(const uint32_t codepoint);
+};
+
+struct SpamConfig
+{
+	// Window in milliseconds over which messages are compared and counted
+	uint32_t Window = 30000;
+	// Messages at least this similar (0..1) count as repeats
+	float Similarity = 0.6f;
+	// A message is spam when this many earlier messages in the window are repeats of it
+	uint32_t MaxRepeats = 2;
+	// A message is flooding when this many messages were already sent in the window
+	uint32_t MaxMessages = 10;
+};
+
+enum class SpamVerdict : uint8_t
+{
+	Ok,
+	Repeated,
+	Flood
+};
+
+/// <summary>
+/// Per player near duplicate and flood detector.
+/// Every message is reduced to a MinHash signature of its folded character 4-grams (rolling hash),
+/// so edits like changed case, punctuation or a few added characters still compare as similar.
+/// The last messages of every player are kept in a fixed ring, checking never allocates after
+/// the player's first message. Tick thread only.
+/// </summary>
+class SpamDetector
+{
+public:
+	static const size_t SignatureSize = 16;
+	static const size_t HistorySize = 16;
+
+	static void Configure(const SpamConfig &config);
+	static const SpamConfig &GetConfig();
+
+	/// <summary>
+	/// Checks a message and records it in the player's history
+	/// </summary>
+	/// <param name="entity">The player</param>
+	/// <param name="message">The UTF-8 message</param>
+	static SpamVerdict Check(const int entity, const std::string_view message);
+
+	/// <summary>
+	/// Computes the signature of a message
+	/// </summary>
+	static void Sign(const std::string_view message, uint32_t (&signature)[SignatureSize]);
+
+	/// <summary>
+	/// Estimates the similarity (0..1) of two messages from their signatures
+	/// </summary>
+	static float Compare(const uint32_t (&a)[SignatureSize], const uint32_t (&b)[SignatureSize]);
+
+	/// <summary>
+	/// Forgets the history of a player, call when the player disconnects
+	/// </summary>
+	static void RemovePlayer(const int entity);
+};
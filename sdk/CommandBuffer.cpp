@@ -0,0 +1,859 @@
+/**
+File:
+	CommandBuffer.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	enum class Op : uint16_t
+	{
+		Call,
+		Destroy,
+		SetPosition,
+		SetRotation,
+		SetViewDistance,
+		SetPedComponent,
+		SetPedHeadBlend,
+		SetPedHeadOverlay,
+		SetPedProp,
+		SetPedFaceFeature,
+		SetModel,
+		SetControllable,
+		SetTextureVariation,
+		SetColor,
+		SetColorRgb,
+		SetNumberPlate,
+		SetMod,
+		SetEngineState,
+		SetDoorsLockState,
+		SetDoorsLockStateForPlayer,
+		SetNumberPlateStyle,
+		SetExtra,
+		ShowCheckpoint,
+		HideCheckpoint,
+		SetCheckpointNearHeight,
+		SetCheckpointFarHeight,
+		ShowMessageAboveMap,
+		ShowMessageAboveMapToPlayer,
+		SendChatMessage,
+		SendChatMessageToPlayer,
+		ShowCursor,
+		SetTime,
+		SetWeather,
+		LoadIPL,
+		LoadIPLForPlayer,
+		UnloadIPL,
+		UnloadIPLForPlayer,
+		LoadURL,
+		JavaScriptCall,
+		PrintMessage
+	};
+
+	// Every command starts with this, followed by its arguments. Arguments are padded to 4 bytes so wide string
+	// payloads can be passed to the API in place, records to 8 bytes so Call payloads are aligned.
+	struct Header
+	{
+		uint32_t Size;
+		uint32_t Key;
+		Op Operation;
+		uint16_t Reserved;
+		int32_t Entity;
+	};
+
+	const size_t BlockSize = 64 * 1024;
+
+	size_t Padded(const size_t size)
+	{
+		return (size + 3) & ~(size_t)3;
+	}
+
+	// The function of a Call, padded to 8 bytes so that with the 16 byte header and the 8 byte size the payload
+	// is 8-byte aligned in 32-bit builds too
+	struct alignas(8) CallTarget
+	{
+		DeferredCall Function;
+	};
+	static_assert(sizeof(Header) == 16 && sizeof(CallTarget) == 8, "Call payloads have to start 8-byte aligned");
+
+	// Raw bytes without a length, for Call payloads
+	struct Payload
+	{
+		const void *Data;
+		size_t Size;
+	};
+
+	std::atomic<size_t> ArenaBytes{ 0 };
+
+	struct Arena
+	{
+		struct Block
+		{
+			std::unique_ptr<uint8_t[]> Data;
+			size_t Capacity;
+			size_t Used;
+		};
+
+		std::vector<Block> Blocks;
+		size_t Current = 0;
+
+		uint8_t *Allocate(const size_t size)
+		{
+			while (Current < Blocks.size() && Blocks[Current].Used + size > Blocks[Current].Capacity)
+				Current++;
+
+			// Blocks are kept across ticks, this only allocates while the arena grows
+			if (Current == Blocks.size())
+			{
+				const size_t capacity = size > BlockSize ? size : BlockSize;
+				Blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[capacity]), capacity, 0 });
+				ArenaBytes.fetch_add(capacity, std::memory_order_relaxed);
+			}
+
+			Block &block = Blocks[Current];
+			uint8_t *data = block.Data.get() + block.Used;
+			block.Used += size;
+			return data;
+		}
+
+		void Reset()
+		{
+			for (size_t i = 0; i < Blocks.size(); i++)
+				Blocks[i].Used = 0;
+			Current = 0;
+		}
+	};
+
+	struct ThreadBuffer
+	{
+		// Epoch + 1 while the owner is recording into that epoch's arena, 0 otherwise
+		std::atomic<uint64_t> Writing{ 0 };
+		std::atomic<bool> InUse{ true };
+		Arena Arenas[2];
+		uint32_t Key = 0;
+	};
+
+	struct Entry
+	{
+		uint32_t Key;
+		const uint8_t *Record;
+	};
+
+	struct BufferState
+	{
+		std::atomic<uint64_t> Epoch{ 0 };
+
+		std::mutex Mutex;
+		std::vector<std::shared_ptr<ThreadBuffer>> Buffers;
+
+		// Tick thread only, reused so replay does not allocate once warmed up
+		std::vector<ThreadBuffer *> Snapshot;
+		std::vector<Entry> Entries;
+		CommandBufferStats Stats;
+	};
+
+	BufferState &State()
+	{
+		static BufferState state;
+		return state;
+	}
+
+	// Shares the buffer with the state so a thread exiting after the state is gone does not touch freed memory
+	struct ThreadHandle
+	{
+		std::shared_ptr<ThreadBuffer> Buffer;
+
+		~ThreadHandle()
+		{
+			if (Buffer)
+				Buffer->InUse.store(false, std::memory_order_release);
+		}
+	};
+
+	thread_local ThreadHandle Local;
+
+	ThreadBuffer &GetBuffer()
+	{
+		if (Local.Buffer)
+			return *Local.Buffer;
+
+		// Once per thread, buffers of exited threads are reused with whatever they still hold
+		BufferState &state = State();
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		for (size_t i = 0; i < state.Buffers.size() && !Local.Buffer; i++)
+		{
+			if (!state.Buffers[i]->InUse.load(std::memory_order_acquire))
+			{
+				Local.Buffer = state.Buffers[i];
+				Local.Buffer->InUse.store(true, std::memory_order_relaxed);
+				Local.Buffer->Key = 0;
+			}
+		}
+
+		if (!Local.Buffer)
+		{
+			Local.Buffer = std::make_shared<ThreadBuffer>();
+			state.Buffers.push_back(Local.Buffer);
+		}
+		return *Local.Buffer;
+	}
+
+	// Argument encoding
+	template <typename T>
+	size_t SizeOf(const T &)
+	{
+		static_assert(sizeof(T) % 4 == 0, "Arguments have to be padded to 4 bytes");
+		return sizeof(T);
+	}
+
+	size_t SizeOf(const CVector3 &)
+	{
+		return sizeof(float) * 3;
+	}
+
+	size_t SizeOf(const std::string_view value)
+	{
+		return sizeof(uint32_t) + Padded(value.size());
+	}
+
+	size_t SizeOf(const std::wstring_view value)
+	{
+		return sizeof(uint32_t) + Padded(value.size() * sizeof(wchar_t));
+	}
+
+	size_t SizeOf(const Payload &value)
+	{
+		return Padded(value.Size);
+	}
+
+	template <typename T>
+	void Write(uint8_t *&out, const T &value)
+	{
+		memcpy(out, &value, sizeof(T));
+		out += sizeof(T);
+	}
+
+	void Write(uint8_t *&out, const CVector3 &value)
+	{
+		const float components[3] = { value.x, value.y, value.z };
+		memcpy(out, components, sizeof(components));
+		out += sizeof(components);
+	}
+
+	template <typename C>
+	void WriteString(uint8_t *&out, const std::basic_string_view<C> value)
+	{
+		const uint32_t length = (uint32_t)value.size();
+		memcpy(out, &length, sizeof(length));
+		if (length)
+			memcpy(out + sizeof(length), value.data(), length * sizeof(C));
+		out += sizeof(length) + Padded(length * sizeof(C));
+	}
+
+	void Write(uint8_t *&out, const Payload &value)
+	{
+		if (value.Size)
+			memcpy(out, value.Data, value.Size);
+		out += Padded(value.Size);
+	}
+
+	void Write(uint8_t *&out, const std::string_view value)
+	{
+		WriteString(out, value);
+	}
+
+	void Write(uint8_t *&out, const std::wstring_view value)
+	{
+		WriteString(out, value);
+	}
+
+	template <typename... Args>
+	void Record(const Op operation, const int entity, const Args &... args)
+	{
+		const size_t size = (sizeof(Header) + (SizeOf(args) + ... + 0) + 7) & ~(size_t)7;
+		if (size > 0xFFFFFFFFu)
+			return;
+
+		BufferState &state = State();
+		ThreadBuffer &buffer = GetBuffer();
+
+		// Announce the epoch before writing, Replay waits for recorders of the epoch it takes
+		uint64_t epoch;
+		for (;;)
+		{
+			epoch = state.Epoch.load();
+			buffer.Writing.store(epoch + 1);
+			if (state.Epoch.load() == epoch)
+				break;
+			buffer.Writing.store(0, std::memory_order_relaxed);
+		}
+
+		uint8_t *out = buffer.Arenas[epoch & 1].Allocate(size);
+		const Header header = { (uint32_t)size, buffer.Key, operation, 0, entity };
+		Write(out, header);
+		(Write(out, args), ...);
+
+		buffer.Writing.store(0, std::memory_order_release);
+	}
+
+	int32_t Flag(const bool value)
+	{
+		return value ? 1 : 0;
+	}
+
+	class Reader
+	{
+	private:
+		const uint8_t *Position;
+
+	public:
+		explicit Reader(const uint8_t *position) : Position(position) {}
+
+		template <typename T>
+		T Get()
+		{
+			T value;
+			memcpy(&value, Position, sizeof(T));
+			Position += sizeof(T);
+			return value;
+		}
+
+		int Int()
+		{
+			return Get<int32_t>();
+		}
+
+		bool Bool()
+		{
+			return Get<int32_t>() != 0;
+		}
+
+		float Float()
+		{
+			return Get<float>();
+		}
+
+		CVector3 Vector()
+		{
+			const float x = Get<float>();
+			const float y = Get<float>();
+			const float z = Get<float>();
+			return CVector3(x, y, z);
+		}
+
+		StringRef String()
+		{
+			const uint32_t length = Get<uint32_t>();
+			const StringRef ref = { (const char *)Position, length };
+			Position += Padded(length);
+			return ref;
+		}
+
+		WStringRef WString()
+		{
+			const uint32_t length = Get<uint32_t>();
+			const WStringRef ref = { (const wchar_t *)Position, length };
+			Position += Padded(length * sizeof(wchar_t));
+			return ref;
+		}
+
+		const uint8_t *Data() const
+		{
+			return Position;
+		}
+	};
+
+	void Execute(const uint8_t *record)
+	{
+		Header header;
+		memcpy(&header, record, sizeof(header));
+		const int entity = header.Entity;
+		Reader in(record + sizeof(Header));
+
+		switch (header.Operation)
+		{
+		case Op::Call:
+		{
+			const CallTarget target = in.Get<CallTarget>();
+			in.Get<uint64_t>();
+			target.Function((void *)in.Data());
+			break;
+		}
+		case Op::Destroy:
+			// Same bookkeeping as the handles, owned entities go through the EntityManager so it stays in sync
+			if (EntityManager::IsOwned(entity))
+			{
+				EntityManager::Release(entity);
+				break;
+			}
+			EntityManager::Destroy(entity);
+			break;
+		case Op::SetPosition:
+			API::Entity::SetPosition(entity, in.Vector());
+			break;
+		case Op::SetRotation:
+			API::Entity::SetRotation(entity, in.Vector());
+			break;
+		case Op::SetViewDistance:
+			API::Entity::SetViewDistance(entity, in.Float());
+			break;
+		case Op::SetPedComponent:
+		{
+			const int componentid = in.Int();
+			API::Entity::SetPedComponent(entity, componentid, in.Get<PedComponent>());
+			break;
+		}
+		case Op::SetPedHeadBlend:
+			API::Entity::SetPedHeadBlend(entity, in.Get<PedHeadBlend>());
+			break;
+		case Op::SetPedHeadOverlay:
+		{
+			const int overlayid = in.Int();
+			API::Entity::SetPedHeadOverlay(entity, overlayid, in.Get<PedHeadOverlay>());
+			break;
+		}
+		case Op::SetPedProp:
+		{
+			const int componentid = in.Int();
+			API::Entity::SetPedProp(entity, componentid, in.Get<PedProp>());
+			break;
+		}
+		case Op::SetPedFaceFeature:
+		{
+			const int feature = in.Int();
+			API::Entity::SetPedFaceFeature(entity, feature, in.Float());
+			break;
+		}
+		case Op::SetModel:
+			API::Player::SetModel(entity, ToString(in.WString()));
+			break;
+		case Op::SetControllable:
+		{
+			const bool disablecontrols = in.Bool();
+			API::Player::SetControllable(entity, disablecontrols, in.Bool());
+			break;
+		}
+		case Op::SetTextureVariation:
+			API::Object::SetTextureVariation(entity, in.Int());
+			break;
+		case Op::SetColor:
+		{
+			const int layer = in.Int();
+			const int painttype = in.Int();
+			API::Vehicle::SetColor(entity, layer, painttype, in.Int());
+			break;
+		}
+		case Op::SetColorRgb:
+		{
+			const int layer = in.Int();
+			API::Vehicle::SetColor(entity, layer, in.Get<Color>());
+			break;
+		}
+		case Op::SetNumberPlate:
+		{
+			const WStringRef plate = in.WString();
+			API::Vehicle::SetNumberPlate(entity, ToString(plate));
+			PlateIndex::Set(entity, ToView(plate));
+			break;
+		}
+		case Op::SetMod:
+		{
+			const int modType = in.Int();
+			API::Vehicle::SetMod(entity, modType, in.Int());
+			break;
+		}
+		case Op::SetEngineState:
+			API::Vehicle::SetEngineState(entity, in.Bool());
+			break;
+		case Op::SetDoorsLockState:
+			API::Vehicle::SetDoorsLockState(entity, in.Int());
+			break;
+		case Op::SetDoorsLockStateForPlayer:
+		{
+			const int lockState = in.Int();
+			API::Vehicle::SetDoorsLockState(entity, lockState, in.Int());
+			break;
+		}
+		case Op::SetNumberPlateStyle:
+			API::Vehicle::SetNumberPlateStyle(entity, in.Int());
+			break;
+		case Op::SetExtra:
+		{
+			const int extra = in.Int();
+			API::Vehicle::SetExtra(entity, extra, in.Bool());
+			break;
+		}
+		case Op::ShowCheckpoint:
+			API::Checkpoint::Show(entity, in.Int());
+			break;
+		case Op::HideCheckpoint:
+			API::Checkpoint::Hide(entity, in.Int());
+			break;
+		case Op::SetCheckpointNearHeight:
+			API::Checkpoint::SetNearHeight(entity, in.Float());
+			break;
+		case Op::SetCheckpointFarHeight:
+			API::Checkpoint::SetFarHeight(entity, in.Float());
+			break;
+		case Op::ShowMessageAboveMap:
+		case Op::ShowMessageAboveMapToPlayer:
+		{
+			const WStringRef message = in.WString();
+			const WStringRef pic = in.WString();
+			const int icontype = in.Int();
+			const WStringRef sender = in.WString();
+			const WStringRef subject = in.WString();
+			if (header.Operation == Op::ShowMessageAboveMap)
+				API::Visual::ShowMessageAboveMap(ToString(message), ToString(pic), icontype, ToString(sender), ToString(subject));
+			else
+				API::Visual::ShowMessageAboveMapToPlayer(entity, ToString(message), ToString(pic), icontype, ToString(sender), ToString(subject));
+			break;
+		}
+		case Op::SendChatMessage:
+			API::Visual::SendChatMessage(ToString(in.String()));
+			break;
+		case Op::SendChatMessageToPlayer:
+			API::Visual::SendChatMessageToPlayer(entity, ToString(in.String()));
+			break;
+		case Op::ShowCursor:
+			API::Visual::ShowCursor(entity, in.Bool());
+			break;
+		case Op::SetTime:
+		{
+			const int hour = in.Int();
+			const int minute = in.Int();
+			API::World::SetTime(hour, minute, in.Int());
+			break;
+		}
+		case Op::SetWeather:
+			API::World::SetWeather(ToString(in.WString()));
+			break;
+		case Op::LoadIPL:
+			API::World::LoadIPL(ToString(in.WString()));
+			break;
+		case Op::LoadIPLForPlayer:
+			API::World::LoadIPL(entity, ToString(in.WString()));
+			break;
+		case Op::UnloadIPL:
+			API::World::UnloadIPL(ToString(in.WString()));
+			break;
+		case Op::UnloadIPLForPlayer:
+			API::World::UnloadIPL(entity, ToString(in.WString()));
+			break;
+		case Op::LoadURL:
+		{
+			const StringRef url = in.String();
+			const StringRef appcode = in.String();
+			API::CEF::LoadURL(entity, ToString(url), ToString(appcode), in.Bool());
+			break;
+		}
+		case Op::JavaScriptCall:
+			API::CEF::JavaScriptCall(entity, ToString(in.String()));
+			break;
+		case Op::PrintMessage:
+			API::Server::PrintMessage(ToString(in.WString()));
+			break;
+		}
+	}
+
+	void Collect(const Arena &arena, std::vector<Entry> &entries, bool &keyed)
+	{
+		for (size_t i = 0; i < arena.Blocks.size(); i++)
+		{
+			const Arena::Block &block = arena.Blocks[i];
+			size_t offset = 0;
+			while (offset < block.Used)
+			{
+				const uint8_t *record = block.Data.get() + offset;
+				Header header;
+				memcpy(&header, record, sizeof(header));
+				entries.push_back({ header.Key, record });
+				keyed |= header.Key != 0;
+				offset += header.Size;
+			}
+		}
+	}
+
+	// Moves to the next epoch and waits for the threads still recording into the previous one
+	uint64_t Swap(BufferState &state)
+	{
+		const uint64_t previous = state.Epoch.fetch_add(1);
+
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		state.Snapshot.clear();
+		for (size_t i = 0; i < state.Buffers.size(); i++)
+		{
+			ThreadBuffer *buffer = state.Buffers[i].get();
+			while (buffer->Writing.load() == previous + 1)
+				std::this_thread::yield();
+			state.Snapshot.push_back(buffer);
+		}
+		return previous;
+	}
+}
+
+void CommandBuffer::SetKey(const uint32_t key)
+{
+	GetBuffer().Key = key;
+}
+
+size_t CommandBuffer::Replay()
+{
+	BufferState &state = State();
+	const size_t side = (size_t)(Swap(state) & 1);
+
+	// Snapshot order is registration order, the stable sort keeps it (and the recording order) within a key
+	bool keyed = false;
+	state.Entries.clear();
+	for (size_t i = 0; i < state.Snapshot.size(); i++)
+		Collect(state.Snapshot[i]->Arenas[side], state.Entries, keyed);
+	if (keyed)
+		std::stable_sort(state.Entries.begin(), state.Entries.end(), [](const Entry &a, const Entry &b) { return a.Key < b.Key; });
+
+	// Commands recorded while replaying go to the next epoch
+	for (size_t i = 0; i < state.Entries.size(); i++)
+		Execute(state.Entries[i].Record);
+
+	for (size_t i = 0; i < state.Snapshot.size(); i++)
+		state.Snapshot[i]->Arenas[side].Reset();
+
+	const size_t replayed = state.Entries.size();
+	state.Stats.LastReplayed = replayed;
+	state.Stats.Replayed += replayed;
+	return replayed;
+}
+
+void CommandBuffer::Clear()
+{
+	// Two swaps so both arenas of every thread are out of reach of the recorders
+	BufferState &state = State();
+	for (size_t pass = 0; pass < 2; pass++)
+	{
+		const size_t side = (size_t)(Swap(state) & 1);
+		for (size_t i = 0; i < state.Snapshot.size(); i++)
+			state.Snapshot[i]->Arenas[side].Reset();
+	}
+}
+
+CommandBufferStats CommandBuffer::GetStats()
+{
+	BufferState &state = State();
+	CommandBufferStats stats = state.Stats;
+	stats.ArenaBytes = ArenaBytes.load(std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	stats.Threads = state.Buffers.size();
+	return stats;
+}
+
+void CommandBuffer::Call(DeferredCall call, const void *data, const size_t size)
+{
+	if (!call)
+		return;
+
+	const CallTarget target = { call };
+	const Payload payload = { data, data ? size : 0 };
+	Record(Op::Call, -1, target, (uint64_t)payload.Size, payload);
+}
+
+void CommandBuffer::Destroy(const int entity)
+{
+	Record(Op::Destroy, entity);
+}
+
+void CommandBuffer::SetPosition(const int entity, const CVector3 position)
+{
+	Record(Op::SetPosition, entity, position);
+}
+
+void CommandBuffer::SetRotation(const int entity, const CVector3 rotation)
+{
+	Record(Op::SetRotation, entity, rotation);
+}
+
+void CommandBuffer::SetViewDistance(const int entity, const float distance)
+{
+	Record(Op::SetViewDistance, entity, distance);
+}
+
+void CommandBuffer::SetPedComponent(const int entity, const int componentid, const PedComponent component)
+{
+	Record(Op::SetPedComponent, entity, componentid, component);
+}
+
+void CommandBuffer::SetPedHeadBlend(const int entity, const PedHeadBlend headblend)
+{
+	Record(Op::SetPedHeadBlend, entity, headblend);
+}
+
+void CommandBuffer::SetPedHeadOverlay(const int entity, const int overlayid, const PedHeadOverlay overlay)
+{
+	Record(Op::SetPedHeadOverlay, entity, overlayid, overlay);
+}
+
+void CommandBuffer::SetPedProp(const int entity, const int componentid, const PedProp prop)
+{
+	Record(Op::SetPedProp, entity, componentid, prop);
+}
+
+void CommandBuffer::SetPedFaceFeature(const int entity, const int feature, const float scale)
+{
+	Record(Op::SetPedFaceFeature, entity, feature, scale);
+}
+
+void CommandBuffer::SetModel(const int entity, const std::wstring_view model)
+{
+	Record(Op::SetModel, entity, model);
+}
+
+void CommandBuffer::SetControllable(const int entity, const bool disablecontrols, const bool frozen)
+{
+	Record(Op::SetControllable, entity, Flag(disablecontrols), Flag(frozen));
+}
+
+void CommandBuffer::SetTextureVariation(const int entity, const int textureindex)
+{
+	Record(Op::SetTextureVariation, entity, textureindex);
+}
+
+void CommandBuffer::SetColor(const int entity, const int layer, const int painttype, const int color)
+{
+	Record(Op::SetColor, entity, layer, painttype, color);
+}
+
+void CommandBuffer::SetColor(const int entity, const int layer, const Color color)
+{
+	Record(Op::SetColorRgb, entity, layer, color);
+}
+
+void CommandBuffer::SetNumberPlate(const int entity, const std::wstring_view plate)
+{
+	Record(Op::SetNumberPlate, entity, plate);
+}
+
+void CommandBuffer::SetMod(const int entity, const int modType, const int modIndex)
+{
+	Record(Op::SetMod, entity, modType, modIndex);
+}
+
+void CommandBuffer::SetEngineState(const int entity, const bool state)
+{
+	Record(Op::SetEngineState, entity, Flag(state));
+}
+
+void CommandBuffer::SetDoorsLockState(const int entity, const int state)
+{
+	Record(Op::SetDoorsLockState, entity, state);
+}
+
+void CommandBuffer::SetDoorsLockState(const int entity, const int state, const int player)
+{
+	Record(Op::SetDoorsLockStateForPlayer, entity, state, player);
+}
+
+void CommandBuffer::SetNumberPlateStyle(const int entity, const int style)
+{
+	Record(Op::SetNumberPlateStyle, entity, style);
+}
+
+void CommandBuffer::SetExtra(const int entity, const int extra, const bool toggle)
+{
+	Record(Op::SetExtra, entity, extra, Flag(toggle));
+}
+
+void CommandBuffer::ShowCheckpoint(const int checkpointentity, const int playerentity)
+{
+	Record(Op::ShowCheckpoint, checkpointentity, playerentity);
+}
+
+void CommandBuffer::HideCheckpoint(const int checkpointentity, const int playerentity)
+{
+	Record(Op::HideCheckpoint, checkpointentity, playerentity);
+}
+
+void CommandBuffer::SetCheckpointNearHeight(const int checkpointentity, const float height)
+{
+	Record(Op::SetCheckpointNearHeight, checkpointentity, height);
+}
+
+void CommandBuffer::SetCheckpointFarHeight(const int checkpointentity, const float height)
+{
+	Record(Op::SetCheckpointFarHeight, checkpointentity, height);
+}
+
+void CommandBuffer::ShowMessageAboveMap(const std::wstring_view message, const std::wstring_view pic, const int icontype, const std::wstring_view sender, const std::wstring_view subject)
+{
+	Record(Op::ShowMessageAboveMap, -1, message, pic, icontype, sender, subject);
+}
+
+void CommandBuffer::ShowMessageAboveMapToPlayer(const int entity, const std::wstring_view message, const std::wstring_view pic, const int icontype, const std::wstring_view sender, const std::wstring_view subject)
+{
+	Record(Op::ShowMessageAboveMapToPlayer, entity, message, pic, icontype, sender, subject);
+}
+
+void CommandBuffer::SendChatMessage(const std::string_view message)
+{
+	Record(Op::SendChatMessage, -1, message);
+}
+
+void CommandBuffer::SendChatMessageToPlayer(const int entity, const std::string_view message)
+{
+	Record(Op::SendChatMessageToPlayer, entity, message);
+}
+
+void CommandBuffer::ShowCursor(const int entity, const bool show)
+{
+	Record(Op::ShowCursor, entity, Flag(show));
+}
+
+void CommandBuffer::SetTime(const int hour, const int minute, const int second)
+{
+	Record(Op::SetTime, -1, hour, minute, second);
+}
+
+void CommandBuffer::SetWeather(const std::wstring_view weather)
+{
+	Record(Op::SetWeather, -1, weather);
+}
+
+void CommandBuffer::LoadIPL(const std::wstring_view ipl)
+{
+	Record(Op::LoadIPL, -1, ipl);
+}
+
+void CommandBuffer::LoadIPL(const int entity, const std::wstring_view ipl)
+{
+	Record(Op::LoadIPLForPlayer, entity, ipl);
+}
+
+void CommandBuffer::UnloadIPL(const std::wstring_view ipl)
+{
+	Record(Op::UnloadIPL, -1, ipl);
+}
+
+void CommandBuffer::UnloadIPL(const int entity, const std::wstring_view ipl)
+{
+	Record(Op::UnloadIPLForPlayer, entity, ipl);
+}
+
+void CommandBuffer::LoadURL(const int entity, const std::string_view url, const std::string_view appcode, const bool remote)
+{
+	Record(Op::LoadURL, entity, url, appcode, Flag(remote));
+}
+
+void CommandBuffer::JavaScriptCall(const int entity, const std::string_view call)
+{
+	Record(Op::JavaScriptCall, entity, call);
+}
+
+void CommandBuffer::PrintMessage(const std::wstring_view message)
+{
+	Record(Op::PrintMessage, -1, message);
+}
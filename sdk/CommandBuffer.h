@@ -0,0 +1,107 @@
+#pragma once
+
+typedef void (*DeferredCall)(void *data);
+
+struct CommandBufferStats
+{
+	// Threads that have recorded at least once
+	size_t Threads = 0;
+	size_t LastReplayed = 0;
+	uint64_t Replayed = 0;
+	// Arena memory held by all threads, it is kept between ticks
+	size_t ArenaBytes = 0;
+};
+
+/// <summary>
+/// Records API mutations from any thread and replays them on the tick thread.
+/// Every thread appends compact commands (strings included) to its own pair of arenas, one for the current
+/// tick and one being replayed, so recording never takes a lock. Replay is called once per tick from API_OnTick
+/// after the tasks have run and goes through the commands by key, then by thread, then in recording order.
+/// Set a key with SetKey (e.g. the loop index in a Parallel body) when the order across threads matters.
+/// </summary>
+class CommandBuffer
+{
+public:
+	/// <summary>
+	/// Sets the key the calling thread's following commands are sorted by (0 by default)
+	/// </summary>
+	static void SetKey(const uint32_t key);
+
+	/// <summary>
+	/// Replays every command recorded before the call, tick thread only
+	/// </summary>
+	/// <returns name="replayed">The number of commands replayed</returns>
+	static size_t Replay();
+
+	/// <summary>
+	/// Drops every recorded command without replaying it
+	/// </summary>
+	static void Clear();
+
+	static CommandBufferStats GetStats();
+
+	/// <summary>
+	/// Records a call of a plugin function on the tick thread, size bytes of data are copied and passed to it
+	/// </summary>
+	static void Call(DeferredCall call, const void *data, const size_t size);
+
+	// Entity
+	/// <summary>
+	/// Destroys an entity, entities owned by a handle are released to the EntityManager instead
+	/// </summary>
+	static void Destroy(const int entity);
+	static void SetPosition(const int entity, const CVector3 position);
+	static void SetRotation(const int entity, const CVector3 rotation);
+	static void SetViewDistance(const int entity, const float distance);
+	static void SetPedComponent(const int entity, const int componentid, const PedComponent component);
+	static void SetPedHeadBlend(const int entity, const PedHeadBlend headblend);
+	static void SetPedHeadOverlay(const int entity, const int overlayid, const PedHeadOverlay overlay);
+	static void SetPedProp(const int entity, const int componentid, const PedProp prop);
+	static void SetPedFaceFeature(const int entity, const int feature, const float scale);
+
+	// Player
+	static void SetModel(const int entity, const std::wstring_view model);
+	static void SetControllable(const int entity, const bool disablecontrols, const bool frozen = true);
+
+	// Object
+	static void SetTextureVariation(const int entity, const int textureindex);
+
+	// Vehicle
+	static void SetColor(const int entity, const int layer, const int painttype, const int color);
+	static void SetColor(const int entity, const int layer, const Color color);
+	static void SetNumberPlate(const int entity, const std::wstring_view plate);
+	static void SetMod(const int entity, const int modType, const int modIndex);
+	static void SetEngineState(const int entity, const bool state);
+	static void SetDoorsLockState(const int entity, const int state);
+	static void SetDoorsLockState(const int entity, const int state, const int player);
+	static void SetNumberPlateStyle(const int entity, const int style);
+	static void SetExtra(const int entity, const int extra, const bool toggle);
+
+	// Checkpoint
+	static void ShowCheckpoint(const int checkpointentity, const int playerentity);
+	static void HideCheckpoint(const int checkpointentity, const int playerentity);
+	static void SetCheckpointNearHeight(const int checkpointentity, const float height);
+	static void SetCheckpointFarHeight(const int checkpointentity, const float height);
+
+	// Visual
+	static void ShowMessageAboveMap(const std::wstring_view message, const std::wstring_view pic, const int icontype, const std::wstring_view sender, const std::wstring_view subject);
+	static void ShowMessageAboveMapToPlayer(const int entity, const std::wstring_view message, const std::wstring_view pic, const int icontype, const std::wstring_view sender, const std::wstring_view subject);
+	static void SendChatMessage(const std::string_view message);
+	static void SendChatMessageToPlayer(const int entity, const std::string_view message);
+	static void ShowCursor(const int entity, const bool show);
+
+	// World
+	static void SetTime(const int hour, const int minute, const int second);
+	static void SetWeather(const std::wstring_view weather);
+	static void LoadIPL(const std::wstring_view ipl);
+	static void LoadIPL(const int entity, const std::wstring_view ipl);
+	static void UnloadIPL(const std::wstring_view ipl);
+	static void UnloadIPL(const int entity, const std::wstring_view ipl);
+
+	// Cef
+	static void LoadURL(const int entity, const std::string_view url, const std::string_view appcode = "", const bool remote = false);
+	static void JavaScriptCall(const int entity, const std::string_view call);
+
+	// Server
+	static void PrintMessage(const std::wstring_view message);
+};
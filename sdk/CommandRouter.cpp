@@ -0,0 +1,478 @@
+/**
+File:
+	CommandRouter.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <charconv>
+#include <chrono>
+#include <unordered_map>
+
+namespace
+{
+	const size_t MaxNameLength = 64;
+	const int32_t EmptySlot = -1;
+	const int32_t RemovedSlot = -2;
+
+	struct Command
+	{
+		CommandHandler Handler;
+		void *Context;
+		uint32_t Cooldown;
+		std::string Name;
+		std::string Usage;
+	};
+
+	struct NameSlot
+	{
+		uint64_t Hash;
+		int32_t Command;
+		std::string Name;
+	};
+
+	struct PlayerName
+	{
+		int Entity;
+		std::string Name;
+	};
+
+	struct RouterState
+	{
+		std::vector<Command> Commands;
+		std::vector<uint32_t> FreeCommands;
+		size_t CommandCount = 0;
+
+		// Names and aliases, open addressing with linear probing
+		std::vector<NameSlot> Slots = std::vector<NameSlot>(64, NameSlot{ 0, EmptySlot, std::string() });
+		size_t Used = 0;
+
+		// Last use in milliseconds per player and command
+		std::unordered_map<uint64_t, int64_t> LastUse;
+		std::vector<PlayerName> Players;
+	};
+
+	RouterState &State()
+	{
+		static RouterState state;
+		return state;
+	}
+
+	char Lower(const char c)
+	{
+		return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+	}
+
+	// Lower cases a name into buffer, false if it is empty or too long
+	bool Fold(const std::string_view name, char *buffer)
+	{
+		if (name.empty() || name.size() > MaxNameLength)
+			return false;
+		for (size_t i = 0; i < name.size(); i++)
+			buffer[i] = Lower(name[i]);
+		return true;
+	}
+
+	uint64_t Hash(const std::string_view folded)
+	{
+		uint64_t hash = 0xCBF29CE484222325ULL;
+		for (size_t i = 0; i < folded.size(); i++)
+			hash = (hash ^ (uint8_t)folded[i]) * 0x100000001B3ULL;
+		return hash;
+	}
+
+	// Finds the slot of a folded name, or the slot it would be inserted at
+	size_t FindSlot(const RouterState &state, const std::string_view folded, const uint64_t hash, bool &found)
+	{
+		const size_t mask = state.Slots.size() - 1;
+		size_t insert = SIZE_MAX;
+		for (size_t slot = (size_t)hash & mask;; slot = (slot + 1) & mask)
+		{
+			const NameSlot &entry = state.Slots[slot];
+			if (entry.Command == EmptySlot)
+			{
+				found = false;
+				return insert != SIZE_MAX ? insert : slot;
+			}
+			if (entry.Command == RemovedSlot)
+			{
+				if (insert == SIZE_MAX)
+					insert = slot;
+			}
+			else if (entry.Hash == hash && entry.Name == folded)
+			{
+				found = true;
+				return slot;
+			}
+		}
+	}
+
+	void Grow(RouterState &state)
+	{
+		std::vector<NameSlot> old(state.Slots.size() * 2, NameSlot{ 0, EmptySlot, std::string() });
+		old.swap(state.Slots);
+		state.Used = 0;
+
+		for (size_t i = 0; i < old.size(); i++)
+		{
+			if (old[i].Command < 0)
+				continue;
+			bool found;
+			state.Slots[FindSlot(state, old[i].Name, old[i].Hash, found)] = std::move(old[i]);
+			state.Used++;
+		}
+	}
+
+	bool AddName(RouterState &state, const std::string_view name, const int32_t command)
+	{
+		char buffer[MaxNameLength];
+		if (!Fold(name, buffer))
+			return false;
+
+		const std::string_view folded(buffer, name.size());
+		const uint64_t hash = Hash(folded);
+		bool found;
+		FindSlot(state, folded, hash, found);
+		if (found)
+			return false;
+
+		if ((state.Used + 1) * 2 > state.Slots.size())
+			Grow(state);
+
+		NameSlot &slot = state.Slots[FindSlot(state, folded, hash, found)];
+		if (slot.Command == EmptySlot)
+			state.Used++;
+		slot.Hash = hash;
+		slot.Command = command;
+		slot.Name.assign(folded);
+		return true;
+	}
+
+	int32_t FindCommand(const RouterState &state, const std::string_view name)
+	{
+		char buffer[MaxNameLength];
+		if (!Fold(name, buffer))
+			return EmptySlot;
+
+		const std::string_view folded(buffer, name.size());
+		bool found;
+		const size_t slot = FindSlot(state, folded, Hash(folded), found);
+		return found ? state.Slots[slot].Command : EmptySlot;
+	}
+
+	int64_t Milliseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	bool IsSpace(const char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+}
+
+CommandArgs::CommandArgs(const std::string_view text) : Text(text)
+{
+	size_t i = 0;
+	while (Count < MaxArgs)
+	{
+		while (i < text.size() && IsSpace(text[i]))
+			i++;
+		if (i >= text.size())
+			break;
+
+		size_t start = i;
+		if (text[i] == '"')
+		{
+			start = ++i;
+			while (i < text.size() && text[i] != '"')
+				i++;
+			Args[Count++] = text.substr(start, i - start);
+			i++;
+		}
+		else
+		{
+			while (i < text.size() && !IsSpace(text[i]))
+				i++;
+			Args[Count++] = text.substr(start, i - start);
+		}
+	}
+}
+
+std::string_view CommandArgs::GetRest(const size_t index) const
+{
+	if (index >= Count)
+		return std::string_view();
+
+	size_t start = (size_t)(Args[index].data() - Text.data());
+	if (start > 0 && Text[start - 1] == '"')
+		start--;
+
+	size_t end = Text.size();
+	while (end > start && IsSpace(Text[end - 1]))
+		end--;
+	return Text.substr(start, end - start);
+}
+
+bool CommandArgs::GetInt(const size_t index, int &value) const
+{
+	if (index >= Count)
+		return false;
+
+	const std::string_view arg = Args[index];
+	const char *begin = arg.data() + (!arg.empty() && arg[0] == '+' ? 1 : 0);
+	const std::from_chars_result result = std::from_chars(begin, arg.data() + arg.size(), value);
+	return result.ec == std::errc() && result.ptr == arg.data() + arg.size();
+}
+
+bool CommandArgs::GetFloat(const size_t index, float &value) const
+{
+	if (index >= Count)
+		return false;
+
+	const std::string_view arg = Args[index];
+	const char *begin = arg.data() + (!arg.empty() && arg[0] == '+' ? 1 : 0);
+	const std::from_chars_result result = std::from_chars(begin, arg.data() + arg.size(), value);
+	return result.ec == std::errc() && result.ptr == arg.data() + arg.size();
+}
+
+bool CommandArgs::GetEntity(const size_t index, int &entity) const
+{
+	int value;
+	if (!GetInt(index, value) || value < 0)
+		return false;
+
+	entity = value;
+	return true;
+}
+
+bool CommandArgs::GetPlayer(const size_t index, int &entity) const
+{
+	if (index >= Count)
+		return false;
+
+	// A number is an entity id if it belongs to a player, otherwise it is part of a name
+	int value;
+	if (GetEntity(index, value))
+	{
+		const std::vector<PlayerName> &players = State().Players;
+		for (size_t i = 0; i < players.size(); i++)
+		{
+			if (players[i].Entity == value)
+			{
+				entity = value;
+				return true;
+			}
+		}
+	}
+
+	const int found = CommandRouter::FindPlayer(Args[index]);
+	if (found == -1)
+		return false;
+
+	entity = found;
+	return true;
+}
+
+bool CommandRouter::Register(const std::string_view name, CommandHandler handler, void *context, const uint32_t cooldown, const std::string_view usage)
+{
+	RouterState &state = State();
+	if (!handler || FindCommand(state, name) != EmptySlot)
+		return false;
+
+	int32_t index;
+	if (!state.FreeCommands.empty())
+	{
+		index = (int32_t)state.FreeCommands.back();
+		state.FreeCommands.pop_back();
+	}
+	else
+	{
+		index = (int32_t)state.Commands.size();
+		state.Commands.push_back(Command());
+	}
+
+	if (!AddName(state, name, index))
+	{
+		state.FreeCommands.push_back((uint32_t)index);
+		return false;
+	}
+
+	Command &command = state.Commands[index];
+	command.Handler = handler;
+	command.Context = context;
+	command.Cooldown = cooldown;
+	command.Name.assign(name);
+	command.Usage.assign(usage);
+	state.CommandCount++;
+	return true;
+}
+
+bool CommandRouter::Alias(const std::string_view alias, const std::string_view name)
+{
+	RouterState &state = State();
+	const int32_t command = FindCommand(state, name);
+	if (command < 0)
+		return false;
+	return AddName(state, alias, command);
+}
+
+void CommandRouter::Unregister(const std::string_view name)
+{
+	RouterState &state = State();
+	const int32_t command = FindCommand(state, name);
+	if (command < 0)
+		return;
+
+	// Removes the name and every alias pointing at the command
+	for (size_t i = 0; i < state.Slots.size(); i++)
+	{
+		if (state.Slots[i].Command == command)
+		{
+			state.Slots[i].Command = RemovedSlot;
+			state.Slots[i].Name.clear();
+		}
+	}
+
+	for (std::unordered_map<uint64_t, int64_t>::iterator it = state.LastUse.begin(); it != state.LastUse.end();)
+	{
+		if ((uint32_t)it->first == (uint32_t)command)
+			it = state.LastUse.erase(it);
+		else
+			++it;
+	}
+
+	state.Commands[command] = Command();
+	state.FreeCommands.push_back((uint32_t)command);
+	state.CommandCount--;
+}
+
+CommandResult CommandRouter::Dispatch(const int entity, const std::string_view message)
+{
+	RouterState &state = State();
+
+	size_t start = 0;
+	while (start < message.size() && IsSpace(message[start]))
+		start++;
+	if (start < message.size() && message[start] == '/')
+		start++;
+
+	size_t end = start;
+	while (end < message.size() && !IsSpace(message[end]))
+		end++;
+	if (end == start)
+		return CommandResult::Empty;
+
+	const int32_t index = FindCommand(state, message.substr(start, end - start));
+	if (index < 0)
+		return CommandResult::Unknown;
+
+	// Copied, the handler may register or unregister commands
+	const Command &command = state.Commands[index];
+	const CommandHandler handler = command.Handler;
+	void *context = command.Context;
+
+	const uint64_t key = ((uint64_t)(uint32_t)entity << 32) | (uint32_t)index;
+	int64_t now = 0;
+	if (command.Cooldown)
+	{
+		now = Milliseconds();
+		std::unordered_map<uint64_t, int64_t>::const_iterator last = state.LastUse.find(key);
+		if (last != state.LastUse.end() && now - last->second < (int64_t)command.Cooldown)
+		{
+			std::ostringstream wait;
+			wait << "Please wait " << (command.Cooldown - (now - last->second) + 999) / 1000 << "s before using /" << command.Name << " again";
+			API::Visual::SendChatMessageToPlayer(entity, wait.str());
+			return CommandResult::Cooldown;
+		}
+	}
+
+	const uint32_t cooldown = command.Cooldown;
+	if (!handler(context, entity, CommandArgs(message.substr(end))))
+	{
+		// Looked up again, the handler may have unregistered the command
+		if ((size_t)index < state.Commands.size() && state.Commands[index].Handler == handler && !state.Commands[index].Usage.empty())
+			API::Visual::SendChatMessageToPlayer(entity, "Usage: " + state.Commands[index].Usage);
+		return CommandResult::InvalidUsage;
+	}
+
+	if (cooldown)
+		state.LastUse[key] = now;
+	return CommandResult::Handled;
+}
+
+bool CommandRouter::OnPlayerCommand(void *context, const PlayerCommandEvent &event)
+{
+	(void)context;
+	const CommandResult result = Dispatch(event.Entity, ToView(event.Message));
+	return result == CommandResult::Unknown || result == CommandResult::Empty;
+}
+
+void CommandRouter::AddPlayer(const int entity)
+{
+	RouterState &state = State();
+	RemovePlayer(entity);
+
+	PlayerName player;
+	player.Entity = entity;
+	player.Name = API::Player::GetUsername(entity);
+	for (size_t i = 0; i < player.Name.size(); i++)
+		player.Name[i] = Lower(player.Name[i]);
+	state.Players.push_back(player);
+}
+
+void CommandRouter::RemovePlayer(const int entity)
+{
+	RouterState &state = State();
+	for (size_t i = 0; i < state.Players.size(); i++)
+	{
+		if (state.Players[i].Entity == entity)
+		{
+			state.Players[i] = state.Players.back();
+			state.Players.pop_back();
+			break;
+		}
+	}
+
+	for (std::unordered_map<uint64_t, int64_t>::iterator it = state.LastUse.begin(); it != state.LastUse.end();)
+	{
+		if ((int)(it->first >> 32) == entity)
+			it = state.LastUse.erase(it);
+		else
+			++it;
+	}
+}
+
+int CommandRouter::FindPlayer(const std::string_view prefix)
+{
+	const RouterState &state = State();
+	if (prefix.empty())
+		return -1;
+
+	int found = -1;
+	size_t matches = 0;
+	for (size_t i = 0; i < state.Players.size(); i++)
+	{
+		const std::string &name = state.Players[i].Name;
+		if (name.size() < prefix.size())
+			continue;
+
+		size_t j = 0;
+		while (j < prefix.size() && name[j] == Lower(prefix[j]))
+			j++;
+		if (j < prefix.size())
+			continue;
+
+		if (name.size() == prefix.size())
+			return state.Players[i].Entity;
+
+		found = state.Players[i].Entity;
+		matches++;
+	}
+	return matches == 1 ? found : -1;
+}
+
+size_t CommandRouter::GetCommandCount()
+{
+	return State().CommandCount;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+/// <summary>
+/// The arguments of a command, views into the player's message that are only valid during the handler call.
+/// Arguments are split on spaces, "quoted arguments" keep their spaces.
+/// </summary>
+class CommandArgs
+{
+public:
+	static const size_t MaxArgs = 16;
+
+private:
+	std::string_view Args[MaxArgs];
+	size_t Count = 0;
+	std::string_view Text;
+
+public:
+	CommandArgs() { }
+	explicit CommandArgs(const std::string_view text);
+
+	const size_t GetCount() const { return Count; }
+	std::string_view operator[](const size_t index) const { return index < Count ? Args[index] : std::string_view(); }
+
+	/// <summary>
+	/// Gets the unsplit text starting at an argument, for commands that take a free text message
+	/// </summary>
+	std::string_view GetRest(const size_t index) const;
+
+	/// <summary>
+	/// Parses an argument, the whole argument has to be a number
+	/// </summary>
+	/// <returns name="parsed">False if the argument is missing or not a number</returns>
+	bool GetInt(const size_t index, int &value) const;
+	bool GetFloat(const size_t index, float &value) const;
+
+	/// <summary>
+	/// Parses an entity id
+	/// </summary>
+	bool GetEntity(const size_t index, int &entity) const;
+
+	/// <summary>
+	/// Resolves a player by entity id or by a case insensitive prefix of the username
+	/// </summary>
+	/// <returns name="found">False if no player or more than one player matches</returns>
+	bool GetPlayer(const size_t index, int &entity) const;
+};
+
+/// <summary>
+/// Called with the player that sent the command and its arguments (without the command name)
+/// </summary>
+/// <returns name="valid">False to show the usage of the command to the player</returns>
+typedef bool (*CommandHandler)(void *context, const int entity, const CommandArgs &args);
+
+enum class CommandResult : uint8_t
+{
+	Handled,
+	InvalidUsage,
+	Cooldown,
+	Unknown,
+	Empty
+};
+
+/// <summary>
+/// Routes player commands to registered handlers.
+/// Names and aliases are ASCII case insensitive and looked up in an open addressing hash table,
+/// the message is tokenized into views without copying. Tick thread only.
+/// </summary>
+class CommandRouter
+{
+public:
+	/// <summary>
+	/// Registers a command
+	/// </summary>
+	/// <param name="name">The name without the slash</param>
+	/// <param name="handler">The handler</param>
+	/// <param name="context">Passed to the handler as is</param>
+	/// <param name="cooldown">Milliseconds a player has to wait between two uses, 0 for none</param>
+	/// <param name="usage">Shown to the player when the handler returns false</param>
+	/// <returns name="registered">False if the name is already taken</returns>
+	static bool Register(const std::string_view name, CommandHandler handler, void *context = nullptr, const uint32_t cooldown = 0, const std::string_view usage = std::string_view());
+
+	/// <summary>
+	/// Adds another name for a registered command
+	/// </summary>
+	/// <returns name="added">False if the command does not exist or the alias is already taken</returns>
+	static bool Alias(const std::string_view alias, const std::string_view name);
+
+	/// <summary>
+	/// Removes a command and its aliases
+	/// </summary>
+	static void Unregister(const std::string_view name);
+
+	/// <summary>
+	/// Runs the command in a message, with or without the leading slash
+	/// </summary>
+	/// <param name="entity">The player</param>
+	/// <param name="message">The message</param>
+	static CommandResult Dispatch(const int entity, const std::string_view message);
+
+	/// <summary>
+	/// EventBus handler for PlayerCommandEvent, stops the event when the command was known
+	/// </summary>
+	static bool OnPlayerCommand(void *context, const PlayerCommandEvent &event);
+
+	/// <summary>
+	/// Caches the username of a player for prefix matching, call when the player connects
+	/// </summary>
+	static void AddPlayer(const int entity);
+
+	/// <summary>
+	/// Removes a player from the username cache and clears its cooldowns
+	/// </summary>
+	static void RemovePlayer(const int entity);
+
+	/// <summary>
+	/// Resolves a player by a case insensitive username prefix, an exact match wins over prefixes
+	/// </summary>
+	/// <returns name="entity">The player, -1 if none or more than one player matches</returns>
+	static int FindPlayer(const std::string_view prefix);
+
+	static size_t GetCommandCount();
+};
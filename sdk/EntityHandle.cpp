@@ -0,0 +1,165 @@
+/**
+File:
+	EntityHandle.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+	const wchar_t *const TypeNames[(size_t)EntityType::Count] = { L"vehicle", L"npc", L"object", L"checkpoint" };
+
+	struct EntityState
+	{
+		std::mutex Mutex;
+		std::unordered_map<int, EntityType> Owned;
+		std::vector<int> Queue;
+		std::vector<int> Destroying;
+		size_t OwnedCount[(size_t)EntityType::Count] = {};
+		bool Closed = false;
+	};
+
+	EntityState &State()
+	{
+		static EntityState state;
+		return state;
+	}
+
+	// Every index that may still hold the id has to let go before the server can reuse it
+	void DestroyNow(const int entity)
+	{
+		PlateIndex::Remove(entity);
+		VehicleCollector::Untrack(entity);
+		EntityPool::Forget(entity);
+		API::Entity::Destroy(entity);
+	}
+}
+
+void EntityManager::Track(const int entity, const EntityType type)
+{
+	EntityState &state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	if (state.Closed)
+		return;
+
+	if (state.Owned.emplace(entity, type).second)
+		state.OwnedCount[(size_t)type]++;
+}
+
+void EntityManager::Untrack(const int entity)
+{
+	EntityState &state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+
+	std::unordered_map<int, EntityType>::iterator it = state.Owned.find(entity);
+	if (it == state.Owned.end())
+		return;
+
+	state.OwnedCount[(size_t)it->second]--;
+	state.Owned.erase(it);
+}
+
+void EntityManager::Destroy(const int entity)
+{
+	if (entity == -1)
+		return;
+
+	// Shutdown would destroy it again otherwise, possibly after the server reused the id
+	Untrack(entity);
+	DestroyNow(entity);
+}
+
+void EntityManager::Release(const int entity)
+{
+	EntityState &state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+
+	// Entities that are not owned were either never tracked or already destroyed by Shutdown
+	std::unordered_map<int, EntityType>::iterator it = state.Owned.find(entity);
+	if (it == state.Owned.end())
+		return;
+
+	state.OwnedCount[(size_t)it->second]--;
+	state.Owned.erase(it);
+	state.Queue.push_back(entity);
+}
+
+size_t EntityManager::Flush()
+{
+	EntityState &state = State();
+	{
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		if (state.Queue.empty())
+			return 0;
+		state.Destroying.swap(state.Queue);
+	}
+
+	// Destroy outside the lock so releases from other threads never wait on the server
+	for (size_t i = 0; i < state.Destroying.size(); i++)
+		DestroyNow(state.Destroying[i]);
+
+	const size_t destroyed = state.Destroying.size();
+	state.Destroying.clear();
+	return destroyed;
+}
+
+void EntityManager::Initialize()
+{
+	EntityState &state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	state.Closed = false;
+}
+
+size_t EntityManager::Shutdown()
+{
+	Flush();
+
+	EntityState &state = State();
+	std::unordered_map<int, EntityType> owned;
+	size_t counts[(size_t)EntityType::Count];
+	{
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		owned.swap(state.Owned);
+		memcpy(counts, state.OwnedCount, sizeof(counts));
+		memset(state.OwnedCount, 0, sizeof(state.OwnedCount));
+		state.Closed = true;
+	}
+
+	for (std::unordered_map<int, EntityType>::const_iterator it = owned.begin(); it != owned.end(); ++it)
+		DestroyNow(it->first);
+
+	if (!owned.empty())
+	{
+		std::wostringstream report;
+		report << L"Destroyed " << owned.size() << L" leaked entity handles (";
+		for (size_t i = 0; i < (size_t)EntityType::Count; i++)
+			report << (i ? L", " : L"") << counts[i] << L" " << TypeNames[i];
+		report << L")";
+		API::Server::PrintMessage(report.str());
+	}
+	return owned.size();
+}
+
+bool EntityManager::IsOwned(const int entity)
+{
+	EntityState &state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	return state.Owned.find(entity) != state.Owned.end();
+}
+
+size_t EntityManager::GetOwnedCount(const EntityType type)
+{
+	EntityState &state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	return state.OwnedCount[(size_t)type];
+}
+
+size_t EntityManager::GetQueuedCount()
+{
+	EntityState &state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	return state.Queue.size();
+}
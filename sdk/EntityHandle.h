@@ -0,0 +1,121 @@
+#pragma once
+
+/// <summary>
+/// Move-only owning handle around a wrapper class (Vehicle, NPC, Object or Checkpoint).
+/// The entity is queued for destruction when the handle goes out of scope.
+/// </summary>
+template <typename T, EntityType Type>
+class UniqueEntity
+{
+private:
+	T Wrapper;
+
+public:
+	UniqueEntity() { Wrapper.SetEntity(-1); }
+
+	// Takes ownership of an existing entity
+	explicit UniqueEntity(const int entity)
+	{
+		Wrapper.SetEntity(entity);
+		if (entity != -1)
+			EntityManager::Track(entity, Type);
+	}
+
+	UniqueEntity(UniqueEntity &&other) : Wrapper(other.Wrapper) { other.Wrapper.SetEntity(-1); }
+
+	UniqueEntity &operator=(UniqueEntity &&other)
+	{
+		if (this != &other)
+		{
+			Reset();
+			Wrapper = other.Wrapper;
+			other.Wrapper.SetEntity(-1);
+		}
+		return *this;
+	}
+
+	UniqueEntity(const UniqueEntity &) = delete;
+	UniqueEntity &operator=(const UniqueEntity &) = delete;
+
+	~UniqueEntity() { Reset(); }
+
+	/// <summary>
+	/// Creates the entity through the wrappers Create function and takes ownership of it
+	/// </summary>
+	template <typename... Args>
+	static UniqueEntity Create(Args &&... args)
+	{
+		UniqueEntity handle;
+		handle.Wrapper.Create(std::forward<Args>(args)...);
+		if (handle.GetEntity() != -1)
+			EntityManager::Track(handle.GetEntity(), Type);
+		return handle;
+	}
+
+	/// <summary>
+	/// Queues the entity for destruction and empties the handle
+	/// </summary>
+	void Reset()
+	{
+		const int entity = Wrapper.GetEntity();
+		if (entity != -1)
+		{
+			EntityManager::Release(entity);
+			Wrapper.SetEntity(-1);
+		}
+	}
+
+	/// <summary>
+	/// Gives up ownership without destroying the entity
+	/// </summary>
+	/// <returns name="entity">The entity</returns>
+	int Detach()
+	{
+		const int entity = Wrapper.GetEntity();
+		if (entity != -1)
+			EntityManager::Untrack(entity);
+		Wrapper.SetEntity(-1);
+		return entity;
+	}
+
+	const int GetEntity() { return Wrapper.GetEntity(); }
+	explicit operator bool() { return Wrapper.GetEntity() != -1; }
+
+	T *operator->() { return &Wrapper; }
+	T &operator*() { return Wrapper; }
+};
+
+/// <summary>
+/// Reference counted owning handle, the entity is queued for destruction when the last copy goes away.
+/// Copies of the plain wrapper classes (e.g. from Get) are the non-owning counterpart.
+/// </summary>
+template <typename T, EntityType Type>
+class SharedEntity
+{
+private:
+	std::shared_ptr<UniqueEntity<T, Type>> Handle;
+
+public:
+	SharedEntity() { }
+	SharedEntity(UniqueEntity<T, Type> &&handle) : Handle(std::make_shared<UniqueEntity<T, Type>>(std::move(handle))) { }
+
+	const int GetEntity() const { return Handle ? Handle->GetEntity() : -1; }
+	explicit operator bool() const { return GetEntity() != -1; }
+	const long GetUseCount() const { return Handle.use_count(); }
+
+	// Non-owning copy of the wrapper
+	T Get() const { return Handle ? **Handle : T(); }
+
+	T *operator->() const { return &**Handle; }
+	void Reset() { Handle.reset(); }
+};
+
+typedef UniqueEntity<Vehicle, EntityType::Vehicle> UniqueVehicle;
+typedef UniqueEntity<NPC, EntityType::NPC> UniqueNPC;
+typedef UniqueEntity<Object, EntityType::Object> UniqueObject;
+typedef UniqueEntity<Checkpoint, EntityType::Checkpoint> UniqueCheckpoint;
+
+typedef SharedEntity<Vehicle, EntityType::Vehicle> SharedVehicle;
+typedef SharedEntity<NPC, EntityType::NPC> SharedNPC;
+typedef SharedEntity<Object, EntityType::Object> SharedObject;
+typedef SharedEntity<Checkpoint, EntityType::Checkpoint> SharedCheckpoint;
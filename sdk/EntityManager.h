@@ -0,0 +1,76 @@
+#pragma once
+
+enum class EntityType : uint8_t
+{
+	Vehicle,
+	NPC,
+	Object,
+	Checkpoint,
+	Count
+};
+
+/// <summary>
+/// Keeps track of the entities owned by the plugin's handles.
+/// Released entities are queued and destroyed in one batch at the end of the tick.
+/// </summary>
+class EntityManager
+{
+public:
+	/// <summary>
+	/// Marks an entity as owned by the plugin
+	/// </summary>
+	/// <param name="entity">The entity</param>
+	/// <param name="type">The type of the entity</param>
+	static void Track(const int entity, const EntityType type);
+
+	/// <summary>
+	/// Stops tracking an entity without destroying it
+	/// </summary>
+	/// <param name="entity">The entity</param>
+	static void Untrack(const int entity);
+
+	/// <summary>
+	/// Destroys an entity now, an owned one stops being owned first. The wrappers' Destroy go through this.
+	/// </summary>
+	/// <param name="entity">The entity</param>
+	static void Destroy(const int entity);
+
+	/// <summary>
+	/// Queues an owned entity for destruction at the next Flush. Can be called from any thread.
+	/// </summary>
+	/// <param name="entity">The entity</param>
+	static void Release(const int entity);
+
+	/// <summary>
+	/// Destroys all queued entities, call once at the end of every tick
+	/// </summary>
+	/// <returns name="destroyed">The number of entities destroyed</returns>
+	static size_t Flush();
+
+	/// <summary>
+	/// Accepts entities again after a Shutdown, call from API_Initialize
+	/// </summary>
+	static void Initialize();
+
+	/// <summary>
+	/// Destroys every queued and still owned entity in one pass and reports the owned ones as leaked.
+	/// Call from API_Close, releases after this are ignored until the next Initialize.
+	/// </summary>
+	/// <returns name="leaked">The number of entities that were still owned</returns>
+	static size_t Shutdown();
+
+	/// <summary>
+	/// Checks if an entity is owned by a handle
+	/// </summary>
+	static bool IsOwned(const int entity);
+
+	/// <summary>
+	/// Gets the number of owned entities of a type
+	/// </summary>
+	static size_t GetOwnedCount(const EntityType type);
+
+	/// <summary>
+	/// Gets the number of entities waiting for the next Flush
+	/// </summary>
+	static size_t GetQueuedCount();
+};
@@ -0,0 +1,295 @@
+/**
+File:
+	EntityPool.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <deque>
+#include <unordered_map>
+
+namespace
+{
+	const uint64_t VehicleKey = 1ULL << 56;
+	const uint64_t ObjectKey = 2ULL << 56;
+	const uint64_t CheckpointKey = 3ULL << 56;
+	const uint32_t HoldingRowSize = 64;
+
+	struct ParkedEntity
+	{
+		int Entity;
+		uint32_t Since;
+		uint32_t Slot;
+	};
+
+	struct PoolState;
+	void ResetFreeSlots(PoolState &state);
+
+	struct PoolState
+	{
+		PoolState() { ResetFreeSlots(*this); }
+
+		EntityPoolConfig Config;
+		EntityPoolStats Stats;
+		uint32_t Tick = 0;
+
+		// Parked entities per key, the most recently parked are reused first
+		std::unordered_map<uint64_t, std::deque<ParkedEntity>> Parked;
+		// Key of every entity handed out by the pool
+		std::unordered_map<int, uint64_t> Active;
+		std::vector<uint32_t> FreeSlots;
+	};
+
+	PoolState &State()
+	{
+		static PoolState state;
+		return state;
+	}
+
+	void ResetFreeSlots(PoolState &state)
+	{
+		state.FreeSlots.clear();
+		for (uint32_t slot = (uint32_t)state.Config.MaxTotal; slot > 0; slot--)
+			state.FreeSlots.push_back(slot - 1);
+	}
+
+	CVector3 HoldingPosition(const EntityPoolConfig &config, const uint32_t slot)
+	{
+		return CVector3(config.HoldingArea.x + (float)(slot % HoldingRowSize) * config.HoldingSpacing,
+			config.HoldingArea.y + (float)(slot / HoldingRowSize) * config.HoldingSpacing,
+			config.HoldingArea.z);
+	}
+
+	void DefaultResetVehicle(const int entity)
+	{
+		API::Vehicle::SetEngineState(entity, false);
+		API::Vehicle::SetDoorsLockState(entity, 1);
+	}
+
+	// Takes the most recently parked entity of a key, -1 on a miss
+	int TakeParked(PoolState &state, const uint64_t key)
+	{
+		std::unordered_map<uint64_t, std::deque<ParkedEntity>>::iterator it = state.Parked.find(key);
+		if (it == state.Parked.end() || it->second.empty())
+		{
+			state.Stats.Misses++;
+			return -1;
+		}
+
+		const ParkedEntity parked = it->second.back();
+		it->second.pop_back();
+		state.FreeSlots.push_back(parked.Slot);
+		state.Stats.Hits++;
+		state.Stats.Size--;
+		state.Active[parked.Entity] = key;
+		return parked.Entity;
+	}
+
+	uint64_t CheckpointPoolKey(const CVector3 &pointto, const int type, const float radius, const Color &color, const int reserved)
+	{
+		// FNV-1a over the creation parameters, checkpoints have no setters for them
+		const float floats[4] = { pointto.x, pointto.y, pointto.z, radius };
+		const int ints[6] = { type, reserved, color.Red, color.Green, color.Blue, color.Alpha };
+
+		uint64_t hash = 0xCBF29CE484222325ULL;
+		const uint8_t *bytes = (const uint8_t *)floats;
+		for (size_t i = 0; i < sizeof(floats); i++)
+			hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+		bytes = (const uint8_t *)ints;
+		for (size_t i = 0; i < sizeof(ints); i++)
+			hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+		return CheckpointKey | (hash & 0x00FFFFFFFFFFFFFFULL);
+	}
+}
+
+void EntityPool::Configure(const EntityPoolConfig &config)
+{
+	Clear();
+
+	PoolState &state = State();
+	state.Config = config;
+	ResetFreeSlots(state);
+}
+
+const EntityPoolConfig &EntityPool::GetConfig()
+{
+	return State().Config;
+}
+
+int EntityPool::AcquireVehicle(const uint32_t model, const CVector3 position, const CVector3 rotation)
+{
+	PoolState &state = State();
+	const uint64_t key = VehicleKey | model;
+
+	const int entity = TakeParked(state, key);
+	if (entity == -1)
+	{
+		const std::wstring *name = ModelNames::Find(model);
+		if (!name)
+			return -1;
+
+		const int created = API::Vehicle::Create(*name, position, rotation);
+		if (created == -1)
+			return -1;
+		state.Active[created] = key;
+		return created;
+	}
+
+	(state.Config.ResetVehicle ? state.Config.ResetVehicle : DefaultResetVehicle)(entity);
+	API::Entity::SetPosition(entity, position);
+	API::Entity::SetRotation(entity, rotation);
+	return entity;
+}
+
+int EntityPool::AcquireObject(const uint32_t model, const CVector3 position, const CVector3 rotation, const bool dynamic)
+{
+	PoolState &state = State();
+	const uint64_t key = ObjectKey | ((uint64_t)dynamic << 32) | model;
+
+	const int entity = TakeParked(state, key);
+	if (entity == -1)
+	{
+		const int created = API::Object::Create((int)model, position, rotation, dynamic);
+		if (created == -1)
+			return -1;
+		state.Active[created] = key;
+		return created;
+	}
+
+	if (state.Config.ResetObject)
+		state.Config.ResetObject(entity);
+	API::Entity::SetPosition(entity, position);
+	API::Entity::SetRotation(entity, rotation);
+	return entity;
+}
+
+int EntityPool::AcquireCheckpoint(const CVector3 position, const CVector3 pointto, const int type, const float radius, const Color color, const int reserved)
+{
+	PoolState &state = State();
+	const uint64_t key = CheckpointPoolKey(pointto, type, radius, color, reserved);
+
+	const int entity = TakeParked(state, key);
+	if (entity == -1)
+	{
+		const int created = API::Checkpoint::Create(position, pointto, type, radius, color, reserved);
+		if (created == -1)
+			return -1;
+		state.Active[created] = key;
+		return created;
+	}
+
+	API::Entity::SetPosition(entity, position);
+	API::Checkpoint::Show(entity, -1);
+	return entity;
+}
+
+void EntityPool::Forget(const int entity)
+{
+	State().Active.erase(entity);
+}
+
+bool EntityPool::IsActive(const int entity)
+{
+	return State().Active.count(entity) != 0;
+}
+
+bool EntityPool::Release(const int entity)
+{
+	PoolState &state = State();
+	std::unordered_map<int, uint64_t>::iterator active = state.Active.find(entity);
+	if (active == state.Active.end())
+		return false;
+
+	const uint64_t key = active->second;
+	state.Active.erase(active);
+
+	// Parked vehicles keep their plate on the server but are no longer findable by it,
+	// and the pool evicts them itself
+	PlateIndex::Remove(entity);
+	VehicleCollector::Untrack(entity);
+
+	std::deque<ParkedEntity> &parked = state.Parked[key];
+	if (parked.size() >= state.Config.MaxPerModel || state.FreeSlots.empty())
+	{
+		state.Stats.Rejected++;
+		API::Entity::Destroy(entity);
+		return false;
+	}
+
+	ParkedEntity record;
+	record.Entity = entity;
+	record.Since = state.Tick;
+	record.Slot = state.FreeSlots.back();
+	state.FreeSlots.pop_back();
+
+	if ((key >> 56) == (CheckpointKey >> 56))
+		API::Checkpoint::Hide(entity, -1);
+	else
+	{
+		API::Entity::SetPosition(entity, HoldingPosition(state.Config, record.Slot));
+		if ((key >> 56) == (VehicleKey >> 56))
+			API::Vehicle::SetEngineState(entity, false);
+	}
+
+	parked.push_back(record);
+	state.Stats.Parked++;
+	state.Stats.Size++;
+	return true;
+}
+
+void EntityPool::Tick()
+{
+	PoolState &state = State();
+	state.Tick++;
+
+	if (state.Config.IdleTicks == 0 || state.Stats.Size == 0)
+		return;
+
+	// The oldest parked entity of every pool is at the front
+	for (std::unordered_map<uint64_t, std::deque<ParkedEntity>>::iterator it = state.Parked.begin(); it != state.Parked.end(); ++it)
+	{
+		std::deque<ParkedEntity> &parked = it->second;
+		while (!parked.empty() && state.Tick - parked.front().Since >= state.Config.IdleTicks)
+		{
+			API::Entity::Destroy(parked.front().Entity);
+			state.FreeSlots.push_back(parked.front().Slot);
+			parked.pop_front();
+			state.Stats.Evicted++;
+			state.Stats.Size--;
+		}
+	}
+}
+
+void EntityPool::Clear()
+{
+	PoolState &state = State();
+	for (std::unordered_map<uint64_t, std::deque<ParkedEntity>>::iterator it = state.Parked.begin(); it != state.Parked.end(); ++it)
+	{
+		for (size_t i = 0; i < it->second.size(); i++)
+			API::Entity::Destroy(it->second[i].Entity);
+	}
+
+	state.Parked.clear();
+	state.Stats.Size = 0;
+	ResetFreeSlots(state);
+}
+
+EntityPoolStats EntityPool::GetStats()
+{
+	return State().Stats;
+}
+
+size_t EntityPool::GetParkedCount(const uint32_t model)
+{
+	PoolState &state = State();
+	const uint64_t keys[3] = { VehicleKey | model, ObjectKey | model, ObjectKey | (1ULL << 32) | model };
+
+	size_t count = 0;
+	for (size_t i = 0; i < 3; i++)
+	{
+		std::unordered_map<uint64_t, std::deque<ParkedEntity>>::const_iterator it = state.Parked.find(keys[i]);
+		if (it != state.Parked.end())
+			count += it->second.size();
+	}
+	return count;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+struct EntityPoolConfig
+{
+	// Maximum number of parked entities per pool key (model)
+	size_t MaxPerModel = 16;
+	// Maximum number of parked entities over all pools
+	size_t MaxTotal = 512;
+	// Parked entities are destroyed after this many ticks without being reused (0 never evicts)
+	uint32_t IdleTicks = 6000;
+	// Parked vehicles and objects are moved around this position, out of sight
+	CVector3 HoldingArea = CVector3(0.0f, 0.0f, -500.0f);
+	// Spacing between parked entities in the holding area
+	float HoldingSpacing = 10.0f;
+
+	// Called when a vehicle is taken out of the pool, resets engine and locks by default
+	void (*ResetVehicle)(const int entity) = nullptr;
+	// Called when an object is taken out of the pool
+	void (*ResetObject)(const int entity) = nullptr;
+};
+
+struct EntityPoolStats
+{
+	uint64_t Hits = 0;
+	uint64_t Misses = 0;
+	uint64_t Parked = 0;
+	uint64_t Rejected = 0;
+	uint64_t Evicted = 0;
+	size_t Size = 0;
+
+	const double GetHitRate() const { return Hits + Misses ? (double)Hits / (double)(Hits + Misses) : 0.0; }
+};
+
+/// <summary>
+/// Per model pools of released vehicles, objects and checkpoints.
+/// Released entities are parked out of sight and reused by the next Acquire of the same model
+/// instead of being destroyed and created again. Tick thread only.
+/// </summary>
+class EntityPool
+{
+public:
+	static void Configure(const EntityPoolConfig &config);
+	static const EntityPoolConfig &GetConfig();
+
+	/// <summary>
+	/// Takes a vehicle out of the pool or creates it
+	/// </summary>
+	/// <param name="model">The model hash, the name has to be registered with ModelNames</param>
+	/// <param name="position">The position</param>
+	/// <param name="rotation">The rotation</param>
+	/// <returns name="entity">The vehicle entity, -1 if the model is unknown</returns>
+	static int AcquireVehicle(const uint32_t model, const CVector3 position, const CVector3 rotation);
+
+	/// <summary>
+	/// Takes an object out of the pool or creates it
+	/// </summary>
+	/// <param name="model">The model hash</param>
+	/// <param name="position">The position</param>
+	/// <param name="rotation">The rotation</param>
+	/// <param name="dynamic">If the object should be dynamic or not</param>
+	/// <returns name="entity">The object entity, -1 if it could not be created</returns>
+	static int AcquireObject(const uint32_t model, const CVector3 position, const CVector3 rotation, const bool dynamic);
+
+	/// <summary>
+	/// Takes a checkpoint out of the pool or creates it. Checkpoints can only be reused with the exact same parameters.
+	/// </summary>
+	/// <returns name="entity">The checkpoint entity shown to all players, -1 if it could not be created</returns>
+	static int AcquireCheckpoint(const CVector3 position, const CVector3 pointto, const int type, const float radius, const Color color, const int reserved);
+
+	/// <summary>
+	/// Parks an entity that was acquired from the pool, or destroys it if the pool is full.
+	/// Entities that were not acquired from the pool are left untouched.
+	/// </summary>
+	/// <param name="entity">The entity</param>
+	/// <returns name="parked">True if the entity was parked</returns>
+	static bool Release(const int entity);
+
+	/// <summary>
+	/// Drops an acquired entity that was destroyed elsewhere, so a later Release of its reused id is ignored.
+	/// The EntityManager calls this for everything it destroys.
+	/// </summary>
+	static void Forget(const int entity);
+
+	/// <summary>
+	/// Checks if an entity was acquired from the pool and not released yet
+	/// </summary>
+	static bool IsActive(const int entity);
+
+	/// <summary>
+	/// Evicts idle entities, call once per tick
+	/// </summary>
+	static void Tick();
+
+	/// <summary>
+	/// Destroys all parked entities
+	/// </summary>
+	static void Clear();
+
+	static EntityPoolStats GetStats();
+
+	/// <summary>
+	/// Gets the number of parked entities of a vehicle or object model
+	/// </summary>
+	static size_t GetParkedCount(const uint32_t model);
+};
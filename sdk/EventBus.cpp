@@ -0,0 +1,202 @@
+/**
+File:
+	EventBus.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <chrono>
+
+namespace
+{
+	struct BusState
+	{
+		EventBus::HandlerList Lists[(size_t)EventType::Count] = {};
+		uint32_t NextId = 0;
+		bool Profiling = true;
+	};
+
+	BusState &State()
+	{
+		static BusState state;
+		return state;
+	}
+
+	// Ids carry the event type in the top byte so Unsubscribe finds the list directly
+	EventType TypeOf(const uint32_t id)
+	{
+		return (EventType)(id >> 24);
+	}
+
+	bool HigherPriority(const EventBus::Handler &a, const EventBus::Handler &b)
+	{
+		return a.Priority > b.Priority;
+	}
+}
+
+uint32_t EventBus::Add(const EventType type, void (*function)(), void *context, const int priority, const char *name)
+{
+	BusState &state = State();
+	state.NextId = (state.NextId + 1) & 0xFFFFFF;
+	if (state.NextId == 0)
+		state.NextId = 1;
+
+	Handler handler = {};
+	handler.Function = function;
+	handler.Context = context;
+	handler.Priority = priority;
+	handler.Id = ((uint32_t)type << 24) | state.NextId;
+	handler.Name = name ? name : "";
+
+	HandlerList &list = List(type);
+	if (list.Dispatching)
+	{
+		list.Pending.push_back(handler);
+		list.Dirty = true;
+	}
+	else
+	{
+		// Handlers with the same priority keep their subscription order
+		list.Handlers.insert(std::upper_bound(list.Handlers.begin(), list.Handlers.end(), handler, HigherPriority), handler);
+	}
+	return handler.Id;
+}
+
+void EventBus::Unsubscribe(const uint32_t id)
+{
+	if (id == 0 || TypeOf(id) >= EventType::Count)
+		return;
+
+	HandlerList &list = List(TypeOf(id));
+	for (size_t i = 0; i < list.Pending.size(); i++)
+	{
+		if (list.Pending[i].Id == id)
+		{
+			list.Pending.erase(list.Pending.begin() + i);
+			return;
+		}
+	}
+
+	for (size_t i = 0; i < list.Handlers.size(); i++)
+	{
+		if (list.Handlers[i].Id != id)
+			continue;
+
+		if (list.Dispatching)
+		{
+			list.Handlers[i].Function = nullptr;
+			list.Dirty = true;
+		}
+		else
+			list.Handlers.erase(list.Handlers.begin() + i);
+		return;
+	}
+}
+
+EventBus::HandlerList &EventBus::List(const EventType type)
+{
+	return State().Lists[(size_t)type];
+}
+
+void EventBus::Apply(HandlerList &list)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < list.Handlers.size(); i++)
+	{
+		if (list.Handlers[i].Function)
+			list.Handlers[kept++] = list.Handlers[i];
+	}
+	list.Handlers.resize(kept);
+
+	for (size_t i = 0; i < list.Pending.size(); i++)
+		list.Handlers.insert(std::upper_bound(list.Handlers.begin(), list.Handlers.end(), list.Pending[i], HigherPriority), list.Pending[i]);
+
+	list.Pending.clear();
+	list.Dirty = false;
+}
+
+uint64_t EventBus::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t EventBus::GetHandlerCount(const EventType type)
+{
+	const HandlerList &list = List(type);
+
+	size_t count = list.Pending.size();
+	for (size_t i = 0; i < list.Handlers.size(); i++)
+	{
+		if (list.Handlers[i].Function)
+			count++;
+	}
+	return count;
+}
+
+void EventBus::SetProfiling(const bool enabled)
+{
+	State().Profiling = enabled;
+}
+
+bool EventBus::IsProfiling()
+{
+	return State().Profiling;
+}
+
+std::vector<EventHandlerStats> EventBus::GetStats()
+{
+	std::vector<EventHandlerStats> stats;
+	for (size_t type = 0; type < (size_t)EventType::Count; type++)
+	{
+		const HandlerList &list = List((EventType)type);
+		for (size_t i = 0; i < list.Handlers.size(); i++)
+		{
+			const Handler &handler = list.Handlers[i];
+			if (!handler.Function)
+				continue;
+
+			EventHandlerStats entry;
+			entry.Name = handler.Name;
+			entry.Type = (EventType)type;
+			entry.Priority = handler.Priority;
+			entry.Calls = handler.Calls;
+			entry.TotalNanoseconds = handler.TotalNanoseconds;
+			entry.MaxNanoseconds = handler.MaxNanoseconds;
+			stats.push_back(entry);
+		}
+	}
+
+	std::sort(stats.begin(), stats.end(), [](const EventHandlerStats &a, const EventHandlerStats &b) { return a.TotalNanoseconds > b.TotalNanoseconds; });
+	return stats;
+}
+
+void EventBus::ResetStats()
+{
+	for (size_t type = 0; type < (size_t)EventType::Count; type++)
+	{
+		HandlerList &list = List((EventType)type);
+		for (size_t i = 0; i < list.Handlers.size(); i++)
+		{
+			list.Handlers[i].Calls = 0;
+			list.Handlers[i].TotalNanoseconds = 0;
+			list.Handlers[i].MaxNanoseconds = 0;
+		}
+	}
+}
+
+void EventBus::Clear()
+{
+	for (size_t type = 0; type < (size_t)EventType::Count; type++)
+	{
+		HandlerList &list = List((EventType)type);
+		list.Pending.clear();
+		if (list.Dispatching)
+		{
+			for (size_t i = 0; i < list.Handlers.size(); i++)
+				list.Handlers[i].Function = nullptr;
+			list.Dirty = true;
+		}
+		else
+			list.Handlers.clear();
+	}
+}
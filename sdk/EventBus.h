@@ -0,0 +1,210 @@
+#pragma once
+
+enum class EventType : uint8_t
+{
+	Tick,
+	Close,
+	PlayerConnecting,
+	PlayerConnected,
+	EntityEnterCheckpoint,
+	EntityExitCheckpoint,
+	PlayerCommand,
+	PlayerMessage,
+	PlayerReady,
+	Count
+};
+
+// Events dispatched by the exported API_ entry points, the string members point into the server's buffers
+// and are only valid during the dispatch
+struct TickEvent
+{
+	static const EventType Type = EventType::Tick;
+};
+
+struct CloseEvent
+{
+	static const EventType Type = EventType::Close;
+};
+
+struct PlayerConnectingEvent
+{
+	static const EventType Type = EventType::PlayerConnecting;
+	StringRef Guid;
+};
+
+struct PlayerConnectedEvent
+{
+	static const EventType Type = EventType::PlayerConnected;
+	int Entity;
+};
+
+struct EntityEnterCheckpointEvent
+{
+	static const EventType Type = EventType::EntityEnterCheckpoint;
+	int Checkpoint;
+	int Entity;
+};
+
+struct EntityExitCheckpointEvent
+{
+	static const EventType Type = EventType::EntityExitCheckpoint;
+	int Checkpoint;
+	int Entity;
+};
+
+struct PlayerCommandEvent
+{
+	static const EventType Type = EventType::PlayerCommand;
+	int Entity;
+	StringRef Message;
+};
+
+struct PlayerMessageEvent
+{
+	static const EventType Type = EventType::PlayerMessage;
+	int Entity;
+	StringRef Message;
+};
+
+// Dispatched by the JoinPipeline once every join stage of a player is done
+struct PlayerReadyEvent
+{
+	static const EventType Type = EventType::PlayerReady;
+	int Entity;
+	// From API_OnPlayerConnecting (or API_OnPlayerConnected if it was not seen) to now
+	uint64_t Milliseconds;
+};
+
+struct EventHandlerStats
+{
+	const char *Name;
+	EventType Type;
+	int Priority;
+	uint64_t Calls;
+	uint64_t TotalNanoseconds;
+	uint64_t MaxNanoseconds;
+
+	const double GetAverageMicroseconds() const { return Calls ? (double)TotalNanoseconds / (double)Calls / 1000.0 : 0.0; }
+};
+
+/// <summary>
+/// Dispatches the plugin callbacks to the handlers registered by the game mode's modules.
+/// Handlers of an event are kept in one contiguous array sorted by priority and are called through plain
+/// function pointers, dispatching never allocates. Handlers can subscribe and unsubscribe during a dispatch,
+/// the changes apply once the dispatch is done. Tick thread only.
+/// </summary>
+class EventBus
+{
+public:
+	struct Handler
+	{
+		// The typed handler, cast back by Dispatch
+		void (*Function)();
+		void *Context;
+		int Priority;
+		uint32_t Id;
+		const char *Name;
+
+		uint64_t Calls;
+		uint64_t TotalNanoseconds;
+		uint64_t MaxNanoseconds;
+	};
+
+	struct HandlerList
+	{
+		std::vector<Handler> Handlers;
+		std::vector<Handler> Pending;
+		uint32_t Dispatching;
+		bool Dirty;
+	};
+
+	/// <summary>
+	/// Registers a handler, handlers with a higher priority are called first.
+	/// A handler returns false to stop the event from reaching the handlers after it.
+	/// </summary>
+	/// <param name="function">The handler</param>
+	/// <param name="context">Passed to the handler as is</param>
+	/// <param name="priority">The priority</param>
+	/// <param name="name">The name shown in the stats, has to outlive the subscription</param>
+	/// <returns name="id">The subscription id, never 0</returns>
+	template <typename E>
+	static uint32_t Subscribe(bool (*function)(void *context, const E &event), void *context = nullptr, const int priority = 0, const char *name = "")
+	{
+		return Add(E::Type, reinterpret_cast<void (*)()>(function), context, priority, name);
+	}
+
+	/// <summary>
+	/// Removes a handler
+	/// </summary>
+	/// <param name="id">The subscription id</param>
+	static void Unsubscribe(const uint32_t id);
+
+	/// <summary>
+	/// Calls the handlers of an event in priority order
+	/// </summary>
+	/// <returns name="handled">False if a handler stopped the event</returns>
+	template <typename E>
+	static bool Dispatch(const E &event)
+	{
+		typedef bool (*Function)(void *, const E &);
+		HandlerList &list = List(E::Type);
+		const bool profile = IsProfiling();
+
+		bool handled = true;
+		list.Dispatching++;
+		for (size_t i = 0; i < list.Handlers.size() && handled; i++)
+		{
+			Handler &handler = list.Handlers[i];
+			// Unsubscribed during this dispatch
+			if (!handler.Function)
+				continue;
+
+			if (!profile)
+			{
+				handled = reinterpret_cast<Function>(handler.Function)(handler.Context, event);
+				continue;
+			}
+
+			const uint64_t start = Now();
+			handled = reinterpret_cast<Function>(handler.Function)(handler.Context, event);
+			const uint64_t elapsed = Now() - start;
+
+			handler.Calls++;
+			handler.TotalNanoseconds += elapsed;
+			if (elapsed > handler.MaxNanoseconds)
+				handler.MaxNanoseconds = elapsed;
+		}
+
+		if (--list.Dispatching == 0 && list.Dirty)
+			Apply(list);
+		return handled;
+	}
+
+	/// <summary>
+	/// Gets the number of handlers of an event
+	/// </summary>
+	static size_t GetHandlerCount(const EventType type);
+
+	/// <summary>
+	/// Enables or disables per handler timing (enabled by default)
+	/// </summary>
+	static void SetProfiling(const bool enabled);
+	static bool IsProfiling();
+
+	/// <summary>
+	/// Gets the timing of every handler, slowest total time first
+	/// </summary>
+	static std::vector<EventHandlerStats> GetStats();
+	static void ResetStats();
+
+	/// <summary>
+	/// Removes every handler
+	/// </summary>
+	static void Clear();
+
+private:
+	static uint32_t Add(const EventType type, void (*function)(), void *context, const int priority, const char *name);
+	static HandlerList &List(const EventType type);
+	static void Apply(HandlerList &list);
+	static uint64_t Now();
+};
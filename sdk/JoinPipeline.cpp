@@ -0,0 +1,319 @@
+/**
+File:
+	JoinPipeline.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const size_t SampleCount = 1024;
+
+	enum class JoinState : uint8_t
+	{
+		Waiting,
+		Active,
+		Ready,
+		Failed
+	};
+
+	struct Stage
+	{
+		const char *Name;
+		JoinStage Run;
+		void *Context;
+	};
+
+	struct Join
+	{
+		std::string Guid;
+		Clock::time_point Start;
+		size_t NextStage = 0;
+		JoinState State = JoinState::Waiting;
+	};
+
+	struct PendingConnect
+	{
+		std::string Guid;
+		Clock::time_point Start;
+	};
+
+	struct PipelineState
+	{
+		std::vector<Stage> Stages;
+		std::deque<PendingConnect> Connecting;
+		std::unordered_map<int, Join> Players;
+		std::deque<int> Waiting;
+		std::vector<int> Active;
+		std::vector<int> Ready;
+
+		size_t Concurrency = 8;
+		uint32_t Budget = 2000;
+		// Connecting guids that did not become a connected player within this are taken as dropped
+		Clock::duration ConnectTimeout = std::chrono::seconds(30);
+
+		std::vector<uint64_t> Samples;
+		size_t NextSample = 0;
+		uint64_t Completed = 0;
+		uint64_t Failed = 0;
+		uint64_t Unpaired = 0;
+		uint64_t LastTick = 0;
+	};
+
+	PipelineState &State()
+	{
+		static PipelineState state;
+		return state;
+	}
+
+	uint64_t MicrosecondsSince(const Clock::time_point start)
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+	}
+
+	void ExpireConnecting(PipelineState &state, const Clock::time_point now)
+	{
+		while (!state.Connecting.empty() && now - state.Connecting.front().Start > state.ConnectTimeout)
+			state.Connecting.pop_front();
+	}
+
+	void AddSample(PipelineState &state, const uint64_t milliseconds)
+	{
+		if (state.Samples.size() < SampleCount)
+			state.Samples.push_back(milliseconds);
+		else
+			state.Samples[state.NextSample] = milliseconds;
+		state.NextSample = (state.NextSample + 1) % SampleCount;
+	}
+
+	uint64_t Percentile(std::vector<uint64_t> &samples, const size_t percent)
+	{
+		const size_t rank = (samples.size() - 1) * percent / 100;
+		std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+		return samples[rank];
+	}
+
+	// Runs the stages of one player until one is pending or the budget is spent, returns false once the player is out of the active set
+	bool Advance(PipelineState &state, const int player, const Clock::time_point tickStart)
+	{
+		for (;;)
+		{
+			std::unordered_map<int, Join>::iterator it = state.Players.find(player);
+			if (it == state.Players.end())
+				return false;
+
+			Join &join = it->second;
+			if (join.NextStage >= state.Stages.size())
+			{
+				join.State = JoinState::Ready;
+				state.Ready.push_back(player);
+				return false;
+			}
+			if (MicrosecondsSince(tickStart) >= state.Budget)
+				return true;
+
+			const Stage &stage = state.Stages[join.NextStage];
+			const JoinStageResult result = stage.Run(stage.Context, player);
+
+			// The stage may have removed the player
+			it = state.Players.find(player);
+			if (it == state.Players.end())
+				return false;
+
+			if (result == JoinStageResult::Pending)
+				return true;
+			if (result == JoinStageResult::Failed)
+			{
+				it->second.State = JoinState::Failed;
+				state.Failed++;
+				return false;
+			}
+			it->second.NextStage++;
+		}
+	}
+}
+
+void JoinPipeline::AddStage(const char *name, JoinStage stage, void *context)
+{
+	if (!stage)
+		return;
+	State().Stages.push_back({ name ? name : "", stage, context });
+}
+
+void JoinPipeline::OnConnecting(const std::string_view guid)
+{
+	PipelineState &state = State();
+	const Clock::time_point now = Clock::now();
+	ExpireConnecting(state, now);
+	state.Connecting.push_back({ std::string(guid), now });
+}
+
+void JoinPipeline::OnConnected(const int player, const std::string_view guid)
+{
+	PipelineState &state = State();
+	const Clock::time_point now = Clock::now();
+	ExpireConnecting(state, now);
+
+	// A reused entity starts over
+	state.Active.erase(std::remove(state.Active.begin(), state.Active.end(), player), state.Active.end());
+
+	Join &join = state.Players[player];
+	join = Join();
+	join.Start = now;
+	if (!guid.empty())
+	{
+		join.Guid = std::string(guid);
+		std::deque<PendingConnect>::iterator it = std::find_if(state.Connecting.begin(), state.Connecting.end(), [guid](const PendingConnect &pending) { return pending.Guid == guid; });
+		if (it != state.Connecting.end())
+		{
+			join.Start = it->Start;
+			state.Connecting.erase(it);
+		}
+	}
+	else if (state.Connecting.size() == 1)
+	{
+		// Only one player is connecting, so it has to be this one
+		join.Guid = std::move(state.Connecting.front().Guid);
+		join.Start = state.Connecting.front().Start;
+		state.Connecting.pop_front();
+	}
+	else
+	{
+		// Players connect in any order, guessing could hand out someone else's guid (and profile).
+		// The pending guids stay until they are paired explicitly or expire.
+		state.Unpaired++;
+	}
+	state.Waiting.push_back(player);
+}
+
+void JoinPipeline::Remove(const int player)
+{
+	// The waiting and active lists skip players that are gone
+	State().Players.erase(player);
+}
+
+std::string_view JoinPipeline::GetGuid(const int player)
+{
+	const PipelineState &state = State();
+	std::unordered_map<int, Join>::const_iterator it = state.Players.find(player);
+	return it != state.Players.end() ? std::string_view(it->second.Guid) : std::string_view();
+}
+
+bool JoinPipeline::IsReady(const int player)
+{
+	const PipelineState &state = State();
+	std::unordered_map<int, Join>::const_iterator it = state.Players.find(player);
+	return it != state.Players.end() && it->second.State == JoinState::Ready;
+}
+
+size_t JoinPipeline::Tick()
+{
+	PipelineState &state = State();
+	const Clock::time_point tickStart = Clock::now();
+
+	// Drop the players that left, then fill the free setup slots
+	state.Active.erase(std::remove_if(state.Active.begin(), state.Active.end(), [&state](const int player) { return state.Players.find(player) == state.Players.end(); }), state.Active.end());
+	while (state.Active.size() < state.Concurrency && !state.Waiting.empty())
+	{
+		const int player = state.Waiting.front();
+		state.Waiting.pop_front();
+
+		std::unordered_map<int, Join>::iterator it = state.Players.find(player);
+		if (it == state.Players.end() || it->second.State != JoinState::Waiting)
+			continue;
+		it->second.State = JoinState::Active;
+		state.Active.push_back(player);
+	}
+
+	// Closest to done first, admission order among equals
+	std::stable_sort(state.Active.begin(), state.Active.end(), [&state](const int a, const int b) { return state.Players[a].NextStage > state.Players[b].NextStage; });
+
+	state.Ready.clear();
+	size_t kept = 0;
+	for (size_t i = 0; i < state.Active.size(); i++)
+	{
+		const int player = state.Active[i];
+		if (Advance(state, player, tickStart))
+			state.Active[kept++] = player;
+	}
+	state.Active.resize(kept);
+
+	// Dispatched after the pass so handlers can remove players or add new ones safely
+	for (size_t i = 0; i < state.Ready.size(); i++)
+	{
+		std::unordered_map<int, Join>::const_iterator it = state.Players.find(state.Ready[i]);
+		if (it == state.Players.end())
+			continue;
+
+		PlayerReadyEvent event;
+		event.Entity = state.Ready[i];
+		event.Milliseconds = MicrosecondsSince(it->second.Start) / 1000;
+		AddSample(state, event.Milliseconds);
+		state.Completed++;
+		EventBus::Dispatch(event);
+	}
+
+	state.LastTick = MicrosecondsSince(tickStart);
+	return state.Ready.size();
+}
+
+void JoinPipeline::SetConcurrency(const size_t players)
+{
+	State().Concurrency = players ? players : 1;
+}
+
+void JoinPipeline::SetConnectTimeout(const uint32_t seconds)
+{
+	State().ConnectTimeout = std::chrono::seconds(seconds);
+}
+
+void JoinPipeline::SetBudget(const uint32_t microseconds)
+{
+	State().Budget = microseconds;
+}
+
+JoinStats JoinPipeline::GetStats()
+{
+	PipelineState &state = State();
+	JoinStats stats;
+	stats.Waiting = 0;
+	for (size_t i = 0; i < state.Waiting.size(); i++)
+	{
+		std::unordered_map<int, Join>::const_iterator it = state.Players.find(state.Waiting[i]);
+		if (it != state.Players.end() && it->second.State == JoinState::Waiting)
+			stats.Waiting++;
+	}
+	stats.Active = state.Active.size();
+	stats.Connecting = state.Connecting.size();
+	stats.Completed = state.Completed;
+	stats.Failed = state.Failed;
+	stats.Unpaired = state.Unpaired;
+	stats.LastTickMicroseconds = state.LastTick;
+
+	if (!state.Samples.empty())
+	{
+		std::vector<uint64_t> samples(state.Samples);
+		stats.P50Milliseconds = Percentile(samples, 50);
+		stats.P90Milliseconds = Percentile(samples, 90);
+		stats.P99Milliseconds = Percentile(samples, 99);
+		stats.MaxMilliseconds = *std::max_element(samples.begin(), samples.end());
+	}
+	return stats;
+}
+
+void JoinPipeline::Clear()
+{
+	PipelineState &state = State();
+	state.Connecting.clear();
+	state.Players.clear();
+	state.Waiting.clear();
+	state.Active.clear();
+	state.Ready.clear();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+enum class JoinStageResult : uint8_t
+{
+	// Go on with the next stage
+	Done,
+	// Call the stage again next tick, e.g. while waiting for a load
+	Pending,
+	// Stop the join, the player does not become ready
+	Failed
+};
+
+typedef JoinStageResult (*JoinStage)(void *context, const int player);
+
+struct JoinStats
+{
+	// Connected players waiting for a setup slot
+	size_t Waiting = 0;
+	// Players being set up
+	size_t Active = 0;
+	// Players that started connecting but are not connected yet
+	size_t Connecting = 0;
+	uint64_t Completed = 0;
+	uint64_t Failed = 0;
+	// Connected players that got no guid because more than one player was connecting
+	uint64_t Unpaired = 0;
+	// Time to ready over the last 1024 joins
+	uint64_t P50Milliseconds = 0;
+	uint64_t P90Milliseconds = 0;
+	uint64_t P99Milliseconds = 0;
+	uint64_t MaxMilliseconds = 0;
+	uint64_t LastTickMicroseconds = 0;
+};
+
+/// <summary>
+/// Spreads the per player setup after a connect over the ticks.
+/// Connected players are queued and at most a number of them are set up at once. Every tick the setup stages run
+/// within a time budget, players with the most stages done first so joins finish instead of all progressing a bit.
+/// PlayerReadyEvent is dispatched when a player's last stage is done. Tick thread only.
+/// </summary>
+class JoinPipeline
+{
+public:
+	/// <summary>
+	/// Appends a setup stage, stages run in the order they are added
+	/// </summary>
+	/// <param name="name">The name of the stage, has to outlive the pipeline</param>
+	/// <param name="stage">The stage</param>
+	/// <param name="context">Passed to the stage as is</param>
+	static void AddStage(const char *name, JoinStage stage, void *context = nullptr);
+
+	/// <summary>
+	/// Remembers when a player started connecting, call from API_OnPlayerConnecting
+	/// </summary>
+	static void OnConnecting(const std::string_view guid);
+
+	/// <summary>
+	/// Queues a connected player, call from API_OnPlayerConnected.
+	/// The server does not tell which connecting guid became which player. Without a guid the player only gets the
+	/// connecting guid when exactly one is pending, otherwise it has none (see JoinStats::Unpaired). During a
+	/// connection storm nearly every player is unpaired then, and GetGuid (and so ProfileStore prefetching) only
+	/// works if the plugin supplies the guid itself. Guids of players that dropped while connecting block the
+	/// pairing until the connect timeout.
+	/// </summary>
+	/// <param name="player">The player entity</param>
+	/// <param name="guid">The player's guid if the caller knows it</param>
+	static void OnConnected(const int player, const std::string_view guid = std::string_view());
+
+	/// <summary>
+	/// Stops the join of a player that left
+	/// </summary>
+	static void Remove(const int player);
+
+	/// <summary>
+	/// Gets the guid the player connected with, empty if it is unknown
+	/// </summary>
+	static std::string_view GetGuid(const int player);
+
+	/// <summary>
+	/// Checks if every stage of a player is done
+	/// </summary>
+	static bool IsReady(const int player);
+
+	/// <summary>
+	/// Runs the stages, call once per tick
+	/// </summary>
+	/// <returns name="ready">The number of players that became ready</returns>
+	static size_t Tick();
+
+	/// <summary>
+	/// Sets the number of players set up at once (8 by default)
+	/// </summary>
+	static void SetConcurrency(const size_t players);
+
+	/// <summary>
+	/// Sets how long a connecting guid waits for its connected player (30 seconds by default).
+	/// Shorter gets past players that dropped while connecting sooner, connects slower than this end up unpaired.
+	/// </summary>
+	static void SetConnectTimeout(const uint32_t seconds);
+
+	/// <summary>
+	/// Sets the time the stages may take per tick (2000 by default), the stage running when it runs out finishes
+	/// </summary>
+	static void SetBudget(const uint32_t microseconds);
+
+	static JoinStats GetStats();
+	static void Clear();
+};
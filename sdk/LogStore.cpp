@@ -0,0 +1,847 @@
+/**
+File:
+	LogStore.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#if defined _WIN32 || defined __CYGWIN__
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const uint16_t TombstoneFlag = 1;
+	const uint32_t HintMagic = 0x544E4948;
+	const size_t CompactBatch = 256;
+
+	// On disk a record is the header, the key and the value. Crc covers everything after itself.
+	struct RecordHeader
+	{
+		uint32_t Crc;
+		uint16_t KeySize;
+		uint16_t Flags;
+		uint32_t ValueSize;
+	};
+	static_assert(sizeof(RecordHeader) == 12, "RecordHeader is written as is");
+
+	// A hint file is the header and an entry plus key per record, Crc covers everything after itself
+	struct HintHeader
+	{
+		uint32_t Magic;
+		uint32_t Crc;
+		// Bytes of the segment the entries cover, records after it are scanned
+		uint64_t Covered;
+		uint64_t Count;
+	};
+	static_assert(sizeof(HintHeader) == 24, "HintHeader is written as is");
+
+	struct HintEntry
+	{
+		uint64_t Offset;
+		uint32_t ValueSize;
+		uint16_t KeySize;
+		uint16_t Flags;
+	};
+	static_assert(sizeof(HintEntry) == 16, "HintEntry is written as is");
+
+	struct Location
+	{
+		uint32_t Segment;
+		uint32_t ValueSize;
+		uint64_t Offset;
+		uint16_t KeySize;
+		// Deletes stay in the index until no older segment can hold the key anymore
+		bool Tombstone;
+	};
+
+	struct Segment
+	{
+		uint32_t Id = 0;
+		std::string Path;
+		// Sealed segments stay mapped, the active one is read through Out
+		MappedFile File;
+		const uint8_t *Data = nullptr;
+		uint64_t Size = 0;
+		uint64_t Live = 0;
+		// Could not be mapped to be scanned on Open, its records are not all indexed so compaction leaves it alone
+		bool Unscanned = false;
+	};
+
+	struct StoreState
+	{
+		std::mutex Lock;
+		// Held for a whole compaction run, so the background thread and Compact do not run at once
+		std::mutex CompactLock;
+		std::condition_variable Wake;
+		std::thread Background;
+		bool Stopping = false;
+
+		bool Opened = false;
+		std::string Directory;
+		std::map<uint32_t, std::unique_ptr<Segment>> Segments;
+		std::unordered_map<std::string, Location> Index;
+		Segment *Active = nullptr;
+		std::FILE *Out = nullptr;
+		// Out was last used for reading, the next write has to seek first
+		bool OutReading = false;
+		// Bytes of the active segment handed to the OS and synced to disk
+		uint64_t Flushed = 0;
+		uint64_t Synced = 0;
+
+		uint64_t SegmentSize = 64ull * 1024 * 1024;
+		uint32_t SyncInterval = 1000;
+		double Threshold = 0.5;
+
+		LogStoreStats Stats;
+	};
+
+	StoreState &State()
+	{
+		static StoreState state;
+		return state;
+	}
+
+	struct CrcTable
+	{
+		uint32_t Values[256];
+
+		CrcTable()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+					value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+				Values[i] = value;
+			}
+		}
+	};
+
+	// CRC-32 (zlib polynomial), chains: Crc32(Crc32(0, a), b) is the checksum of a followed by b
+	uint32_t Crc32(const uint32_t crc, const void *data, const size_t size)
+	{
+		static const CrcTable table;
+		const uint8_t *bytes = (const uint8_t *)data;
+		uint32_t value = ~crc;
+		for (size_t i = 0; i < size; i++)
+			value = table.Values[(value ^ bytes[i]) & 0xFF] ^ (value >> 8);
+		return ~value;
+	}
+
+	uint32_t RecordCrc(const RecordHeader &header, const void *key, const void *value)
+	{
+		uint32_t crc = Crc32(0, (const uint8_t *)&header + sizeof(header.Crc), sizeof(header) - sizeof(header.Crc));
+		crc = Crc32(crc, key, header.KeySize);
+		return Crc32(crc, value, header.ValueSize);
+	}
+
+	uint64_t RecordSize(const uint16_t keySize, const uint32_t valueSize)
+	{
+		return sizeof(RecordHeader) + keySize + valueSize;
+	}
+
+	uint64_t RecordSize(const Location &location)
+	{
+		return RecordSize(location.KeySize, location.ValueSize);
+	}
+
+	std::string SegmentPath(const StoreState &state, const uint32_t id)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "/%08u.log", id);
+		return state.Directory + name;
+	}
+
+	std::string HintPath(const Segment &segment)
+	{
+		return segment.Path.substr(0, segment.Path.size() - 4) + ".hint";
+	}
+
+	bool SyncFile(std::FILE *file)
+	{
+		if (std::fflush(file) != 0)
+			return false;
+#if defined _WIN32 || defined __CYGWIN__
+		return _commit(_fileno(file)) == 0;
+#else
+		return fsync(fileno(file)) == 0;
+#endif
+	}
+
+	// Points the key at a new record and moves the live bytes over from the record it replaces
+	void Apply(StoreState &state, const std::string_view key, const Location &location)
+	{
+		std::unordered_map<std::string, Location>::iterator it = state.Index.find(std::string(key));
+		if (it == state.Index.end())
+			it = state.Index.emplace(std::string(key), location).first;
+		else
+		{
+			const Location &old = it->second;
+			std::map<uint32_t, std::unique_ptr<Segment>>::iterator segment = state.Segments.find(old.Segment);
+			if (segment != state.Segments.end())
+				segment->second->Live -= RecordSize(old);
+			if (!old.Tombstone)
+				state.Stats.Keys--;
+			it->second = location;
+		}
+
+		state.Segments[location.Segment]->Live += RecordSize(location);
+		if (!location.Tombstone)
+			state.Stats.Keys++;
+	}
+
+	void Forget(StoreState &state, std::unordered_map<std::string, Location>::iterator it)
+	{
+		state.Segments[it->second.Segment]->Live -= RecordSize(it->second);
+		if (!it->second.Tombstone)
+			state.Stats.Keys--;
+		state.Index.erase(it);
+	}
+
+	// Indexes the valid records from an offset on, returns where they end
+	uint64_t Scan(StoreState &state, const Segment &segment, const uint8_t *data, uint64_t offset)
+	{
+		while (segment.Size - offset >= sizeof(RecordHeader))
+		{
+			RecordHeader header;
+			memcpy(&header, data + offset, sizeof(header));
+			const uint64_t size = RecordSize(header.KeySize, header.ValueSize);
+			if (header.KeySize == 0 || size > segment.Size - offset)
+				break;
+
+			const uint8_t *key = data + offset + sizeof(header);
+			if (RecordCrc(header, key, key + header.KeySize) != header.Crc)
+				break;
+
+			Location location = { segment.Id, header.ValueSize, offset, header.KeySize, (header.Flags & TombstoneFlag) != 0 };
+			Apply(state, std::string_view((const char *)key, header.KeySize), location);
+			offset += size;
+		}
+		return offset;
+	}
+
+	// Indexes the records listed in the segment's hint file, returns the bytes covered, 0 without a valid hint
+	uint64_t LoadHint(StoreState &state, const Segment &segment)
+	{
+		std::ifstream in(HintPath(segment).c_str(), std::ios::binary | std::ios::ate);
+		if (!in)
+			return 0;
+
+		const std::streamoff size = in.tellg();
+		if (size < (std::streamoff)sizeof(HintHeader))
+			return 0;
+		std::vector<uint8_t> bytes((size_t)size);
+		in.seekg(0);
+		if (!in.read((char *)bytes.data(), size))
+			return 0;
+
+		HintHeader header;
+		memcpy(&header, bytes.data(), sizeof(header));
+		if (header.Magic != HintMagic || header.Covered > segment.Size)
+			return 0;
+		if (Crc32(0, bytes.data() + 8, bytes.size() - 8) != header.Crc)
+			return 0;
+
+		// Validate everything before touching the index, a bad hint falls back to a scan
+		size_t position = sizeof(header);
+		for (uint64_t i = 0; i < header.Count; i++)
+		{
+			HintEntry entry;
+			if (bytes.size() - position < sizeof(entry))
+				return 0;
+			memcpy(&entry, bytes.data() + position, sizeof(entry));
+			position += sizeof(entry);
+			if (entry.KeySize == 0 || bytes.size() - position < entry.KeySize || entry.Offset + RecordSize(entry.KeySize, entry.ValueSize) > header.Covered)
+				return 0;
+			position += entry.KeySize;
+		}
+
+		position = sizeof(header);
+		for (uint64_t i = 0; i < header.Count; i++)
+		{
+			HintEntry entry;
+			memcpy(&entry, bytes.data() + position, sizeof(entry));
+			position += sizeof(entry);
+
+			Location location = { segment.Id, entry.ValueSize, entry.Offset, entry.KeySize, (entry.Flags & TombstoneFlag) != 0 };
+			Apply(state, std::string_view((const char *)bytes.data() + position, entry.KeySize), location);
+			position += entry.KeySize;
+		}
+		return header.Covered;
+	}
+
+	// Writes the index entries of a segment, replacing the hint file in one step
+	void WriteHint(const StoreState &state, const Segment &segment)
+	{
+		std::vector<std::pair<const std::string *, const Location *>> entries;
+		for (std::unordered_map<std::string, Location>::const_iterator it = state.Index.begin(); it != state.Index.end(); ++it)
+		{
+			if (it->second.Segment == segment.Id)
+				entries.push_back(std::make_pair(&it->first, &it->second));
+		}
+		std::sort(entries.begin(), entries.end(), [](const std::pair<const std::string *, const Location *> &a, const std::pair<const std::string *, const Location *> &b) { return a.second->Offset < b.second->Offset; });
+
+		std::vector<uint8_t> bytes(sizeof(HintHeader));
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const Location &location = *entries[i].second;
+			HintEntry entry = { location.Offset, location.ValueSize, location.KeySize, (uint16_t)(location.Tombstone ? TombstoneFlag : 0) };
+			bytes.insert(bytes.end(), (const uint8_t *)&entry, (const uint8_t *)&entry + sizeof(entry));
+			bytes.insert(bytes.end(), entries[i].first->begin(), entries[i].first->end());
+		}
+
+		HintHeader header = { HintMagic, 0, segment.Size, (uint64_t)entries.size() };
+		memcpy(bytes.data(), &header, sizeof(header));
+		header.Crc = Crc32(0, bytes.data() + 8, bytes.size() - 8);
+		memcpy(bytes.data(), &header, sizeof(header));
+
+		const std::string path = HintPath(segment);
+		const std::string temporary = path + ".tmp";
+		{
+			std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+			if (!out || !out.write((const char *)bytes.data(), (std::streamsize)bytes.size()))
+				return;
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporary, path, error);
+	}
+
+	bool MapSegment(Segment &segment)
+	{
+		segment.Data = nullptr;
+		if (!segment.File.Open(segment.Path))
+			return false;
+		if (segment.Size == 0)
+			return true;
+		segment.Data = segment.File.Map(0, (size_t)segment.Size);
+		return segment.Data != nullptr;
+	}
+
+	bool OpenActive(StoreState &state, Segment &segment)
+	{
+		state.Out = std::fopen(segment.Path.c_str(), "a+b");
+		if (!state.Out)
+			return false;
+		std::setvbuf(state.Out, nullptr, _IOFBF, 64 * 1024);
+		state.Active = &segment;
+		state.OutReading = false;
+		state.Flushed = segment.Size;
+		state.Synced = segment.Size;
+		return true;
+	}
+
+	bool Flush(StoreState &state)
+	{
+		if (state.Flushed == state.Active->Size)
+			return true;
+		if (std::fflush(state.Out) != 0)
+			return false;
+		state.Flushed = state.Active->Size;
+		return true;
+	}
+
+	bool SyncActive(StoreState &state)
+	{
+		if (!state.Out || state.Synced == state.Active->Size)
+			return true;
+		if (!SyncFile(state.Out))
+			return false;
+		state.Flushed = state.Synced = state.Active->Size;
+		state.Stats.Syncs++;
+		return true;
+	}
+
+	// Seals the active segment with its hint and starts the next one
+	bool Rotate(StoreState &state)
+	{
+		Segment &sealed = *state.Active;
+		SyncFile(state.Out);
+		std::fclose(state.Out);
+		state.Out = nullptr;
+		state.Active = nullptr;
+		WriteHint(state, sealed);
+		if (!MapSegment(sealed))
+		{
+			// Its records could not be read, keep appending to it and try sealing again with the next write
+			sealed.File.Close();
+			return OpenActive(state, sealed);
+		}
+
+		std::unique_ptr<Segment> segment(new Segment());
+		segment->Id = sealed.Id + 1;
+		segment->Path = SegmentPath(state, segment->Id);
+		Segment &next = *segment;
+		state.Segments[next.Id] = std::move(segment);
+		return OpenActive(state, next);
+	}
+
+	// Cuts a partly written record off the active segment, the ones after it would be lost on the next Open otherwise
+	void Repair(StoreState &state)
+	{
+		Segment &segment = *state.Active;
+		std::fclose(state.Out);
+		state.Out = nullptr;
+
+		std::error_code error;
+		std::filesystem::resize_file(segment.Path, segment.Size, error);
+		OpenActive(state, segment);
+	}
+
+	bool Append(StoreState &state, const std::string_view key, const uint16_t flags, const void *data, const uint32_t size, Location &location)
+	{
+		const uint64_t recordSize = RecordSize((uint16_t)key.size(), size);
+		if (!state.Out || (state.Active->Size > 0 && state.Active->Size + recordSize > state.SegmentSize))
+		{
+			if (state.Out && !Rotate(state))
+				return false;
+			if (!state.Out)
+				return false;
+		}
+
+		RecordHeader header = { 0, (uint16_t)key.size(), flags, size };
+		header.Crc = RecordCrc(header, key.data(), data);
+
+		if (state.OutReading)
+		{
+			std::fseek(state.Out, 0, SEEK_END);
+			state.OutReading = false;
+		}
+		if (std::fwrite(&header, sizeof(header), 1, state.Out) != 1 || std::fwrite(key.data(), 1, key.size(), state.Out) != key.size() || (size > 0 && std::fwrite(data, 1, size, state.Out) != size))
+		{
+			Repair(state);
+			return false;
+		}
+
+		location = { state.Active->Id, size, state.Active->Size, (uint16_t)key.size(), (flags & TombstoneFlag) != 0 };
+		state.Active->Size += recordSize;
+		return true;
+	}
+
+	bool Read(StoreState &state, const Location &location, std::vector<uint8_t> &record)
+	{
+		const uint64_t size = RecordSize(location);
+		std::map<uint32_t, std::unique_ptr<Segment>>::const_iterator it = state.Segments.find(location.Segment);
+		if (it == state.Segments.end())
+			return false;
+
+		Segment &segment = *it->second;
+		record.resize((size_t)size);
+		if (&segment != state.Active)
+		{
+			// A segment that could not be mapped when it was sealed or opened gets another try
+			if (!segment.Data && !MapSegment(segment))
+				return false;
+			memcpy(record.data(), segment.Data + location.Offset, (size_t)size);
+			return true;
+		}
+
+		if (!Flush(state))
+			return false;
+		state.OutReading = true;
+		return std::fseek(state.Out, (long)location.Offset, SEEK_SET) == 0 && std::fread(record.data(), 1, (size_t)size, state.Out) == size;
+	}
+
+	bool HasOlder(const StoreState &state, const uint32_t id)
+	{
+		return !state.Segments.empty() && state.Segments.begin()->first < id;
+	}
+
+	// Moves the live records of a sealed segment to the active one in batches, then deletes it once nothing refers to it
+	void CompactSegment(StoreState &state, const uint32_t id)
+	{
+		uint64_t offset = 0;
+		uint64_t moved = 0;
+		std::unique_lock<std::mutex> lock(state.Lock);
+		for (;;)
+		{
+			std::map<uint32_t, std::unique_ptr<Segment>>::iterator it = state.Segments.find(id);
+			if (!state.Opened || it == state.Segments.end())
+				return;
+
+			Segment &segment = *it->second;
+			if (!segment.Data && segment.Size > 0 && !MapSegment(segment))
+				return;
+
+			for (size_t batch = 0; batch < CompactBatch && segment.Size - offset >= sizeof(RecordHeader); batch++)
+			{
+				RecordHeader header;
+				memcpy(&header, segment.Data + offset, sizeof(header));
+				const uint64_t size = RecordSize(header.KeySize, header.ValueSize);
+				if (size > segment.Size - offset)
+				{
+					offset = segment.Size;
+					break;
+				}
+
+				const std::string_view key((const char *)segment.Data + offset + sizeof(header), header.KeySize);
+				std::unordered_map<std::string, Location>::iterator entry = state.Index.find(std::string(key));
+				if (entry != state.Index.end() && entry->second.Segment == id && entry->second.Offset == offset)
+				{
+					if (entry->second.Tombstone && !HasOlder(state, id))
+						Forget(state, entry);
+					else
+					{
+						Location location;
+						if (!Append(state, key, header.Flags, segment.Data + offset + sizeof(header) + header.KeySize, header.ValueSize, location))
+							return;
+						Apply(state, key, location);
+						moved += size;
+					}
+				}
+				offset += size;
+			}
+
+			if (segment.Size - offset < sizeof(RecordHeader))
+				break;
+
+			// Let the writers in between batches
+			lock.unlock();
+			std::this_thread::yield();
+			lock.lock();
+		}
+
+		std::map<uint32_t, std::unique_ptr<Segment>>::iterator it = state.Segments.find(id);
+		if (it == state.Segments.end())
+			return;
+		Segment &segment = *it->second;
+
+		// Records the walk could not reach (e.g. behind a corrupt one) are still indexed here, the segment stays then
+		if (segment.Live != 0)
+			return;
+
+		// The moved records have to be on disk before their old copies go
+		if (!SyncActive(state))
+			return;
+		segment.File.Close();
+
+		std::error_code error;
+		std::filesystem::remove(HintPath(segment), error);
+		std::filesystem::remove(segment.Path, error);
+		state.Stats.Compactions++;
+		state.Stats.CompactedBytes += segment.Size - moved;
+		state.Segments.erase(it);
+	}
+
+	size_t CompactEligible(StoreState &state)
+	{
+		std::lock_guard<std::mutex> compacting(state.CompactLock);
+
+		std::vector<std::pair<double, uint32_t>> candidates;
+		{
+			std::lock_guard<std::mutex> lock(state.Lock);
+			if (!state.Opened)
+				return 0;
+			for (std::map<uint32_t, std::unique_ptr<Segment>>::const_iterator it = state.Segments.begin(); it != state.Segments.end(); ++it)
+			{
+				const Segment &segment = *it->second;
+				if (&segment == state.Active || segment.Unscanned)
+					continue;
+				const double ratio = segment.Size ? (double)segment.Live / (double)segment.Size : 0.0;
+				if (ratio < state.Threshold)
+					candidates.push_back(std::make_pair(ratio, segment.Id));
+			}
+		}
+
+		// Emptiest first, they free the most for the least copying
+		std::sort(candidates.begin(), candidates.end());
+		for (size_t i = 0; i < candidates.size(); i++)
+			CompactSegment(state, candidates[i].second);
+		return candidates.size();
+	}
+
+	void BackgroundLoop()
+	{
+		StoreState &state = State();
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(state.Lock);
+				state.Wake.wait_for(lock, std::chrono::milliseconds(state.SyncInterval ? state.SyncInterval : 1000), [&state] { return state.Stopping; });
+				if (state.Stopping)
+					return;
+				SyncActive(state);
+			}
+			CompactEligible(state);
+		}
+	}
+
+	bool ValidKey(const std::string_view key)
+	{
+		return !key.empty() && key.size() <= 0xFFFF;
+	}
+}
+
+bool LogStore::Open(const std::string &directory)
+{
+	StoreState &state = State();
+	Close();
+
+	const Clock::time_point start = Clock::now();
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+		return false;
+
+	std::lock_guard<std::mutex> lock(state.Lock);
+	state.Directory = directory;
+	state.Stats = LogStoreStats();
+
+	// Segments are named by their sequence number, later ones win
+	std::vector<uint32_t> ids;
+	for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		const std::filesystem::path path = it->path();
+		if (path.extension() == ".tmp")
+			std::filesystem::remove(path, error);
+		else if (path.extension() == ".log")
+		{
+			const std::string stem = path.stem().string();
+			if (stem.size() == 8 && std::all_of(stem.begin(), stem.end(), [](const char c) { return c >= '0' && c <= '9'; }))
+				ids.push_back((uint32_t)std::stoul(stem));
+		}
+	}
+	std::sort(ids.begin(), ids.end());
+	if (ids.empty())
+		ids.push_back(1);
+
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		std::unique_ptr<Segment> owned(new Segment());
+		Segment &segment = *owned;
+		segment.Id = ids[i];
+		segment.Path = SegmentPath(state, segment.Id);
+		segment.Size = std::filesystem::file_size(segment.Path, error);
+		if (error)
+			segment.Size = 0;
+		state.Segments[segment.Id] = std::move(owned);
+
+		const bool last = i + 1 == ids.size();
+		const uint64_t covered = LoadHint(state, segment);
+		if (covered > 0)
+			state.Stats.HintSegments++;
+
+		uint64_t end = covered;
+		if (covered < segment.Size)
+		{
+			if (MapSegment(segment))
+				end = Scan(state, segment, segment.Data, covered);
+			else
+				segment.Unscanned = true;
+		}
+
+		if (segment.Unscanned && last)
+		{
+			// Appending after records that are not indexed would hide them for good
+			state.Segments.clear();
+			state.Index.clear();
+			return false;
+		}
+
+		if (!segment.Unscanned && end < segment.Size)
+		{
+			state.Stats.CorruptRecords++;
+			// A crash can tear the last record of the active segment, appends continue after the last good one
+			if (last)
+			{
+				segment.File.Close();
+				segment.Data = nullptr;
+				std::filesystem::resize_file(segment.Path, end, error);
+				segment.Size = end;
+			}
+		}
+
+		if (last)
+		{
+			segment.File.Close();
+			segment.Data = nullptr;
+			if (!OpenActive(state, segment))
+			{
+				state.Segments.clear();
+				state.Index.clear();
+				return false;
+			}
+		}
+		else if (!segment.Data)
+			MapSegment(segment);
+	}
+
+	state.Opened = true;
+	state.Stopping = false;
+	state.Stats.OpenMilliseconds = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+	state.Background = std::thread(BackgroundLoop);
+	return true;
+}
+
+void LogStore::Close()
+{
+	StoreState &state = State();
+	{
+		std::lock_guard<std::mutex> lock(state.Lock);
+		if (!state.Opened)
+			return;
+		state.Stopping = true;
+	}
+	state.Wake.notify_all();
+	if (state.Background.joinable())
+		state.Background.join();
+
+	std::lock_guard<std::mutex> compacting(state.CompactLock);
+	std::lock_guard<std::mutex> lock(state.Lock);
+	if (state.Out)
+	{
+		SyncActive(state);
+		// Lets the next Open skip reading this segment's values
+		WriteHint(state, *state.Active);
+		std::fclose(state.Out);
+		state.Out = nullptr;
+	}
+	state.Active = nullptr;
+	state.Segments.clear();
+	state.Index.clear();
+	state.Opened = false;
+}
+
+bool LogStore::IsOpen()
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	return state.Opened;
+}
+
+bool LogStore::Put(const std::string_view key, const void *data, const size_t size)
+{
+	StoreState &state = State();
+	if (!ValidKey(key) || size > 0xFFFFFFFFu - sizeof(RecordHeader) - key.size())
+		return false;
+
+	std::lock_guard<std::mutex> lock(state.Lock);
+	Location location;
+	if (!state.Opened || !Append(state, key, 0, data, (uint32_t)size, location))
+		return false;
+	Apply(state, key, location);
+	state.Stats.Puts++;
+	if (state.SyncInterval == 0)
+		SyncActive(state);
+	return true;
+}
+
+bool LogStore::Get(const std::string_view key, std::vector<uint8_t> &value)
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	state.Stats.Gets++;
+
+	std::unordered_map<std::string, Location>::const_iterator it = state.Index.find(std::string(key));
+	if (it == state.Index.end() || it->second.Tombstone)
+		return false;
+
+	std::vector<uint8_t> record;
+	if (!Read(state, it->second, record))
+		return false;
+
+	RecordHeader header;
+	memcpy(&header, record.data(), sizeof(header));
+	const uint8_t *recordKey = record.data() + sizeof(header);
+	if (header.KeySize != key.size() || header.ValueSize != it->second.ValueSize || memcmp(recordKey, key.data(), key.size()) != 0 || RecordCrc(header, recordKey, recordKey + header.KeySize) != header.Crc)
+	{
+		state.Stats.CorruptRecords++;
+		return false;
+	}
+
+	value.assign(recordKey + header.KeySize, recordKey + header.KeySize + header.ValueSize);
+	return true;
+}
+
+bool LogStore::Contains(const std::string_view key)
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	std::unordered_map<std::string, Location>::const_iterator it = state.Index.find(std::string(key));
+	return it != state.Index.end() && !it->second.Tombstone;
+}
+
+bool LogStore::Delete(const std::string_view key)
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	std::unordered_map<std::string, Location>::const_iterator it = state.Index.find(std::string(key));
+	if (!state.Opened || it == state.Index.end() || it->second.Tombstone)
+		return false;
+
+	Location location;
+	if (!Append(state, key, TombstoneFlag, nullptr, 0, location))
+		return false;
+	Apply(state, key, location);
+	state.Stats.Deletes++;
+	if (state.SyncInterval == 0)
+		SyncActive(state);
+	return true;
+}
+
+bool LogStore::Sync()
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	return state.Opened && SyncActive(state);
+}
+
+void LogStore::SetSegmentSize(const uint64_t bytes)
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	state.SegmentSize = bytes ? bytes : 1;
+}
+
+void LogStore::SetSyncInterval(const uint32_t milliseconds)
+{
+	StoreState &state = State();
+	{
+		std::lock_guard<std::mutex> lock(state.Lock);
+		state.SyncInterval = milliseconds;
+	}
+	state.Wake.notify_all();
+}
+
+void LogStore::SetCompactionThreshold(const double liveRatio)
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	state.Threshold = liveRatio;
+}
+
+size_t LogStore::Compact()
+{
+	return CompactEligible(State());
+}
+
+LogStoreStats LogStore::GetStats()
+{
+	StoreState &state = State();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	LogStoreStats stats = state.Stats;
+	stats.Segments = state.Segments.size();
+	for (std::map<uint32_t, std::unique_ptr<Segment>>::const_iterator it = state.Segments.begin(); it != state.Segments.end(); ++it)
+	{
+		stats.TotalBytes += it->second->Size;
+		stats.LiveBytes += it->second->Live;
+	}
+	return stats;
+}
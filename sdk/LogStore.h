@@ -0,0 +1,98 @@
+#pragma once
+
+struct LogStoreStats
+{
+	size_t Keys = 0;
+	size_t Segments = 0;
+	// Bytes of every segment on disk
+	uint64_t TotalBytes = 0;
+	// Bytes of the records still referenced by the index
+	uint64_t LiveBytes = 0;
+	uint64_t Puts = 0;
+	uint64_t Gets = 0;
+	uint64_t Deletes = 0;
+	uint64_t Syncs = 0;
+	uint64_t Compactions = 0;
+	// Bytes freed by compaction
+	uint64_t CompactedBytes = 0;
+	// Records with a bad checksum found by Open or Get, Open stops a segment at the first one
+	uint64_t CorruptRecords = 0;
+	// Segments whose index entries came from a hint file on Open
+	size_t HintSegments = 0;
+	uint64_t OpenMilliseconds = 0;
+};
+
+/// <summary>
+/// Append-only key-value store for player data, keyed by guid.
+/// Every write appends a checksummed record to the active segment file and updates an in-memory hash index of
+/// key to record position, so saves cost one small sequential write instead of rewriting a file. Values are read
+/// through memory mapped segments. Full segments are sealed with a hint file holding their index entries, so Open
+/// rebuilds the index without reading the values. A background thread compacts segments that are mostly
+/// overwritten records and syncs the active segment. Thread safe.
+/// </summary>
+class LogStore
+{
+public:
+	/// <summary>
+	/// Opens the store and rebuilds the index, creating the directory if needed.
+	/// A record torn by a crash at the end of the active segment is cut off.
+	/// </summary>
+	/// <param name="directory">The directory of the segment files</param>
+	/// <returns name="opened">False if the directory or the active segment could not be opened</returns>
+	static bool Open(const std::string &directory);
+
+	/// <summary>
+	/// Stops the background thread, syncs and writes the hint of the active segment
+	/// </summary>
+	static void Close();
+
+	static bool IsOpen();
+
+	/// <summary>
+	/// Appends a value, it is in the OS page cache at once and on disk with the next sync
+	/// </summary>
+	/// <returns name="written">False if the store is closed, the key is empty or too long, or the write failed</returns>
+	static bool Put(const std::string_view key, const void *data, const size_t size);
+
+	/// <summary>
+	/// Copies a value out
+	/// </summary>
+	/// <returns name="found">False if the key is unknown or deleted, or its record is corrupt</returns>
+	static bool Get(const std::string_view key, std::vector<uint8_t> &value);
+
+	static bool Contains(const std::string_view key);
+
+	/// <summary>
+	/// Appends a delete marker for the key
+	/// </summary>
+	/// <returns name="deleted">False if the key was not there</returns>
+	static bool Delete(const std::string_view key);
+
+	/// <summary>
+	/// Writes the buffered records and syncs the active segment to disk
+	/// </summary>
+	static bool Sync();
+
+	/// <summary>
+	/// Sets the size at which the active segment is sealed and a new one is started (64 MB by default)
+	/// </summary>
+	static void SetSegmentSize(const uint64_t bytes);
+
+	/// <summary>
+	/// Sets how often the background thread syncs the active segment (1000 by default), 0 syncs on every Put
+	/// </summary>
+	static void SetSyncInterval(const uint32_t milliseconds);
+
+	/// <summary>
+	/// Sets the share of live bytes below which a sealed segment is compacted (0.5 by default)
+	/// </summary>
+	static void SetCompactionThreshold(const double liveRatio);
+
+	/// <summary>
+	/// Compacts the eligible segments now on the calling thread instead of waiting for the background thread
+	/// </summary>
+	/// <returns name="compacted">The number of segments compacted</returns>
+	static size_t Compact();
+
+	static LogStoreStats GetStats();
+};
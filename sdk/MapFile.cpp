@@ -0,0 +1,347 @@
+/**
+File:
+	MapFile.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+static void SetError(std::string *error, const std::string &message)
+{
+	if (error)
+		*error = message;
+}
+
+static bool IsFinite(const float value)
+{
+	return value == value && value <= std::numeric_limits<float>::max() && value >= -std::numeric_limits<float>::max();
+}
+
+static bool IsValidRecord(const MapRecord &record)
+{
+	if (record.hash == 0 || (record.flags & ~MAPRECORD_DYNAMIC) != 0 || record.textureVariation < -1)
+		return false;
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (!IsFinite(record.position[i]) || !IsFinite(record.rotation[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool ReadHeader(MappedFile &file, MapFileHeader &header, std::string *error)
+{
+	if (file.GetSize() < sizeof(MapFileHeader))
+	{
+		SetError(error, "file is too small");
+		return false;
+	}
+
+	const uint8_t *data = file.Map(0, sizeof(MapFileHeader));
+	if (!data)
+	{
+		SetError(error, "unable to map header");
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	file.Unmap();
+
+	if (header.magic != MAPFILE_MAGIC || header.version != MAPFILE_VERSION || header.recordSize != sizeof(MapRecord))
+	{
+		SetError(error, "unsupported map format");
+		return false;
+	}
+
+	if (sizeof(MapFileHeader) + (uint64_t)header.recordCount * sizeof(MapRecord) != file.GetSize())
+	{
+		SetError(error, "record count does not match file size");
+		return false;
+	}
+	return true;
+}
+
+uint64_t MapFile::RecordChecksum(const MapRecord &record, const uint32_t index)
+{
+	// FNV-1a over the record, seeded with its index so reordered records are detected
+	const uint8_t *bytes = (const uint8_t *)&record;
+	uint64_t hash = 0xCBF29CE484222325ULL ^ ((uint64_t)index * 0x9E3779B97F4A7C15ULL);
+	for (size_t i = 0; i < sizeof(MapRecord); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+static bool WriteMap(std::ifstream &in, const std::string &output, std::string *error)
+{
+	std::ofstream out(output.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		SetError(error, "unable to create " + output);
+		return false;
+	}
+
+	MapFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAPFILE_MAGIC;
+	header.version = MAPFILE_VERSION;
+	header.recordSize = sizeof(MapRecord);
+	out.write((const char *)&header, sizeof(header));
+
+	std::string line;
+	std::string model;
+	uint32_t lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+
+		const size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#')
+			continue;
+
+		std::istringstream fields(line.substr(start));
+		MapRecord record;
+		memset(&record, 0, sizeof(record));
+
+		int dynamic = 0;
+		int texture = -1;
+		fields >> model >> record.position[0] >> record.position[1] >> record.position[2] >> record.rotation[0] >> record.rotation[1] >> record.rotation[2];
+		if (!fields)
+		{
+			SetError(error, "malformed line " + std::to_string(lineNumber));
+			return false;
+		}
+		if (fields >> dynamic)
+			fields >> texture;
+
+		if (model.size() > 2 && model[0] == '0' && (model[1] == 'x' || model[1] == 'X'))
+			record.hash = (uint32_t)strtoul(model.c_str() + 2, nullptr, 16);
+		else
+			record.hash = Hash::Joaat(model);
+
+		record.flags = dynamic ? MAPRECORD_DYNAMIC : 0;
+		record.textureVariation = (int16_t)texture;
+
+		if (!IsValidRecord(record))
+		{
+			SetError(error, "invalid object on line " + std::to_string(lineNumber));
+			return false;
+		}
+
+		header.checksum += MapFile::RecordChecksum(record, header.recordCount);
+		header.recordCount++;
+		out.write((const char *)&record, sizeof(record));
+	}
+
+	out.seekp(0);
+	out.write((const char *)&header, sizeof(header));
+	out.close();
+	if (!out)
+	{
+		SetError(error, "unable to write " + output);
+		return false;
+	}
+	return true;
+}
+
+bool MapFile::Convert(const std::string &input, const std::string &output, std::string *error)
+{
+	std::ifstream in(input.c_str());
+	if (!in)
+	{
+		SetError(error, "unable to open " + input);
+		return false;
+	}
+
+	// Written next to the output and renamed over it once complete, a failed conversion leaves the old map untouched
+	const std::string temporary = output + ".tmp";
+	std::error_code code;
+	if (!WriteMap(in, temporary, error))
+	{
+		std::filesystem::remove(temporary, code);
+		return false;
+	}
+
+	std::filesystem::rename(temporary, output, code);
+	if (code)
+	{
+		std::filesystem::remove(temporary, code);
+		SetError(error, "unable to replace " + output);
+		return false;
+	}
+	return true;
+}
+
+bool MapFile::Validate(const std::string &path, unsigned int threads, std::string *error)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		SetError(error, "unable to open " + path);
+		return false;
+	}
+
+	MapFileHeader header;
+	if (!ReadHeader(file, header, error))
+		return false;
+	file.Close();
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::max(1u, std::min<unsigned int>(threads, header.recordCount / 4096 + 1));
+
+	// Every worker maps and checks its own slice of the records in windows
+	const uint32_t window = 65536;
+	const uint32_t slice = (header.recordCount + threads - 1) / threads;
+	std::vector<uint64_t> checksums(threads, 0);
+	std::vector<uint32_t> invalid(threads, UINT32_MAX);
+	std::vector<std::thread> workers;
+
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&, t]() {
+			const uint32_t begin = std::min(header.recordCount, t * slice);
+			const uint32_t end = std::min(header.recordCount, begin + slice);
+
+			MappedFile view;
+			if (begin == end || !view.Open(path))
+			{
+				if (begin != end)
+					invalid[t] = begin;
+				return;
+			}
+
+			for (uint32_t first = begin; first < end; first += window)
+			{
+				const uint32_t count = std::min(window, end - first);
+				const MapRecord *records = (const MapRecord *)view.Map(sizeof(MapFileHeader) + (uint64_t)first * sizeof(MapRecord), count * sizeof(MapRecord));
+				if (!records)
+				{
+					invalid[t] = first;
+					return;
+				}
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					if (!IsValidRecord(records[i]))
+					{
+						invalid[t] = first + i;
+						return;
+					}
+					checksums[t] += RecordChecksum(records[i], first + i);
+				}
+			}
+		}));
+	}
+
+	uint64_t checksum = 0;
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers[t].join();
+		checksum += checksums[t];
+	}
+
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		if (invalid[t] != UINT32_MAX)
+		{
+			SetError(error, "invalid record " + std::to_string(invalid[t]));
+			return false;
+		}
+	}
+
+	if (checksum != header.checksum)
+	{
+		SetError(error, "checksum mismatch");
+		return false;
+	}
+	return true;
+}
+
+MapLoader::MapLoader() : Records(nullptr), WindowStart(0), WindowSize(0), Window(0), Count(0), Next(0)
+{
+	//
+}
+
+bool MapLoader::Open(const std::string &path, const uint32_t window)
+{
+	Close();
+
+	if (!File.Open(path))
+		return false;
+
+	MapFileHeader header;
+	if (!ReadHeader(File, header, nullptr))
+	{
+		File.Close();
+		return false;
+	}
+
+	Window = std::max(1u, window);
+	Count = header.recordCount;
+	return true;
+}
+
+uint32_t MapLoader::LoadNext(const uint32_t count, std::vector<int> *entities)
+{
+	uint32_t created = 0;
+	const uint32_t end = Next + std::min(count, Count - Next);
+	while (Next < end)
+	{
+		if (!Records || Next >= WindowStart + WindowSize)
+		{
+			WindowStart = Next;
+			WindowSize = std::min(Window, Count - Next);
+			Records = (const MapRecord *)File.Map(sizeof(MapFileHeader) + (uint64_t)WindowStart * sizeof(MapRecord), WindowSize * sizeof(MapRecord));
+			if (!Records)
+			{
+				WindowSize = 0;
+				break;
+			}
+		}
+
+		const MapRecord &record = Records[Next - WindowStart];
+		const int entity = API::Object::Create((int)record.hash,
+			CVector3(record.position[0], record.position[1], record.position[2]),
+			CVector3(record.rotation[0], record.rotation[1], record.rotation[2]),
+			(record.flags & MAPRECORD_DYNAMIC) != 0);
+		Next++;
+
+		// A rejected object still uses up its record, the count bounds the server calls and not the successes
+		if (entity == -1)
+			continue;
+
+		if (record.textureVariation >= 0)
+			API::Object::SetTextureVariation(entity, record.textureVariation);
+
+		if (entities)
+			entities->push_back(entity);
+		created++;
+	}
+
+	if (Next >= Count)
+	{
+		File.Unmap();
+		Records = nullptr;
+	}
+	return created;
+}
+
+uint32_t MapLoader::LoadAll(std::vector<int> *entities)
+{
+	if (entities)
+		entities->reserve(entities->size() + (Count - Next));
+	return LoadNext(Count - Next, entities);
+}
+
+void MapLoader::Close()
+{
+	File.Close();
+	Records = nullptr;
+	WindowStart = WindowSize = Count = Next = 0;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+/*
+	Binary map format (little endian)
+
+	MapFileHeader   32 bytes
+	MapRecord[n]    32 bytes each
+
+	Records are fixed size and never copied by the loader; it walks them
+	straight out of a mapped window of the file.
+*/
+
+#define MAPFILE_MAGIC		0x4D504D46 // "FMPM"
+#define MAPFILE_VERSION		1
+
+#define MAPRECORD_DYNAMIC	0x01
+
+struct MapFileHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t recordSize;
+	uint32_t recordCount;
+	uint32_t reserved;
+	uint64_t checksum;
+	uint64_t reserved2;
+};
+
+struct MapRecord
+{
+	uint32_t hash;
+	float position[3];
+	float rotation[3];
+	uint8_t flags;
+	uint8_t reserved;
+	int16_t textureVariation; // -1 keeps the models default texture
+};
+
+static_assert(sizeof(MapFileHeader) == 32, "MapFileHeader must be 32 bytes");
+static_assert(sizeof(MapRecord) == 32, "MapRecord must be 32 bytes");
+
+class MapFile
+{
+public:
+	/// <summary>
+	/// Converts a text map into the binary map format.
+	/// Each line is "model x y z rx ry rz [dynamic] [texture]", where model is a model name or a 0x prefixed hash.
+	/// Empty lines and lines starting with # are ignored.
+	/// </summary>
+	/// <param name="input">The path of the text map</param>
+	/// <param name="output">The path of the binary map to write, only replaced once the whole map converted</param>
+	/// <param name="error">Optional, receives a description of the first error</param>
+	/// <returns name="success">True if the map was converted</returns>
+	static bool Convert(const std::string &input, const std::string &output, std::string *error = nullptr);
+
+	/// <summary>
+	/// Validates a binary map, splitting the records across several threads.
+	/// </summary>
+	/// <param name="path">The path of the binary map</param>
+	/// <param name="threads">The number of threads to use (0 uses the hardware concurrency)</param>
+	/// <param name="error">Optional, receives a description of the first error</param>
+	/// <returns name="valid">True if the header, every record and the checksum are valid</returns>
+	static bool Validate(const std::string &path, unsigned int threads = 0, std::string *error = nullptr);
+
+	/// <summary>
+	/// Checksum contribution of a single record, summed over all records to form the file checksum.
+	/// </summary>
+	static uint64_t RecordChecksum(const MapRecord &record, const uint32_t index);
+};
+
+class MapLoader
+{
+public:
+	MapLoader();
+
+	/// <summary>
+	/// Opens a binary map for loading
+	/// </summary>
+	/// <param name="path">The path of the binary map</param>
+	/// <param name="window">The number of records mapped at a time</param>
+	/// <returns name="success">True if the map header is valid</returns>
+	bool Open(const std::string &path, const uint32_t window = 65536);
+
+	/// <summary>
+	/// Creates the next objects of the map, so large maps can be spread over several ticks
+	/// </summary>
+	/// <param name="count">The maximum number of records to load, objects the server rejects are skipped</param>
+	/// <param name="entities">Optional, receives the entity ids of the created objects</param>
+	/// <returns name="created">The number of objects created</returns>
+	uint32_t LoadNext(const uint32_t count, std::vector<int> *entities = nullptr);
+
+	/// <summary>
+	/// Creates all remaining objects of the map
+	/// </summary>
+	/// <param name="entities">Optional, receives the entity ids of the created objects</param>
+	/// <returns name="created">The number of objects created</returns>
+	uint32_t LoadAll(std::vector<int> *entities = nullptr);
+
+	void Close();
+
+	const bool IsFinished() const { return Next >= Count; }
+	const uint32_t GetRecordCount() const { return Count; }
+	const uint32_t GetLoadedCount() const { return Next; }
+
+private:
+	MappedFile File;
+	const MapRecord *Records;
+	uint32_t WindowStart;
+	uint32_t WindowSize;
+	uint32_t Window;
+	uint32_t Count;
+	uint32_t Next;
+};
@@ -0,0 +1,145 @@
+/**
+File:
+	MappedFile.cpp
+*/
+
+#include "../stdafx.h"
+
+#if defined _WIN32 || defined __CYGWIN__
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint64_t MappingGranularity()
+{
+#if defined _WIN32 || defined __CYGWIN__
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+#else
+	return (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+MappedFile::MappedFile() : Handle(InvalidHandle()), Mapping(0), Size(0), View(nullptr), ViewLength(0)
+{
+	//
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string &path)
+{
+	Close();
+
+#if defined _WIN32 || defined __CYGWIN__
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	Handle = (intptr_t)file;
+	Size = (uint64_t)size.QuadPart;
+
+	if (Size > 0)
+		Mapping = (intptr_t)CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0)
+	{
+		close(file);
+		return false;
+	}
+
+	Handle = file;
+	Size = (uint64_t)info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	Unmap();
+
+#if defined _WIN32 || defined __CYGWIN__
+	if (Mapping)
+		CloseHandle((HANDLE)Mapping);
+	if (Handle != InvalidHandle())
+		CloseHandle((HANDLE)Handle);
+#else
+	if (Handle != InvalidHandle())
+		close((int)Handle);
+#endif
+
+	Handle = InvalidHandle();
+	Mapping = 0;
+	Size = 0;
+}
+
+const uint8_t *MappedFile::Map(const uint64_t offset, const size_t length)
+{
+	Unmap();
+
+	if (Handle == InvalidHandle() || length == 0 || offset + length > Size)
+		return nullptr;
+
+	// Views have to start on a granularity boundary, so map slightly more and
+	// hand out a pointer into the view.
+	const uint64_t granularity = MappingGranularity();
+	const uint64_t base = offset - (offset % granularity);
+	const size_t padding = (size_t)(offset - base);
+
+#if defined _WIN32 || defined __CYGWIN__
+	if (!Mapping)
+		return nullptr;
+
+	View = MapViewOfFile((HANDLE)Mapping, FILE_MAP_READ, (DWORD)(base >> 32), (DWORD)(base & 0xFFFFFFFF), length + padding);
+	if (!View)
+		return nullptr;
+#else
+	View = mmap(nullptr, length + padding, PROT_READ, MAP_PRIVATE, (int)Handle, (off_t)base);
+	if (View == MAP_FAILED)
+	{
+		View = nullptr;
+		return nullptr;
+	}
+	madvise(View, length + padding, MADV_SEQUENTIAL);
+#endif
+
+	ViewLength = length + padding;
+	return (const uint8_t *)View + padding;
+}
+
+void MappedFile::Unmap()
+{
+	if (!View)
+		return;
+
+#if defined _WIN32 || defined __CYGWIN__
+	UnmapViewOfFile(View);
+#else
+	munmap(View, ViewLength);
+#endif
+
+	View = nullptr;
+	ViewLength = 0;
+}
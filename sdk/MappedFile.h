@@ -0,0 +1,53 @@
+#pragma once
+
+/// <summary>
+/// Read-only memory mapped file.
+/// Only a window of the file is mapped at a time so large files can be walked
+/// sequentially without ever being resident in full.
+/// </summary>
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/// <summary>
+	/// Opens a file for mapping
+	/// </summary>
+	/// <param name="path">The path of the file</param>
+	/// <returns name="success">True if the file could be opened</returns>
+	bool Open(const std::string &path);
+
+	/// <summary>
+	/// Unmaps the current window and closes the file
+	/// </summary>
+	void Close();
+
+	/// <summary>
+	/// Maps a window of the file, replacing any previously mapped window
+	/// </summary>
+	/// <param name="offset">The byte offset of the window (does not need to be aligned)</param>
+	/// <param name="length">The length of the window in bytes</param>
+	/// <returns name="data">Pointer to the first byte at offset, or nullptr on failure</returns>
+	const uint8_t *Map(const uint64_t offset, const size_t length);
+
+	/// <summary>
+	/// Unmaps the current window
+	/// </summary>
+	void Unmap();
+
+	const bool IsOpen() const { return Handle != InvalidHandle(); }
+	const uint64_t GetSize() const { return Size; }
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+	static intptr_t InvalidHandle() { return -1; }
+
+	intptr_t Handle;
+	intptr_t Mapping;
+	uint64_t Size;
+	void *View;
+	size_t ViewLength;
+};
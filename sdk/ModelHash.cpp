@@ -0,0 +1,18 @@
+/**
+File:
+	ModelHash.cpp
+*/
+
+#include "../stdafx.h"
+
+uint32_t ModelNames::Register(const std::wstring_view model)
+{
+	const Atom atom = Atoms::Intern(model);
+	return atom.IsValid() ? Atoms::HashOf(atom) : Hash::Joaat(model);
+}
+
+const std::wstring *ModelNames::Find(const uint32_t hash)
+{
+	const Atom atom = Atoms::FindHash(hash);
+	return atom.IsValid() ? &Atoms::Name(atom) : nullptr;
+}
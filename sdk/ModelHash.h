@@ -0,0 +1,67 @@
+#pragma once
+
+/// <summary>
+/// The games model name hash (Jenkins one-at-a-time over the lower case name).
+/// The constexpr overloads can be used in templates and case labels, e.g. case "adder"_hash:
+/// </summary>
+namespace Hash
+{
+	namespace Detail
+	{
+		constexpr uint32_t Lower(const uint32_t c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+		constexpr uint32_t Shift6(const uint32_t h) { return h ^ (h >> 6); }
+		constexpr uint32_t Step(const uint32_t h, const uint32_t c) { return Shift6((h + Lower(c)) * 1025u); }
+		constexpr uint32_t Shift11(const uint32_t h) { return h ^ (h >> 11); }
+		constexpr uint32_t Finish(const uint32_t h) { return Shift11(h * 9u) * 32769u; }
+
+		constexpr uint32_t Joaat(const char *s, const uint32_t h) { return *s ? Joaat(s + 1, Step(h, (uint8_t)*s)) : Finish(h); }
+		constexpr uint32_t Joaat(const wchar_t *s, const uint32_t h) { return *s ? Joaat(s + 1, Step(h, (uint32_t)*s)) : Finish(h); }
+		constexpr uint32_t Joaat(const char *s, const size_t n, const uint32_t h) { return n ? Joaat(s + 1, n - 1, Step(h, (uint8_t)*s)) : Finish(h); }
+	}
+
+	constexpr uint32_t Joaat(const char *name) { return Detail::Joaat(name, 0); }
+	constexpr uint32_t Joaat(const wchar_t *name) { return Detail::Joaat(name, 0); }
+
+	inline uint32_t Joaat(const std::string_view name)
+	{
+		uint32_t h = 0;
+		for (size_t i = 0; i < name.size(); i++)
+			h = Detail::Step(h, (uint8_t)name[i]);
+		return Detail::Finish(h);
+	}
+
+	inline uint32_t Joaat(const std::wstring_view name)
+	{
+		uint32_t h = 0;
+		for (size_t i = 0; i < name.size(); i++)
+			h = Detail::Step(h, (uint32_t)name[i]);
+		return Detail::Finish(h);
+	}
+}
+
+constexpr uint32_t operator"" _hash(const char *name, const size_t length) { return Hash::Detail::Joaat(name, length, 0); }
+
+static_assert("adder"_hash == 0xB779A091, "model hash does not match the game");
+static_assert(Hash::Joaat("ADDER") == "adder"_hash, "model hash must be case insensitive");
+
+/// <summary>
+/// Maps model hashes back to their names, so the hash based helpers can be
+/// used with the name based server imports. Backed by the Atoms intern table.
+/// </summary>
+class ModelNames
+{
+public:
+	/// <summary>
+	/// Registers a model name
+	/// </summary>
+	/// <param name="model">The model name</param>
+	/// <returns name="hash">The hash of the model name</returns>
+	static uint32_t Register(const std::wstring_view model);
+
+	/// <summary>
+	/// Finds the name of a registered model hash
+	/// </summary>
+	/// <param name="hash">The model hash</param>
+	/// <returns name="model">The model name, or nullptr if the hash was never registered</returns>
+	static const std::wstring *Find(const uint32_t hash);
+};
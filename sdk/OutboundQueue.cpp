@@ -0,0 +1,333 @@
+/**
+File:
+	OutboundQueue.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <deque>
+#include <unordered_map>
+
+namespace
+{
+	const size_t ChannelCount = (size_t)OutboundChannel::Count;
+	const size_t PriorityCount = (size_t)OutboundPriority::Count;
+
+	struct Limit
+	{
+		double PerSecond;
+		double Burst;
+		size_t MaxQueued;
+	};
+
+	struct Message
+	{
+		uint32_t Key = 0;
+		std::string Text;
+		std::string Extra;
+		std::wstring Wide[4];
+		int IconType = 0;
+		bool Remote = false;
+	};
+
+	struct Channel
+	{
+		double Tokens = -1.0;
+		uint64_t Refilled = 0;
+		std::deque<Message> Queues[PriorityCount];
+		size_t Queued = 0;
+	};
+
+	struct PlayerQueues
+	{
+		Channel Channels[ChannelCount];
+		bool Active = false;
+		uint64_t Sent = 0;
+		uint64_t Dropped = 0;
+		uint64_t Coalesced = 0;
+	};
+
+	struct OutboundState
+	{
+		Limit Limits[ChannelCount] =
+		{
+			{ 5.0, 10.0, 64 },
+			{ 1.0, 3.0, 16 },
+			{ 30.0, 60.0, 256 },
+			{ 2.0, 2.0, 8 }
+		};
+
+		std::unordered_map<int, PlayerQueues> Players;
+		// Players with queued messages, so Drain does not walk everyone
+		std::vector<int> Active;
+		OutboundStats Removed;
+	};
+
+	OutboundState &State()
+	{
+		static OutboundState state;
+		return state;
+	}
+
+	// The API takes its strings by value, the message is popped right after so they are moved in
+	void Send(const int player, const OutboundChannel channel, Message &message)
+	{
+		switch (channel)
+		{
+		case OutboundChannel::Chat:
+			API::Visual::SendChatMessageToPlayer(player, std::move(message.Text));
+			break;
+		case OutboundChannel::Notification:
+			API::Visual::ShowMessageAboveMapToPlayer(player, std::move(message.Wide[0]), std::move(message.Wide[1]), message.IconType, std::move(message.Wide[2]), std::move(message.Wide[3]));
+			break;
+		case OutboundChannel::CefCall:
+			API::CEF::JavaScriptCall(player, std::move(message.Text));
+			break;
+		case OutboundChannel::CefUrl:
+			API::CEF::LoadURL(player, std::move(message.Text), std::move(message.Extra), message.Remote);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// Makes room for one message of a priority, false if the message itself is the one to drop
+	bool MakeRoom(PlayerQueues &queues, Channel &channel, const size_t maxQueued, const OutboundPriority priority)
+	{
+		if (channel.Queued < maxQueued)
+			return true;
+
+		// The oldest message of the lowest priority that is not above the new one goes
+		for (size_t level = PriorityCount; level > (size_t)priority; level--)
+		{
+			std::deque<Message> &queue = channel.Queues[level - 1];
+			if (!queue.empty())
+			{
+				queue.pop_front();
+				channel.Queued--;
+				queues.Dropped++;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	Message *Enqueue(const int player, const OutboundChannel channel, const OutboundPriority priority, const uint32_t key)
+	{
+		OutboundState &state = State();
+		if (channel >= OutboundChannel::Count || priority >= OutboundPriority::Count)
+			return nullptr;
+
+		PlayerQueues &queues = state.Players[player];
+		Channel &target = queues.Channels[(size_t)channel];
+
+		// A newer message with the same key takes the place of the queued one
+		if (key)
+		{
+			for (size_t level = 0; level < PriorityCount; level++)
+			{
+				std::deque<Message> &queue = target.Queues[level];
+				for (size_t i = 0; i < queue.size(); i++)
+				{
+					if (queue[i].Key != key)
+						continue;
+
+					queues.Coalesced++;
+					if (level == (size_t)priority)
+						return &queue[i];
+					queue.erase(queue.begin() + i);
+					target.Queued--;
+					break;
+				}
+			}
+		}
+
+		if (!MakeRoom(queues, target, state.Limits[(size_t)channel].MaxQueued, priority))
+		{
+			queues.Dropped++;
+			return nullptr;
+		}
+		if (!queues.Active)
+		{
+			queues.Active = true;
+			state.Active.push_back(player);
+		}
+
+		target.Queued++;
+		target.Queues[(size_t)priority].emplace_back();
+		Message &message = target.Queues[(size_t)priority].back();
+		message.Key = key;
+		return &message;
+	}
+
+	void Refill(Channel &channel, const Limit &limit, const uint64_t now)
+	{
+		if (channel.Tokens < 0.0)
+		{
+			channel.Tokens = limit.Burst;
+			channel.Refilled = now;
+			return;
+		}
+
+		const double tokens = channel.Tokens + (double)(now - channel.Refilled) * limit.PerSecond / 1000000.0;
+		channel.Tokens = tokens < limit.Burst ? tokens : limit.Burst;
+		channel.Refilled = now;
+	}
+
+	void AddStats(const PlayerQueues &queues, OutboundStats &stats)
+	{
+		for (size_t channel = 0; channel < ChannelCount; channel++)
+		{
+			stats.QueuedByChannel[channel] += queues.Channels[channel].Queued;
+			stats.Queued += queues.Channels[channel].Queued;
+		}
+		stats.Sent += queues.Sent;
+		stats.Dropped += queues.Dropped;
+		stats.Coalesced += queues.Coalesced;
+	}
+}
+
+void OutboundQueue::SendChatMessage(const int player, const std::string_view message, const OutboundPriority priority, const uint32_t key)
+{
+	if (Message *queued = Enqueue(player, OutboundChannel::Chat, priority, key))
+		queued->Text.assign(message);
+}
+
+void OutboundQueue::ShowMessageAboveMap(const int player, const std::wstring_view message, const std::wstring_view pic, const int icontype, const std::wstring_view sender, const std::wstring_view subject, const OutboundPriority priority, const uint32_t key)
+{
+	if (Message *queued = Enqueue(player, OutboundChannel::Notification, priority, key))
+	{
+		queued->Wide[0].assign(message);
+		queued->Wide[1].assign(pic);
+		queued->Wide[2].assign(sender);
+		queued->Wide[3].assign(subject);
+		queued->IconType = icontype;
+	}
+}
+
+void OutboundQueue::JavaScriptCall(const int player, const std::string_view call, const OutboundPriority priority, const uint32_t key)
+{
+	if (Message *queued = Enqueue(player, OutboundChannel::CefCall, priority, key))
+		queued->Text.assign(call);
+}
+
+void OutboundQueue::LoadURL(const int player, const std::string_view url, const std::string_view appcode, const bool remote, const OutboundPriority priority, const uint32_t key)
+{
+	if (Message *queued = Enqueue(player, OutboundChannel::CefUrl, priority, key))
+	{
+		queued->Text.assign(url);
+		queued->Extra.assign(appcode);
+		queued->Remote = remote;
+	}
+}
+
+void OutboundQueue::SetLimit(const OutboundChannel channel, const double perSecond, const uint32_t burst, const uint32_t maxQueued)
+{
+	if (channel >= OutboundChannel::Count)
+		return;
+
+	Limit &limit = State().Limits[(size_t)channel];
+	limit.PerSecond = perSecond;
+	limit.Burst = burst ? (double)burst : 1.0;
+	limit.MaxQueued = maxQueued ? maxQueued : 1;
+}
+
+size_t OutboundQueue::Drain()
+{
+	OutboundState &state = State();
+	const uint64_t now = TickClock::GetTimestamp();
+	size_t sent = 0;
+
+	for (size_t i = 0; i < state.Active.size();)
+	{
+		std::unordered_map<int, PlayerQueues>::iterator it = state.Players.find(state.Active[i]);
+		if (it == state.Players.end())
+		{
+			state.Active[i] = state.Active.back();
+			state.Active.pop_back();
+			continue;
+		}
+
+		const int player = it->first;
+		PlayerQueues &queues = it->second;
+		size_t queued = 0;
+		for (size_t c = 0; c < ChannelCount; c++)
+		{
+			Channel &channel = queues.Channels[c];
+			if (!channel.Queued)
+				continue;
+
+			Refill(channel, state.Limits[c], now);
+			for (size_t level = 0; level < PriorityCount && channel.Tokens >= 1.0; level++)
+			{
+				std::deque<Message> &queue = channel.Queues[level];
+				while (!queue.empty() && channel.Tokens >= 1.0)
+				{
+					Send(player, (OutboundChannel)c, queue.front());
+					queue.pop_front();
+					channel.Queued--;
+					channel.Tokens -= 1.0;
+					queues.Sent++;
+					sent++;
+				}
+			}
+			queued += channel.Queued;
+		}
+
+		if (queued)
+		{
+			i++;
+			continue;
+		}
+
+		queues.Active = false;
+		state.Active[i] = state.Active.back();
+		state.Active.pop_back();
+	}
+	return sent;
+}
+
+void OutboundQueue::RemovePlayer(const int player)
+{
+	OutboundState &state = State();
+	std::unordered_map<int, PlayerQueues>::iterator it = state.Players.find(player);
+	if (it == state.Players.end())
+		return;
+
+	// Messages still queued count as dropped
+	for (size_t channel = 0; channel < ChannelCount; channel++)
+		it->second.Dropped += it->second.Channels[channel].Queued;
+	state.Removed.Sent += it->second.Sent;
+	state.Removed.Dropped += it->second.Dropped;
+	state.Removed.Coalesced += it->second.Coalesced;
+	state.Players.erase(it);
+}
+
+bool OutboundQueue::GetStats(const int player, OutboundStats &stats)
+{
+	OutboundState &state = State();
+	std::unordered_map<int, PlayerQueues>::const_iterator it = state.Players.find(player);
+	if (it == state.Players.end())
+		return false;
+
+	stats = OutboundStats();
+	AddStats(it->second, stats);
+	return true;
+}
+
+OutboundStats OutboundQueue::GetTotals()
+{
+	OutboundState &state = State();
+	OutboundStats stats = state.Removed;
+	for (std::unordered_map<int, PlayerQueues>::const_iterator it = state.Players.begin(); it != state.Players.end(); ++it)
+		AddStats(it->second, stats);
+	return stats;
+}
+
+void OutboundQueue::Clear()
+{
+	OutboundState &state = State();
+	state.Players.clear();
+	state.Active.clear();
+	state.Removed = OutboundStats();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+enum class OutboundChannel : uint8_t
+{
+	Chat,
+	Notification,
+	CefCall,
+	CefUrl,
+	Count
+};
+
+enum class OutboundPriority : uint8_t
+{
+	High,
+	Normal,
+	Low,
+	Count
+};
+
+struct OutboundStats
+{
+	size_t Queued = 0;
+	size_t QueuedByChannel[(size_t)OutboundChannel::Count] = {};
+	uint64_t Sent = 0;
+	// Messages thrown away because the channel's queue was full
+	uint64_t Dropped = 0;
+	// Messages replaced by a newer one with the same key before they were sent
+	uint64_t Coalesced = 0;
+};
+
+/// <summary>
+/// Per player flow control for the messages sent to a client.
+/// Every player has a token bucket per channel, queued messages go out highest priority first as tokens come in,
+/// when Drain is called from API_OnTick. A message with a non zero key replaces the queued message with the same key
+/// on the same channel, so e.g. a scoreboard refreshed every tick is only sent as often as the channel allows.
+/// Tick thread only, other threads can queue through CommandBuffer::Call.
+/// </summary>
+class OutboundQueue
+{
+public:
+	static void SendChatMessage(const int player, const std::string_view message, const OutboundPriority priority = OutboundPriority::Normal, const uint32_t key = 0);
+	static void ShowMessageAboveMap(const int player, const std::wstring_view message, const std::wstring_view pic, const int icontype, const std::wstring_view sender, const std::wstring_view subject, const OutboundPriority priority = OutboundPriority::Normal, const uint32_t key = 0);
+	static void JavaScriptCall(const int player, const std::string_view call, const OutboundPriority priority = OutboundPriority::Normal, const uint32_t key = 0);
+	static void LoadURL(const int player, const std::string_view url, const std::string_view appcode = "", const bool remote = false, const OutboundPriority priority = OutboundPriority::Normal, const uint32_t key = 0);
+
+	/// <summary>
+	/// Sets the limits of a channel for every player
+	/// </summary>
+	/// <param name="channel">The channel</param>
+	/// <param name="perSecond">The sustained number of messages per second</param>
+	/// <param name="burst">The number of messages that can go out at once after a quiet period</param>
+	/// <param name="maxQueued">The queue length past which the lowest priority messages are dropped</param>
+	static void SetLimit(const OutboundChannel channel, const double perSecond, const uint32_t burst, const uint32_t maxQueued);
+
+	/// <summary>
+	/// Sends the queued messages the buckets allow, call once per tick after TickClock::Tick
+	/// </summary>
+	/// <returns name="sent">The number of messages sent</returns>
+	static size_t Drain();
+
+	/// <summary>
+	/// Drops the queues of a player that left
+	/// </summary>
+	static void RemovePlayer(const int player);
+
+	static bool GetStats(const int player, OutboundStats &stats);
+
+	/// <summary>
+	/// Gets the stats summed over every player, including the ones removed
+	/// </summary>
+	static OutboundStats GetTotals();
+
+	static void Clear();
+};
@@ -0,0 +1,112 @@
+/**
+File:
+	PackedStructs.cpp
+*/
+
+#include "../stdafx.h"
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PACKED_SSE2
+#endif
+
+void Packed::PackColors(const Color *input, const size_t count, PackedColor *output)
+{
+	static_assert(sizeof(Color) == 16, "Color has to be four 32 bit channels");
+
+	size_t i = 0;
+#ifdef PACKED_SSE2
+	// Signed saturation to 16 bits and unsigned saturation to 8 bits clamp every channel to 0..255
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i a = _mm_loadu_si128((const __m128i *)(input + i));
+		const __m128i b = _mm_loadu_si128((const __m128i *)(input + i + 1));
+		const __m128i c = _mm_loadu_si128((const __m128i *)(input + i + 2));
+		const __m128i d = _mm_loadu_si128((const __m128i *)(input + i + 3));
+		const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+		_mm_storeu_si128((__m128i *)(output + i), packed);
+	}
+#endif
+	for (; i < count; i++)
+		output[i] = Pack(input[i]);
+}
+
+void Packed::UnpackColors(const PackedColor *input, const size_t count, Color *output)
+{
+	size_t i = 0;
+#ifdef PACKED_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i packed = _mm_loadu_si128((const __m128i *)(input + i));
+		const __m128i low = _mm_unpacklo_epi8(packed, zero);
+		const __m128i high = _mm_unpackhi_epi8(packed, zero);
+		_mm_storeu_si128((__m128i *)(output + i), _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128((__m128i *)(output + i + 1), _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128((__m128i *)(output + i + 2), _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128((__m128i *)(output + i + 3), _mm_unpackhi_epi16(high, zero));
+	}
+#endif
+	for (; i < count; i++)
+		output[i] = Unpack(input[i]);
+}
+
+void Packed::PackPedComponents(const PedComponent *input, const size_t count, PackedPedComponent *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Pack(input[i]);
+}
+
+void Packed::UnpackPedComponents(const PackedPedComponent *input, const size_t count, PedComponent *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Unpack(input[i]);
+}
+
+void Packed::PackPedProps(const PedProp *input, const size_t count, PackedPedProp *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Pack(input[i]);
+}
+
+void Packed::UnpackPedProps(const PackedPedProp *input, const size_t count, PedProp *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Unpack(input[i]);
+}
+
+void Packed::PackPedHeadOverlays(const PedHeadOverlay *input, const size_t count, PackedPedHeadOverlay *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Pack(input[i]);
+}
+
+void Packed::UnpackPedHeadOverlays(const PackedPedHeadOverlay *input, const size_t count, PedHeadOverlay *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Unpack(input[i]);
+}
+
+void Packed::PackPedHeadBlends(const PedHeadBlend *input, const size_t count, PackedPedHeadBlend *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Pack(input[i]);
+}
+
+void Packed::UnpackPedHeadBlends(const PackedPedHeadBlend *input, const size_t count, PedHeadBlend *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Unpack(input[i]);
+}
+
+void Packed::PackPedFeatures(const PedFeature *input, const size_t count, PackedPedFeature *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Pack(input[i]);
+}
+
+void Packed::UnpackPedFeatures(const PackedPedFeature *input, const size_t count, PedFeature *output)
+{
+	for (size_t i = 0; i < count; i++)
+		output[i] = Unpack(input[i]);
+}
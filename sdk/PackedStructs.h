@@ -0,0 +1,220 @@
+#pragma once
+
+// Compact storage formats for the appearance and color structs, for saving outfits and characters.
+// Ids are stored in 8 or 16 bits with -1 kept intact, floats in the 0..1 and -1..1 ranges are quantized.
+// Values outside the stored range are clamped.
+
+// RGBA with 8 bits per channel, red in the lowest byte (4 bytes instead of 16)
+struct PackedColor
+{
+	uint32_t Value;
+};
+
+// Drawable in 16 bits, texture and palette in 8 bits each (4 bytes instead of 12)
+struct PackedPedComponent
+{
+	uint16_t Drawable;
+	uint8_t Texture;
+	uint8_t Palette;
+};
+
+// Drawable and texture in 8 bits each (2 bytes instead of 8)
+struct PackedPedProp
+{
+	uint8_t Drawable;
+	uint8_t Texture;
+};
+
+// Opacity quantized to 1/255 (5 bytes instead of 20)
+struct PackedPedHeadOverlay
+{
+	uint8_t Index;
+	uint8_t Opacity;
+	uint8_t ColorType;
+	uint8_t ColorID;
+	uint8_t SecondColorID;
+};
+
+// Shapes and skins in 8 bits, mixes quantized to 1/65535 (12 bytes instead of 36)
+struct PackedPedHeadBlend
+{
+	uint8_t Shapes[3];
+	uint8_t Skins[3];
+	uint16_t Mixes[3];
+};
+
+// Scale quantized to 1/127 (1 byte instead of 4)
+struct PackedPedFeature
+{
+	int8_t Scale;
+};
+
+static_assert(sizeof(PackedColor) == 4, "PackedColor has to be 4 bytes");
+static_assert(sizeof(PackedPedComponent) == 4, "PackedPedComponent has to be 4 bytes");
+static_assert(sizeof(PackedPedProp) == 2, "PackedPedProp has to be 2 bytes");
+static_assert(sizeof(PackedPedHeadOverlay) == 5, "PackedPedHeadOverlay has to be 5 bytes");
+static_assert(sizeof(PackedPedHeadBlend) == 12, "PackedPedHeadBlend has to be 12 bytes");
+static_assert(sizeof(PackedPedFeature) == 1, "PackedPedFeature has to be 1 byte");
+
+namespace Packed
+{
+	namespace Detail
+	{
+		// Ids are stored plus one so -1 (none) becomes 0
+		inline uint32_t Id(const int value, const uint32_t max)
+		{
+			return value < -1 ? 0 : (uint32_t)(value + 1) > max ? max : (uint32_t)(value + 1);
+		}
+
+		inline uint32_t Quantize(const float value, const float scale)
+		{
+			// Also maps NaN to 0
+			return value > 0.0f ? (value < 1.0f ? (uint32_t)(value * scale + 0.5f) : (uint32_t)scale) : 0;
+		}
+
+		inline uint8_t Byte(const int value)
+		{
+			return (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+		}
+	}
+
+	inline PackedColor Pack(const Color &color)
+	{
+		PackedColor packed;
+		packed.Value = (uint32_t)Detail::Byte(color.Red) | ((uint32_t)Detail::Byte(color.Green) << 8)
+			| ((uint32_t)Detail::Byte(color.Blue) << 16) | ((uint32_t)Detail::Byte(color.Alpha) << 24);
+		return packed;
+	}
+
+	inline Color Unpack(const PackedColor packed)
+	{
+		Color color;
+		color.Red = (int)(packed.Value & 0xFF);
+		color.Green = (int)((packed.Value >> 8) & 0xFF);
+		color.Blue = (int)((packed.Value >> 16) & 0xFF);
+		color.Alpha = (int)(packed.Value >> 24);
+		return color;
+	}
+
+	inline PackedPedComponent Pack(const PedComponent &component)
+	{
+		PackedPedComponent packed;
+		packed.Drawable = (uint16_t)Detail::Id(component.drawableid, 0xFFFF);
+		packed.Texture = (uint8_t)Detail::Id(component.textureid, 0xFF);
+		packed.Palette = (uint8_t)Detail::Id(component.paletteid, 0xFF);
+		return packed;
+	}
+
+	inline PedComponent Unpack(const PackedPedComponent packed)
+	{
+		PedComponent component;
+		component.drawableid = (int)packed.Drawable - 1;
+		component.textureid = (int)packed.Texture - 1;
+		component.paletteid = (int)packed.Palette - 1;
+		return component;
+	}
+
+	inline PackedPedProp Pack(const PedProp &prop)
+	{
+		PackedPedProp packed;
+		packed.Drawable = (uint8_t)Detail::Id(prop.drawableid, 0xFF);
+		packed.Texture = (uint8_t)Detail::Id(prop.textureid, 0xFF);
+		return packed;
+	}
+
+	inline PedProp Unpack(const PackedPedProp packed)
+	{
+		PedProp prop;
+		prop.drawableid = (int)packed.Drawable - 1;
+		prop.textureid = (int)packed.Texture - 1;
+		return prop;
+	}
+
+	inline PackedPedHeadOverlay Pack(const PedHeadOverlay &overlay)
+	{
+		// Overlay index 255 is the game's "none", -1 is stored the same way
+		PackedPedHeadOverlay packed;
+		packed.Index = (uint8_t)(overlay.index == -1 ? 255 : Detail::Byte(overlay.index));
+		packed.Opacity = (uint8_t)Detail::Quantize(overlay.opacity, 255.0f);
+		packed.ColorType = Detail::Byte(overlay.colorType);
+		packed.ColorID = Detail::Byte(overlay.colorID);
+		packed.SecondColorID = Detail::Byte(overlay.secondColorID);
+		return packed;
+	}
+
+	inline PedHeadOverlay Unpack(const PackedPedHeadOverlay packed)
+	{
+		PedHeadOverlay overlay;
+		overlay.index = packed.Index;
+		overlay.opacity = (float)packed.Opacity * (1.0f / 255.0f);
+		overlay.colorType = packed.ColorType;
+		overlay.colorID = packed.ColorID;
+		overlay.secondColorID = packed.SecondColorID;
+		return overlay;
+	}
+
+	inline PackedPedHeadBlend Pack(const PedHeadBlend &blend)
+	{
+		PackedPedHeadBlend packed;
+		packed.Shapes[0] = Detail::Byte(blend.shapeFirst);
+		packed.Shapes[1] = Detail::Byte(blend.shapeSecond);
+		packed.Shapes[2] = Detail::Byte(blend.shapeThird);
+		packed.Skins[0] = Detail::Byte(blend.skinFirst);
+		packed.Skins[1] = Detail::Byte(blend.skinSecond);
+		packed.Skins[2] = Detail::Byte(blend.skinThird);
+		packed.Mixes[0] = (uint16_t)Detail::Quantize(blend.shapeMix, 65535.0f);
+		packed.Mixes[1] = (uint16_t)Detail::Quantize(blend.skinMix, 65535.0f);
+		packed.Mixes[2] = (uint16_t)Detail::Quantize(blend.thirdMix, 65535.0f);
+		return packed;
+	}
+
+	inline PedHeadBlend Unpack(const PackedPedHeadBlend &packed)
+	{
+		PedHeadBlend blend;
+		blend.shapeFirst = packed.Shapes[0];
+		blend.shapeSecond = packed.Shapes[1];
+		blend.shapeThird = packed.Shapes[2];
+		blend.skinFirst = packed.Skins[0];
+		blend.skinSecond = packed.Skins[1];
+		blend.skinThird = packed.Skins[2];
+		blend.shapeMix = (float)packed.Mixes[0] * (1.0f / 65535.0f);
+		blend.skinMix = (float)packed.Mixes[1] * (1.0f / 65535.0f);
+		blend.thirdMix = (float)packed.Mixes[2] * (1.0f / 65535.0f);
+		return blend;
+	}
+
+	inline PackedPedFeature Pack(const PedFeature &feature)
+	{
+		PackedPedFeature packed;
+		const float scale = feature.scale < 1.0f ? (feature.scale > -1.0f ? feature.scale : -1.0f) : 1.0f;
+		packed.Scale = (int8_t)(scale * 127.0f + (scale < 0.0f ? -0.5f : 0.5f));
+		return packed;
+	}
+
+	inline PedFeature Unpack(const PackedPedFeature packed)
+	{
+		PedFeature feature;
+		feature.scale = (float)packed.Scale * (1.0f / 127.0f);
+		return feature;
+	}
+
+	/// <summary>
+	/// Packs or unpacks arrays of structs. Colors are converted four at a time with SSE2 where available,
+	/// the other loops are branch free so the compiler can vectorize them.
+	/// </summary>
+	/// <param name="input">The structs to convert</param>
+	/// <param name="count">The number of structs</param>
+	/// <param name="output">Receives count converted structs</param>
+	void PackColors(const Color *input, const size_t count, PackedColor *output);
+	void UnpackColors(const PackedColor *input, const size_t count, Color *output);
+	void PackPedComponents(const PedComponent *input, const size_t count, PackedPedComponent *output);
+	void UnpackPedComponents(const PackedPedComponent *input, const size_t count, PedComponent *output);
+	void PackPedProps(const PedProp *input, const size_t count, PackedPedProp *output);
+	void UnpackPedProps(const PackedPedProp *input, const size_t count, PedProp *output);
+	void PackPedHeadOverlays(const PedHeadOverlay *input, const size_t count, PackedPedHeadOverlay *output);
+	void UnpackPedHeadOverlays(const PackedPedHeadOverlay *input, const size_t count, PedHeadOverlay *output);
+	void PackPedHeadBlends(const PedHeadBlend *input, const size_t count, PackedPedHeadBlend *output);
+	void UnpackPedHeadBlends(const PackedPedHeadBlend *input, const size_t count, PedHeadBlend *output);
+	void PackPedFeatures(const PedFeature *input, const size_t count, PackedPedFeature *output);
+	void UnpackPedFeatures(const PackedPedFeature *input, const size_t count, PedFeature *output);
+}
@@ -0,0 +1,390 @@
+/**
+File:
+	Parallel.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define PARALLEL_PAUSE() _mm_pause()
+#else
+#define PARALLEL_PAUSE() std::this_thread::yield()
+#endif
+
+namespace
+{
+	const size_t MaxSlots = 64;
+	// Chunks per participant when the grain is picked automatically, enough to even out uneven bodies
+	const size_t ChunksPerSlot = 8;
+	// Chunks shorter than this spend a noticeable share on taking them
+	const double MinChunkNanoseconds = 2000.0;
+	// Loops with less work than this run on the calling thread, waking sleeping helpers costs more
+	const double SerialNanoseconds = 50000.0;
+	const double SerialSpinningNanoseconds = 5000.0;
+	const uint32_t AutomaticSpin = 0xFFFFFFFFu;
+	const uint32_t DefaultSpinMicroseconds = 200;
+	const size_t CostSlots = 64;
+
+	// Measured cost of a loop body, bodies are told apart by their function (For and ForEach make one per call site)
+	struct BodyCost
+	{
+		Parallel::RangeBody Body = nullptr;
+		double NanosecondsPerItem = 0.0;
+	};
+
+	// A participant's remaining range, begin in the low and end in the high 32 bits so it can be split with one CAS
+	struct alignas(64) Range
+	{
+		std::atomic<uint64_t> Bounds{ 0 };
+	};
+
+	struct Loop
+	{
+		Parallel::RangeBody Body;
+		void *Context;
+		size_t Grain;
+		size_t Slots;
+		std::atomic<size_t> Remaining{ 0 };
+		std::atomic<uint64_t> Steals{ 0 };
+		// Time the participants spent in chunks and stealing, without the fork/join itself
+		std::atomic<uint64_t> WorkNanoseconds{ 0 };
+		Range Ranges[MaxSlots];
+	};
+
+	struct ParallelState
+	{
+		std::vector<std::thread> Helpers;
+		std::mutex Mutex;
+		std::condition_variable Wake;
+		size_t Sleeping = 0;
+		std::atomic<bool> Stopping{ false };
+
+		std::atomic<Loop *> Current{ nullptr };
+		std::atomic<uint64_t> Generation{ 0 };
+		// Helpers that may still be looking at Current, the loop lives on the caller's stack until this is 0
+		std::atomic<size_t> Busy{ 0 };
+
+		// What the helpers spin, worked out from SpinMicroseconds by every Run
+		std::atomic<uint32_t> Spin{ DefaultSpinMicroseconds };
+		uint32_t SpinMicroseconds = AutomaticSpin;
+		size_t SerialThreshold = 256;
+		BodyCost Costs[CostSlots];
+		bool Running = false;
+		ParallelStats Stats;
+
+		~ParallelState()
+		{
+			Shutdown();
+		}
+
+		void Shutdown()
+		{
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+				Stopping.store(true);
+			}
+			Wake.notify_all();
+			for (size_t i = 0; i < Helpers.size(); i++)
+				Helpers[i].join();
+			Helpers.clear();
+			Stopping.store(false);
+		}
+	};
+
+	ParallelState &State()
+	{
+		static ParallelState state;
+		return state;
+	}
+
+	// Slot of the loop this thread is running a chunk of, nested loops run serially in it
+	thread_local size_t CurrentSlot = 0;
+	thread_local bool InLoop = false;
+
+	uint64_t Pack(const size_t begin, const size_t end)
+	{
+		return (uint64_t)begin | ((uint64_t)end << 32);
+	}
+
+	size_t BeginOf(const uint64_t bounds)
+	{
+		return (size_t)(bounds & 0xFFFFFFFFu);
+	}
+
+	size_t EndOf(const uint64_t bounds)
+	{
+		return (size_t)(bounds >> 32);
+	}
+
+	// Takes a grain sized chunk from the front of the participant's own range
+	bool TakeOwn(Loop &loop, const size_t slot, size_t &begin, size_t &end)
+	{
+		std::atomic<uint64_t> &bounds = loop.Ranges[slot].Bounds;
+		uint64_t current = bounds.load(std::memory_order_acquire);
+		for (;;)
+		{
+			begin = BeginOf(current);
+			const size_t last = EndOf(current);
+			if (begin >= last)
+				return false;
+
+			end = last - begin > loop.Grain ? begin + loop.Grain : last;
+			if (bounds.compare_exchange_weak(current, Pack(end, last), std::memory_order_acq_rel, std::memory_order_acquire))
+				return true;
+		}
+	}
+
+	// Moves the back half of another participant's range into the (empty) own range
+	bool Steal(Loop &loop, const size_t slot)
+	{
+		for (size_t offset = 1; offset < loop.Slots; offset++)
+		{
+			std::atomic<uint64_t> &bounds = loop.Ranges[(slot + offset) % loop.Slots].Bounds;
+			uint64_t current = bounds.load(std::memory_order_acquire);
+			for (;;)
+			{
+				const size_t begin = BeginOf(current);
+				const size_t end = EndOf(current);
+				if (begin >= end)
+					break;
+
+				// Small ranges are taken whole rather than split below the grain
+				const size_t middle = end - begin > loop.Grain * 2 ? begin + (end - begin) / 2 : begin;
+				if (bounds.compare_exchange_weak(current, Pack(begin, middle), std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					// Thieves skip empty ranges, so only this participant writes its own one here
+					loop.Ranges[slot].Bounds.store(Pack(middle, end), std::memory_order_release);
+					loop.Steals.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void Participate(Loop &loop, const size_t slot)
+	{
+		InLoop = true;
+		CurrentSlot = slot;
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		size_t begin, end;
+		do
+		{
+			while (TakeOwn(loop, slot, begin, end))
+			{
+				loop.Body(loop.Context, begin, end, slot);
+				loop.Remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+			}
+		} while (Steal(loop, slot));
+		loop.WorkNanoseconds.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+
+		InLoop = false;
+		CurrentSlot = 0;
+	}
+
+	void HelperLoop(ParallelState *state, const size_t slot)
+	{
+		uint64_t seen = state->Generation.load();
+		for (;;)
+		{
+			// Spin for the next loop first, a tick usually runs several back to back
+			const auto spinUntil = std::chrono::steady_clock::now() + std::chrono::microseconds(state->Spin.load(std::memory_order_relaxed));
+			uint32_t spins = 0;
+			while (state->Generation.load() == seen && !state->Stopping.load(std::memory_order_relaxed))
+			{
+				PARALLEL_PAUSE();
+				if ((++spins & 63) == 0 && std::chrono::steady_clock::now() >= spinUntil)
+				{
+					std::unique_lock<std::mutex> lock(state->Mutex);
+					state->Sleeping++;
+					state->Wake.wait(lock, [state, seen] { return state->Generation.load() != seen || state->Stopping.load(); });
+					state->Sleeping--;
+					break;
+				}
+			}
+
+			if (state->Stopping.load())
+				return;
+			seen = state->Generation.load();
+
+			state->Busy.fetch_add(1);
+			if (Loop *loop = state->Current.load())
+			{
+				if (slot < loop->Slots)
+					Participate(*loop, slot);
+			}
+			state->Busy.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	BodyCost &CostOf(ParallelState &state, Parallel::RangeBody body)
+	{
+		const uintptr_t address = (uintptr_t)body;
+		return state.Costs[(address ^ (address >> 6) ^ (address >> 12)) % CostSlots];
+	}
+
+	// Smoothed, so one slow run (e.g. a page fault) does not flip the next loops to serial or parallel
+	void RecordCost(ParallelState &state, Parallel::RangeBody body, const double nanosecondsPerItem)
+	{
+		BodyCost &cost = CostOf(state, body);
+		if (cost.Body != body)
+		{
+			cost.Body = body;
+			cost.NanosecondsPerItem = nanosecondsPerItem;
+		}
+		else
+			cost.NanosecondsPerItem += (nanosecondsPerItem - cost.NanosecondsPerItem) / 4.0;
+	}
+
+	double ElapsedNanoseconds(const std::chrono::steady_clock::time_point start)
+	{
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void EnsureStarted(ParallelState &state)
+	{
+		if (!state.Running)
+			Parallel::Start();
+	}
+}
+
+void Parallel::Start(const size_t threads)
+{
+	ParallelState &state = State();
+	if (state.Running)
+		return;
+
+	size_t count = threads;
+	if (count == 0)
+	{
+		const size_t hardware = std::thread::hardware_concurrency();
+		count = hardware > 1 ? hardware - 1 : 0;
+	}
+	if (count > MaxSlots - 1)
+		count = MaxSlots - 1;
+
+	state.Running = true;
+	for (size_t i = 0; i < count; i++)
+		state.Helpers.emplace_back(HelperLoop, &state, i + 1);
+}
+
+void Parallel::Stop()
+{
+	ParallelState &state = State();
+	if (!state.Running)
+		return;
+
+	state.Shutdown();
+	state.Running = false;
+}
+
+size_t Parallel::GetSlotCount()
+{
+	ParallelState &state = State();
+	EnsureStarted(state);
+	return state.Helpers.size() + 1;
+}
+
+void Parallel::Run(const size_t count, RangeBody body, void *context, const size_t grain)
+{
+	ParallelState &state = State();
+	if (count == 0 || !body)
+		return;
+	EnsureStarted(state);
+
+	if (InLoop)
+	{
+		body(context, 0, count, CurrentSlot);
+		return;
+	}
+
+	// Spinning helpers would compete with the WorkerPool's workers for the cores, they sleep right away then
+	const uint32_t spin = state.SpinMicroseconds != AutomaticSpin ? state.SpinMicroseconds : WorkerPool::IsRunning() ? 0 : DefaultSpinMicroseconds;
+	state.Spin.store(spin, std::memory_order_relaxed);
+
+	// Loops with too little work are not worth waking anyone for, unless the caller picked the grain for coarse items.
+	// Until a body is timed the count decides.
+	const size_t slots = state.Helpers.size() + 1;
+	const BodyCost &cost = CostOf(state, body);
+	const double perItem = cost.Body == body ? cost.NanosecondsPerItem : -1.0;
+	bool serial = slots == 1 || count == 1 || count > 0xFFFFFFFFu;
+	if (!grain && !serial)
+		serial = perItem >= 0.0 ? perItem * (double)count < (spin ? SerialSpinningNanoseconds : SerialNanoseconds) : count < state.SerialThreshold;
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (serial)
+	{
+		state.Stats.SerialRuns++;
+		body(context, 0, count, 0);
+		RecordCost(state, body, ElapsedNanoseconds(start) / (double)count);
+		return;
+	}
+
+	Loop loop;
+	loop.Body = body;
+	loop.Context = context;
+	loop.Slots = slots;
+	loop.Grain = grain;
+	if (!grain)
+	{
+		// Enough chunks to balance uneven bodies, but none so short that taking it costs more than running it
+		loop.Grain = count / (slots * ChunksPerSlot);
+		if (perItem > 0.0 && (double)loop.Grain * perItem < MinChunkNanoseconds)
+			loop.Grain = std::min((size_t)(MinChunkNanoseconds / perItem), count / slots);
+	}
+	if (loop.Grain == 0)
+		loop.Grain = 1;
+	loop.Remaining.store(count, std::memory_order_relaxed);
+
+	// Even split, every participant starts on its own range
+	for (size_t i = 0; i < slots; i++)
+		loop.Ranges[i].Bounds.store(Pack(count * i / slots, count * (i + 1) / slots), std::memory_order_relaxed);
+
+	state.Current.store(&loop);
+	state.Generation.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		if (state.Sleeping)
+			state.Wake.notify_all();
+	}
+
+	Participate(loop, 0);
+	while (loop.Remaining.load(std::memory_order_acquire) != 0)
+		PARALLEL_PAUSE();
+
+	// Helpers that arrive from here on see no loop, wait for the ones still looking at this one
+	state.Current.store(nullptr);
+	while (state.Busy.load() != 0)
+		PARALLEL_PAUSE();
+
+	state.Stats.Runs++;
+	state.Stats.Steals += loop.Steals.load(std::memory_order_relaxed);
+	state.Stats.LastGrain = loop.Grain;
+	RecordCost(state, body, (double)loop.WorkNanoseconds.load(std::memory_order_relaxed) / (double)count);
+}
+
+void Parallel::SetSerialThreshold(const size_t count)
+{
+	State().SerialThreshold = count;
+}
+
+void Parallel::SetSpinMicroseconds(const uint32_t microseconds)
+{
+	State().SpinMicroseconds = microseconds;
+}
+
+ParallelStats Parallel::GetStats()
+{
+	ParallelState &state = State();
+	ParallelStats stats = state.Stats;
+	stats.Threads = state.Helpers.size();
+	return stats;
+}
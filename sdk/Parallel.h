@@ -0,0 +1,124 @@
+#pragma once
+
+struct ParallelStats
+{
+	size_t Threads = 0;
+	uint64_t Runs = 0;
+	// Runs that were small enough (or nested) to run on the calling thread only
+	uint64_t SerialRuns = 0;
+	uint64_t Steals = 0;
+	// Chunk size of the last parallel loop
+	size_t LastGrain = 0;
+};
+
+/// <summary>
+/// Work stealing parallel loops for per entity updates inside a tick.
+/// The index range is split over the calling thread and the helper threads, every participant takes grain
+/// sized chunks from the front of its own range and steals half of another range from the back once it runs dry.
+/// Helper threads spin for a moment after a loop so back to back loops start without a wake up, unless the
+/// WorkerPool runs, whose workers would otherwise compete with them for the cores.
+/// The time every loop body takes per index is measured, so later loops of the same body pick their grain
+/// from it and run on the calling thread when waking the helpers would cost more than the loop.
+/// Loops are started from one thread at a time (the tick thread), nested loops run serially.
+/// The body must not call API:: functions, only the calling thread may.
+/// </summary>
+class Parallel
+{
+public:
+	typedef void (*RangeBody)(void *context, const size_t begin, const size_t end, const size_t slot);
+
+	/// <summary>
+	/// Starts the helper threads, the first loop starts them otherwise
+	/// </summary>
+	/// <param name="threads">The number of helpers, 0 for one less than the number of hardware threads</param>
+	static void Start(const size_t threads = 0);
+	static void Stop();
+
+	/// <summary>
+	/// Gets the number of participants (helpers plus the calling thread), slot indices are below this
+	/// </summary>
+	static size_t GetSlotCount();
+
+	/// <summary>
+	/// Calls body for disjoint chunks covering [0, count) and returns once all of them are done
+	/// </summary>
+	/// <param name="count">The number of indices</param>
+	/// <param name="body">Called with a chunk and the slot of the participant running it</param>
+	/// <param name="context">Passed to body as is</param>
+	/// <param name="grain">The chunk size, 0 picks one from count, the number of participants and the measured cost of the body</param>
+	static void Run(const size_t count, RangeBody body, void *context, const size_t grain = 0);
+
+	/// <summary>
+	/// Loops smaller than this run on the calling thread when no grain is given and the body was never timed (256 by default)
+	/// </summary>
+	static void SetSerialThreshold(const size_t count);
+
+	/// <summary>
+	/// Sets how long helpers spin for the next loop before they sleep.
+	/// By default 200, or 0 while the WorkerPool runs.
+	/// </summary>
+	static void SetSpinMicroseconds(const uint32_t microseconds);
+
+	static ParallelStats GetStats();
+
+	/// <summary>
+	/// Calls body(begin, end) for chunks of [0, count)
+	/// </summary>
+	template <typename F>
+	static void For(const size_t count, F &&body, const size_t grain = 0)
+	{
+		Run(count, [](void *context, const size_t begin, const size_t end, const size_t) { (*(std::remove_reference_t<F> *)context)(begin, end); }, &body, grain);
+	}
+
+	/// <summary>
+	/// Calls body(item) for every item of a contiguous array, e.g. entity ids or per entity state
+	/// </summary>
+	template <typename T, typename F>
+	static void ForEach(T *items, const size_t count, F &&body, const size_t grain = 0)
+	{
+		struct Loop
+		{
+			T *Items;
+			std::remove_reference_t<F> *Body;
+		} loop = { items, &body };
+
+		Run(count, [](void *context, const size_t begin, const size_t end, const size_t)
+		{
+			const Loop &loop = *(const Loop *)context;
+			for (size_t i = begin; i < end; i++)
+				(*loop.Body)(loop.Items[i]);
+		}, &loop, grain);
+	}
+
+	/// <summary>
+	/// Maps chunks of [0, count) to partial results with map(begin, end) and combines them with combine(a, b).
+	/// Chunks are combined in no particular order, combine has to be associative and commutative.
+	/// </summary>
+	template <typename T, typename Map, typename Combine>
+	static T Reduce(const size_t count, const T identity, Map &&map, Combine &&combine, const size_t grain = 0)
+	{
+		// Own cache line per slot, and no std::vector<bool> packing slots into shared words
+		struct alignas(64) Partial
+		{
+			T Value;
+		};
+
+		struct Loop
+		{
+			std::vector<Partial> Partials;
+			std::remove_reference_t<Map> *MapChunk;
+			std::remove_reference_t<Combine> *CombineChunks;
+		} loop = { std::vector<Partial>(GetSlotCount(), Partial{ identity }), &map, &combine };
+
+		Run(count, [](void *context, const size_t begin, const size_t end, const size_t slot)
+		{
+			Loop &loop = *(Loop *)context;
+			loop.Partials[slot].Value = (*loop.CombineChunks)(loop.Partials[slot].Value, (*loop.MapChunk)(begin, end));
+		}, &loop, grain);
+
+		T result = identity;
+		for (size_t i = 0; i < loop.Partials.size(); i++)
+			result = combine(result, loop.Partials[i].Value);
+		return result;
+	}
+};
@@ -0,0 +1,327 @@
+/**
+File:
+	PlateIndex.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	const uint32_t FilterHashes = 4;
+	const uint32_t GenerateAttempts = 64;
+	// The filter is rebuilt once more plates left it than it holds live ones, but not more often than this
+	const size_t RebuildMinimum = 1024;
+
+	struct PlateSlot
+	{
+		uint64_t Key;
+		int Entity;
+	};
+
+	struct PlateState
+	{
+		// Open addressing with linear probing, key 0 marks an empty slot
+		std::vector<PlateSlot> Slots = std::vector<PlateSlot>(256, PlateSlot{ 0, -1 });
+		size_t Count = 0;
+		std::unordered_map<int, uint64_t> EntityKeys;
+
+		// Bloom filter over the indexed, reserved and recently generated plates.
+		// Removed plates cannot be cleared from it, so it is rebuilt once enough of them piled up.
+		std::vector<uint64_t> Filter = std::vector<uint64_t>((1 << 20) / 64, 0);
+		std::unordered_set<uint64_t> Reserved;
+		// Generated since the last rebuild, kept through the next one so they can still be set
+		std::vector<uint64_t> Generated;
+		size_t Stale = 0;
+
+		uint64_t Random = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() | 1;
+	};
+
+	PlateState &State()
+	{
+		static PlateState state;
+		return state;
+	}
+
+	uint64_t Mix(uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xBF58476D1CE4E5B9ULL;
+		x ^= x >> 27;
+		x *= 0x94D049BB133111EBULL;
+		x ^= x >> 31;
+		return x;
+	}
+
+	template <typename Char>
+	uint64_t Pack(const Char *text, size_t length)
+	{
+		while (length && text[0] == ' ')
+		{
+			text++;
+			length--;
+		}
+		while (length && text[length - 1] == ' ')
+			length--;
+
+		if (length == 0 || length > PlateIndex::MaxLength)
+			return 0;
+
+		uint64_t key = 0;
+		for (size_t i = 0; i < length; i++)
+		{
+			uint32_t c = (uint32_t)text[i];
+			if (c < 0x20 || c > 0x7E)
+				return 0;
+			if (c >= 'a' && c <= 'z')
+				c -= 'a' - 'A';
+			key |= (uint64_t)c << (i * 8);
+		}
+		return key;
+	}
+
+	size_t FindSlot(const PlateState &state, const uint64_t key)
+	{
+		const size_t mask = state.Slots.size() - 1;
+		size_t slot = (size_t)Mix(key) & mask;
+		while (state.Slots[slot].Key != 0 && state.Slots[slot].Key != key)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	void Insert(PlateState &state, const uint64_t key, const int entity)
+	{
+		if ((state.Count + 1) * 2 > state.Slots.size())
+		{
+			std::vector<PlateSlot> old(state.Slots.size() * 2, PlateSlot{ 0, -1 });
+			old.swap(state.Slots);
+			for (size_t i = 0; i < old.size(); i++)
+			{
+				if (old[i].Key)
+					state.Slots[FindSlot(state, old[i].Key)] = old[i];
+			}
+		}
+
+		PlateSlot &slot = state.Slots[FindSlot(state, key)];
+		if (slot.Key == 0)
+			state.Count++;
+		slot.Key = key;
+		slot.Entity = entity;
+	}
+
+	void Erase(PlateState &state, const uint64_t key)
+	{
+		const size_t mask = state.Slots.size() - 1;
+		size_t hole = FindSlot(state, key);
+		if (state.Slots[hole].Key == 0)
+			return;
+
+		// Backward shift deletion keeps probe chains intact without tombstones
+		state.Slots[hole].Key = 0;
+		state.Count--;
+		for (size_t next = (hole + 1) & mask; state.Slots[next].Key != 0; next = (next + 1) & mask)
+		{
+			const size_t home = (size_t)Mix(state.Slots[next].Key) & mask;
+			if (((next - home) & mask) >= ((next - hole) & mask))
+			{
+				state.Slots[hole] = state.Slots[next];
+				state.Slots[next].Key = 0;
+				hole = next;
+			}
+		}
+	}
+
+	void FilterAdd(PlateState &state, const uint64_t key)
+	{
+		const uint64_t hash = Mix(key);
+		const uint64_t bits = state.Filter.size() * 64;
+		for (uint32_t i = 0; i < FilterHashes; i++)
+		{
+			const uint64_t bit = ((hash & 0xFFFFFFFF) + i * (hash >> 32)) & (bits - 1);
+			state.Filter[bit / 64] |= 1ULL << (bit % 64);
+		}
+	}
+
+	bool FilterContains(const PlateState &state, const uint64_t key)
+	{
+		const uint64_t hash = Mix(key);
+		const uint64_t bits = state.Filter.size() * 64;
+		for (uint32_t i = 0; i < FilterHashes; i++)
+		{
+			const uint64_t bit = ((hash & 0xFFFFFFFF) + i * (hash >> 32)) & (bits - 1);
+			if (!(state.Filter[bit / 64] & (1ULL << (bit % 64))))
+				return false;
+		}
+		return true;
+	}
+
+	void RebuildFilter(PlateState &state)
+	{
+		std::fill(state.Filter.begin(), state.Filter.end(), 0);
+		for (size_t i = 0; i < state.Slots.size(); i++)
+		{
+			if (state.Slots[i].Key)
+				FilterAdd(state, state.Slots[i].Key);
+		}
+		for (std::unordered_set<uint64_t>::const_iterator it = state.Reserved.begin(); it != state.Reserved.end(); ++it)
+			FilterAdd(state, *it);
+		for (size_t i = 0; i < state.Generated.size(); i++)
+			FilterAdd(state, state.Generated[i]);
+
+		state.Generated.clear();
+		state.Stale = 0;
+	}
+
+	uint64_t NextRandom(PlateState &state)
+	{
+		// xorshift64*
+		state.Random ^= state.Random >> 12;
+		state.Random ^= state.Random << 25;
+		state.Random ^= state.Random >> 27;
+		return state.Random * 0x2545F4914F6CDD1DULL;
+	}
+}
+
+uint64_t PlateIndex::Normalize(const std::string_view plate)
+{
+	return Pack(plate.data(), plate.size());
+}
+
+uint64_t PlateIndex::Normalize(const std::wstring_view plate)
+{
+	return Pack(plate.data(), plate.size());
+}
+
+std::wstring PlateIndex::ToWide(const uint64_t key)
+{
+	std::wstring plate;
+	for (size_t i = 0; i < MaxLength && (key >> (i * 8)) & 0xFF; i++)
+		plate += (wchar_t)((key >> (i * 8)) & 0xFF);
+	return plate;
+}
+
+void PlateIndex::Set(const int entity, const std::wstring_view plate)
+{
+	PlateState &state = State();
+	Remove(entity);
+
+	const uint64_t key = Normalize(plate);
+	if (key == 0)
+		return;
+
+	// A plate can only belong to one vehicle, the newest one wins
+	const size_t slot = FindSlot(state, key);
+	if (state.Slots[slot].Key == key)
+		state.EntityKeys.erase(state.Slots[slot].Entity);
+
+	Insert(state, key, entity);
+	state.EntityKeys[entity] = key;
+	FilterAdd(state, key);
+}
+
+void PlateIndex::Remove(const int entity)
+{
+	PlateState &state = State();
+	std::unordered_map<int, uint64_t>::iterator it = state.EntityKeys.find(entity);
+	if (it == state.EntityKeys.end())
+		return;
+
+	Erase(state, it->second);
+	state.EntityKeys.erase(it);
+	state.Stale++;
+}
+
+int PlateIndex::Find(const std::string_view plate)
+{
+	return Find(Normalize(plate));
+}
+
+int PlateIndex::Find(const std::wstring_view plate)
+{
+	return Find(Normalize(plate));
+}
+
+int PlateIndex::Find(const uint64_t key)
+{
+	if (key == 0)
+		return -1;
+
+	const PlateState &state = State();
+	const PlateSlot &slot = state.Slots[FindSlot(state, key)];
+	return slot.Key == key ? slot.Entity : -1;
+}
+
+void PlateIndex::Reserve(const std::wstring_view plate)
+{
+	PlateState &state = State();
+	const uint64_t key = Normalize(plate);
+	if (key && state.Reserved.insert(key).second)
+		FilterAdd(state, key);
+}
+
+std::wstring PlateIndex::Generate(const std::string_view pattern)
+{
+	static const char Letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	static const char Alphanumerics[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+	PlateState &state = State();
+	const size_t length = pattern.size() < MaxLength ? pattern.size() : (size_t)MaxLength;
+
+	if (state.Stale >= RebuildMinimum && state.Stale > state.Count + state.Reserved.size())
+		RebuildFilter(state);
+
+	// A crowded filter gets one rebuild and another round of attempts before giving up
+	for (uint32_t attempt = 0; attempt < GenerateAttempts * 2; attempt++)
+	{
+		if (attempt == GenerateAttempts)
+		{
+			if (state.Stale == 0)
+				break;
+			RebuildFilter(state);
+		}
+
+		uint64_t key = 0;
+		uint64_t random = NextRandom(state);
+		for (size_t i = 0; i < length; i++)
+		{
+			uint64_t c = (uint8_t)pattern[i];
+			if (c == '#')
+				c = '0' + random % 10;
+			else if (c == '@')
+				c = Letters[random % 26];
+			else if (c == '?')
+				c = Alphanumerics[random % 36];
+			random = random / 37 ? random / 37 : NextRandom(state);
+			key |= c << (i * 8);
+		}
+
+		// Anything not in the filter is neither indexed nor reserved
+		if (Normalize(ToWide(key)) == key && !FilterContains(state, key))
+		{
+			FilterAdd(state, key);
+			state.Generated.push_back(key);
+			return ToWide(key);
+		}
+	}
+	return std::wstring();
+}
+
+void PlateIndex::SetFilterSize(const size_t bits)
+{
+	PlateState &state = State();
+
+	size_t words = 1;
+	while (words * 64 < bits)
+		words *= 2;
+	state.Filter.assign(words, 0);
+	state.Reserved.clear();
+	RebuildFilter(state);
+}
+
+size_t PlateIndex::GetCount()
+{
+	return State().Count;
+}
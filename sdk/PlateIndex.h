@@ -0,0 +1,68 @@
+#pragma once
+
+/// <summary>
+/// Number plate to vehicle index.
+/// Plates are normalized (trimmed, upper case, at most 8 characters) and packed into a
+/// 64 bit key, so lookups hash an integer and never allocate. Tick thread only.
+/// The Vehicle wrapper keeps the index up to date through SetNumberPlate and Destroy.
+/// </summary>
+class PlateIndex
+{
+public:
+	static const size_t MaxLength = 8;
+
+	/// <summary>
+	/// Packs a plate into its normalized key
+	/// </summary>
+	/// <returns name="key">The key, 0 if the plate is empty, too long or has non ASCII characters</returns>
+	static uint64_t Normalize(const std::string_view plate);
+	static uint64_t Normalize(const std::wstring_view plate);
+
+	/// <summary>
+	/// Unpacks a key into the plate text
+	/// </summary>
+	static std::wstring ToWide(const uint64_t key);
+
+	/// <summary>
+	/// Sets the indexed plate of a vehicle, replacing its previous plate
+	/// </summary>
+	/// <param name="entity">The vehicle entity</param>
+	/// <param name="plate">The plate</param>
+	static void Set(const int entity, const std::wstring_view plate);
+
+	/// <summary>
+	/// Removes a vehicle from the index
+	/// </summary>
+	static void Remove(const int entity);
+
+	/// <summary>
+	/// Finds the vehicle with a plate
+	/// </summary>
+	/// <returns name="entity">The vehicle entity, -1 if no indexed vehicle has the plate</returns>
+	static int Find(const std::string_view plate);
+	static int Find(const std::wstring_view plate);
+	static int Find(const uint64_t key);
+
+	/// <summary>
+	/// Adds a plate that is in use but not indexed (e.g. saved vehicles that are not spawned)
+	/// to the membership filter used by Generate, it stays reserved until SetFilterSize
+	/// </summary>
+	static void Reserve(const std::wstring_view plate);
+
+	/// <summary>
+	/// Generates a plate that is neither indexed nor reserved.
+	/// In the pattern # is a digit, @ a letter, ? a letter or digit, and anything else is kept as is.
+	/// The filter is rebuilt from the index and reserved plates once removed plates pile up in it,
+	/// so a generated plate is only held back until the rebuild after next unless it is set or reserved.
+	/// </summary>
+	/// <param name="pattern">The pattern, at most 8 characters</param>
+	/// <returns name="plate">The plate, empty if no free plate was found</returns>
+	static std::wstring Generate(const std::string_view pattern = "????????");
+
+	/// <summary>
+	/// Sets the size of the membership filter in bits (rounded up to a power of two), clears reserved plates
+	/// </summary>
+	static void SetFilterSize(const size_t bits);
+
+	static size_t GetCount();
+};
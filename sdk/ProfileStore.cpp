@@ -0,0 +1,724 @@
+/**
+File:
+	ProfileStore.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define PROFILE_IO_URING
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	enum class RequestState : uint8_t
+	{
+		Reading,
+		Ready,
+		Failed
+	};
+
+	struct Request
+	{
+		std::string Path;
+		std::atomic<RequestState> State{ RequestState::Reading };
+		PlayerProfile Profile;
+		// Matches its entry in the expiry queue
+		uint64_t Sequence = 0;
+		// A Get returned the profile, it is kept until Release or Save
+		bool Claimed = false;
+
+		// Copied from the store so workers never look at it
+		ProfileDecoder Decoder = nullptr;
+		ProfileDestructor Destructor = nullptr;
+		void *Context = nullptr;
+
+		int Fd = -1;
+	};
+
+	// Prefetches in the order they were made, unclaimed ones expire from the front
+	struct PendingClaim
+	{
+		Clock::time_point Since;
+		uint64_t Sequence;
+		std::string Guid;
+	};
+
+	struct SaveJob
+	{
+		std::string Guid;
+		std::string Path;
+		// Unique per job, two jobs never share a temporary file
+		std::string Temporary;
+		std::vector<uint8_t> Data;
+		bool Written = false;
+	};
+
+	// One write per guid at a time, saves made meanwhile only keep the latest data
+	struct SaveSlot
+	{
+		std::vector<uint8_t> Latest;
+		// Latest is newer than the write in flight
+		bool Queued = false;
+	};
+
+	void Decode(Request &request)
+	{
+		if (request.Decoder && request.Profile.Found)
+			request.Profile.Decoded = request.Decoder(request.Context, request.Profile.Data.data(), request.Profile.Data.size());
+	}
+
+	void Destroy(Request &request)
+	{
+		if (request.Destructor && request.Profile.Decoded)
+			request.Destructor(request.Context, request.Profile.Decoded);
+		request.Profile.Decoded = nullptr;
+	}
+
+	// Thread pool backend, also the fallback for reads io_uring could not take
+	void ReadJob(void *context)
+	{
+		Request &request = *(Request *)context;
+		std::ifstream in(request.Path.c_str(), std::ios::binary | std::ios::ate);
+		if (!in)
+		{
+			// No file is a new player, not a failure
+			std::error_code error;
+			const bool exists = std::filesystem::exists(request.Path, error);
+			request.State.store(exists || error ? RequestState::Failed : RequestState::Ready, std::memory_order_release);
+			return;
+		}
+
+		const std::streamoff size = in.tellg();
+		in.seekg(0);
+		request.Profile.Data.resize((size_t)size);
+		if (size > 0 && !in.read((char *)request.Profile.Data.data(), size))
+		{
+			request.State.store(RequestState::Failed, std::memory_order_release);
+			return;
+		}
+
+		request.Profile.Found = true;
+		Decode(request);
+		request.State.store(RequestState::Ready, std::memory_order_release);
+	}
+
+	void WriteJob(void *context)
+	{
+		SaveJob &job = *(SaveJob *)context;
+		std::error_code error;
+		{
+			std::ofstream out(job.Temporary.c_str(), std::ios::binary | std::ios::trunc);
+			if (!out || !out.write((const char *)job.Data.data(), (std::streamsize)job.Data.size()))
+			{
+				out.close();
+				std::filesystem::remove(job.Temporary, error);
+				return;
+			}
+		}
+
+		std::filesystem::rename(job.Temporary, job.Path, error);
+		if (error)
+			std::filesystem::remove(job.Temporary, error);
+		else
+			job.Written = true;
+	}
+
+	void FinishSave(void *context);
+
+#ifdef PROFILE_IO_URING
+	// Minimal io_uring over the raw system calls, one submitter (the tick thread) and reads only
+	class Ring
+	{
+	private:
+		int Fd = -1;
+		unsigned Entries = 0;
+		// Queued entries the kernel has not taken yet because io_uring_enter was interrupted
+		unsigned Unsubmitted = 0;
+		unsigned *SqHead = nullptr;
+		unsigned *SqTail = nullptr;
+		unsigned *SqMask = nullptr;
+		unsigned *SqArray = nullptr;
+		io_uring_sqe *Sqes = nullptr;
+		unsigned *CqHead = nullptr;
+		unsigned *CqTail = nullptr;
+		unsigned *CqMask = nullptr;
+		io_uring_cqe *Cqes = nullptr;
+
+		void *SqRing = MAP_FAILED;
+		size_t SqRingSize = 0;
+		void *CqRing = MAP_FAILED;
+		size_t CqRingSize = 0;
+		size_t SqesSize = 0;
+
+	public:
+		~Ring()
+		{
+			Close();
+		}
+
+		bool Open(const unsigned entries)
+		{
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+			Fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+			if (Fd < 0)
+				return false;
+
+			Entries = params.sq_entries;
+			SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (single)
+				SqRingSize = CqRingSize = SqRingSize > CqRingSize ? SqRingSize : CqRingSize;
+
+			SqRing = mmap(nullptr, SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+			if (SqRing == MAP_FAILED)
+			{
+				Close();
+				return false;
+			}
+			CqRing = single ? SqRing : mmap(nullptr, CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_CQ_RING);
+			SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			void *sqes = mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES);
+			if (CqRing == MAP_FAILED || sqes == MAP_FAILED)
+			{
+				if (sqes != MAP_FAILED)
+					munmap(sqes, SqesSize);
+				Close();
+				return false;
+			}
+
+			uint8_t *sq = (uint8_t *)SqRing;
+			uint8_t *cq = (uint8_t *)CqRing;
+			SqHead = (unsigned *)(sq + params.sq_off.head);
+			SqTail = (unsigned *)(sq + params.sq_off.tail);
+			SqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+			SqArray = (unsigned *)(sq + params.sq_off.array);
+			Sqes = (io_uring_sqe *)sqes;
+			CqHead = (unsigned *)(cq + params.cq_off.head);
+			CqTail = (unsigned *)(cq + params.cq_off.tail);
+			CqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+			Cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+			return true;
+		}
+
+		void Close()
+		{
+			if (Sqes)
+				munmap(Sqes, SqesSize);
+			if (CqRing != MAP_FAILED && CqRing != SqRing)
+				munmap(CqRing, CqRingSize);
+			if (SqRing != MAP_FAILED)
+				munmap(SqRing, SqRingSize);
+			if (Fd >= 0)
+				close(Fd);
+
+			Fd = -1;
+			Sqes = nullptr;
+			SqRing = CqRing = MAP_FAILED;
+		}
+
+		bool IsOpen() const
+		{
+			return Fd >= 0;
+		}
+
+		void Submit()
+		{
+			if (!Unsubmitted)
+				return;
+
+			const int submitted = (int)syscall(__NR_io_uring_enter, Fd, Unsubmitted, 0, 0, nullptr, 0);
+			if (submitted > 0)
+				Unsubmitted -= (unsigned)submitted;
+		}
+
+		// False if the submission queue is full, once queued the entry is submitted by this or a later call
+		bool Read(const int fd, void *buffer, const unsigned length, void *userData)
+		{
+			const unsigned tail = *SqTail;
+			if (tail - __atomic_load_n(SqHead, __ATOMIC_ACQUIRE) >= Entries)
+				return false;
+
+			const unsigned index = tail & *SqMask;
+			io_uring_sqe &sqe = Sqes[index];
+			memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = IORING_OP_READ;
+			sqe.fd = fd;
+			sqe.addr = (uint64_t)(uintptr_t)buffer;
+			sqe.len = length;
+			sqe.off = 0;
+			sqe.user_data = (uint64_t)(uintptr_t)userData;
+			SqArray[index] = index;
+			__atomic_store_n(SqTail, tail + 1, __ATOMIC_RELEASE);
+
+			Unsubmitted++;
+			Submit();
+			return true;
+		}
+
+		// Calls done(userData, result) for every completion, only enters the kernel for entries still unsubmitted
+		template <typename F>
+		size_t Reap(F &&done)
+		{
+			Submit();
+			unsigned head = *CqHead;
+			const unsigned tail = __atomic_load_n(CqTail, __ATOMIC_ACQUIRE);
+			size_t reaped = 0;
+			while (head != tail)
+			{
+				const io_uring_cqe &cqe = Cqes[head & *CqMask];
+				done((void *)(uintptr_t)cqe.user_data, cqe.res);
+				head++;
+				reaped++;
+			}
+			__atomic_store_n(CqHead, head, __ATOMIC_RELEASE);
+			return reaped;
+		}
+	};
+#endif
+
+	struct StoreState
+	{
+		bool Opened = false;
+		std::string Directory;
+		std::unordered_map<std::string, std::unique_ptr<Request>> Requests;
+		// Released while still loading, freed once their read is done
+		std::vector<std::unique_ptr<Request>> Abandoned;
+		std::deque<PendingClaim> Claims;
+		uint64_t Sequence = 0;
+		Clock::duration ClaimTimeout = std::chrono::seconds(120);
+
+		ProfileDecoder Decoder = nullptr;
+		ProfileDestructor Destructor = nullptr;
+		void *Context = nullptr;
+
+#ifdef PROFILE_IO_URING
+		Ring Uring;
+#endif
+		std::unordered_map<std::string, SaveSlot> Saves;
+		uint64_t SaveSequence = 0;
+
+		ProfileStoreStats Stats;
+		uint64_t WaitTotal = 0;
+		uint64_t Waits = 0;
+	};
+
+	StoreState &State()
+	{
+		static StoreState state;
+		return state;
+	}
+
+	// Guids are used as file names, everything but letters, digits, '-' and '_' is hex escaped
+	std::string PathOf(const StoreState &state, const std::string_view guid)
+	{
+		static const char Hex[] = "0123456789abcdef";
+		std::string path = state.Directory;
+		path += '/';
+		for (size_t i = 0; i < guid.size(); i++)
+		{
+			const unsigned char c = (unsigned char)guid[i];
+			if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '_')
+				path += (char)c;
+			else
+			{
+				path += '%';
+				path += Hex[c >> 4];
+				path += Hex[c & 15];
+			}
+		}
+		path += ".profile";
+		return path;
+	}
+
+	void SubmitToPool(Request &request)
+	{
+		WorkerPool::Submit(ReadJob, nullptr, &request);
+	}
+
+	void SubmitSave(StoreState &state, const std::string &guid, SaveSlot &slot)
+	{
+		SaveJob *job = new SaveJob();
+		job->Guid = guid;
+		job->Path = PathOf(state, guid);
+		job->Temporary = job->Path + "." + std::to_string(++state.SaveSequence) + ".tmp";
+		job->Data = slot.Latest;
+		slot.Queued = false;
+		WorkerPool::Submit(WriteJob, FinishSave, job);
+	}
+
+	void FinishSave(void *context)
+	{
+		StoreState &state = State();
+		std::unique_ptr<SaveJob> job((SaveJob *)context);
+		if (!job->Written)
+			state.Stats.SaveFailures++;
+
+		std::unordered_map<std::string, SaveSlot>::iterator it = state.Saves.find(job->Guid);
+		if (it == state.Saves.end())
+			return;
+		if (it->second.Queued)
+			SubmitSave(state, it->first, it->second);
+		else
+			state.Saves.erase(it);
+	}
+
+	// Loads a request from data that is not on disk yet, so reads never see an older file
+	void LoadFromSave(Request &request, const std::vector<uint8_t> &data)
+	{
+		request.Profile.Found = true;
+		request.Profile.Data = data;
+		Decode(request);
+		request.State.store(RequestState::Ready, std::memory_order_release);
+	}
+
+	// Drops a cached request, a read still in flight is freed once it is done
+	void Drop(StoreState &state, std::unordered_map<std::string, std::unique_ptr<Request>>::iterator it)
+	{
+		if (it->second->State.load(std::memory_order_acquire) == RequestState::Reading)
+			state.Abandoned.push_back(std::move(it->second));
+		else
+			Destroy(*it->second);
+		state.Requests.erase(it);
+	}
+
+#ifdef PROFILE_IO_URING
+	// Opens and sizes the file here (metadata only), the read itself goes through the ring
+	bool SubmitToRing(StoreState &state, Request &request)
+	{
+		const int fd = open(request.Path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			request.State.store(errno == ENOENT ? RequestState::Ready : RequestState::Failed, std::memory_order_release);
+			return true;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size > 0x7FFFFFFF)
+		{
+			close(fd);
+			return false;
+		}
+
+		request.Profile.Found = true;
+		request.Profile.Data.resize((size_t)info.st_size);
+		if (info.st_size == 0)
+		{
+			close(fd);
+			Decode(request);
+			request.State.store(RequestState::Ready, std::memory_order_release);
+			return true;
+		}
+
+		request.Fd = fd;
+		if (state.Uring.Read(fd, request.Profile.Data.data(), (unsigned)info.st_size, &request))
+			return true;
+
+		// Submission queue full
+
+		close(fd);
+		request.Fd = -1;
+		request.Profile.Found = false;
+		return false;
+	}
+#endif
+
+	void Reap(StoreState &state)
+	{
+#ifdef PROFILE_IO_URING
+		if (!state.Uring.IsOpen())
+			return;
+
+		state.Uring.Reap([](void *userData, const int result)
+		{
+			Request &request = *(Request *)userData;
+			close(request.Fd);
+			request.Fd = -1;
+
+			// Short or failed reads (e.g. a kernel without IORING_OP_READ) are retried on the pool
+			if (result < 0 || (size_t)result != request.Profile.Data.size())
+			{
+				request.Profile.Found = false;
+				request.Profile.Data.clear();
+				SubmitToPool(request);
+				return;
+			}
+
+			Decode(request);
+			request.State.store(RequestState::Ready, std::memory_order_release);
+		});
+#endif
+	}
+
+	void FreeAbandoned(StoreState &state)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < state.Abandoned.size(); i++)
+		{
+			if (state.Abandoned[i]->State.load(std::memory_order_acquire) == RequestState::Reading)
+				state.Abandoned[kept++] = std::move(state.Abandoned[i]);
+			else
+				Destroy(*state.Abandoned[i]);
+		}
+		state.Abandoned.resize(kept);
+	}
+
+	// Players that never got paired or dropped while connecting would keep their profile until Close otherwise
+	void ExpireUnclaimed(StoreState &state)
+	{
+		const Clock::time_point now = Clock::now();
+		while (!state.Claims.empty() && now - state.Claims.front().Since > state.ClaimTimeout)
+		{
+			const PendingClaim &claim = state.Claims.front();
+			std::unordered_map<std::string, std::unique_ptr<Request>>::iterator it = state.Requests.find(claim.Guid);
+			if (it != state.Requests.end() && it->second->Sequence == claim.Sequence && !it->second->Claimed)
+			{
+				state.Stats.Misses++;
+				state.Stats.Expired++;
+				Drop(state, it);
+			}
+			state.Claims.pop_front();
+		}
+	}
+
+	bool AnyReading(const StoreState &state)
+	{
+		for (std::unordered_map<std::string, std::unique_ptr<Request>>::const_iterator it = state.Requests.begin(); it != state.Requests.end(); ++it)
+		{
+			if (it->second->State.load(std::memory_order_acquire) == RequestState::Reading)
+				return true;
+		}
+		return !state.Abandoned.empty();
+	}
+}
+
+bool ProfileStore::Open(const std::string &directory, const bool ioUring)
+{
+	StoreState &state = State();
+	Close();
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+		return false;
+
+	state.Directory = directory;
+	state.Opened = true;
+	state.Stats = ProfileStoreStats();
+#ifdef PROFILE_IO_URING
+	// Not available in some containers and seccomp profiles, the pool takes over then
+	if (ioUring)
+		state.Stats.IoUring = state.Uring.Open(256);
+#else
+	(void)ioUring;
+#endif
+	return true;
+}
+
+void ProfileStore::Close()
+{
+	StoreState &state = State();
+	if (!state.Opened)
+		return;
+
+	// Buffers in flight belong to the kernel or a worker until their read is done, and pending saves are written out
+	for (;;)
+	{
+		Reap(state);
+		FreeAbandoned(state);
+		if (!AnyReading(state) && state.Saves.empty())
+			break;
+		WorkerPool::Drain();
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	for (std::unordered_map<std::string, std::unique_ptr<Request>>::iterator it = state.Requests.begin(); it != state.Requests.end(); ++it)
+		Destroy(*it->second);
+	state.Requests.clear();
+	state.Claims.clear();
+#ifdef PROFILE_IO_URING
+	state.Uring.Close();
+#endif
+	state.Opened = false;
+}
+
+bool ProfileStore::IsOpen()
+{
+	return State().Opened;
+}
+
+void ProfileStore::SetDecoder(ProfileDecoder decoder, ProfileDestructor destructor, void *context)
+{
+	StoreState &state = State();
+	state.Decoder = decoder;
+	state.Destructor = destructor;
+	state.Context = context;
+}
+
+void ProfileStore::Prefetch(const std::string_view guid)
+{
+	StoreState &state = State();
+	if (!state.Opened)
+		return;
+
+	std::unique_ptr<Request> &slot = state.Requests[std::string(guid)];
+	if (slot)
+		return;
+
+	slot.reset(new Request());
+	Request &request = *slot;
+	request.Path = PathOf(state, guid);
+	request.Decoder = state.Decoder;
+	request.Destructor = state.Destructor;
+	request.Context = state.Context;
+	request.Sequence = ++state.Sequence;
+	state.Claims.push_back({ Clock::now(), request.Sequence, std::string(guid) });
+	state.Stats.Prefetches++;
+
+	std::unordered_map<std::string, SaveSlot>::const_iterator save = state.Saves.find(std::string(guid));
+	if (save != state.Saves.end())
+	{
+		LoadFromSave(request, save->second.Latest);
+		return;
+	}
+
+#ifdef PROFILE_IO_URING
+	if (state.Uring.IsOpen() && SubmitToRing(state, request))
+		return;
+#endif
+	SubmitToPool(request);
+}
+
+void ProfileStore::Poll()
+{
+	StoreState &state = State();
+	if (!state.Opened)
+		return;
+
+	Reap(state);
+	FreeAbandoned(state);
+	ExpireUnclaimed(state);
+}
+
+const PlayerProfile *ProfileStore::Get(const std::string_view guid, const uint32_t waitMicroseconds)
+{
+	StoreState &state = State();
+	std::unordered_map<std::string, std::unique_ptr<Request>>::iterator it = state.Requests.find(std::string(guid));
+	if (it == state.Requests.end())
+	{
+		state.Stats.Misses++;
+		return nullptr;
+	}
+
+	Request &request = *it->second;
+	Reap(state);
+	RequestState current = request.State.load(std::memory_order_acquire);
+	bool waited = false;
+	if (current == RequestState::Reading && waitMicroseconds)
+	{
+		// Bounded wait, polling keeps the ring free of blocking system calls
+		const Clock::time_point start = Clock::now();
+		const Clock::time_point deadline = start + std::chrono::microseconds(waitMicroseconds);
+		while (current == RequestState::Reading && Clock::now() < deadline)
+		{
+			std::this_thread::yield();
+			Reap(state);
+			current = request.State.load(std::memory_order_acquire);
+		}
+
+		waited = true;
+		state.WaitTotal += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+		state.Waits++;
+	}
+
+	if (current == RequestState::Ready)
+	{
+		request.Claimed = true;
+		if (waited)
+			state.Stats.WaitHits++;
+		else
+			state.Stats.Hits++;
+		return &request.Profile;
+	}
+
+	state.Stats.Misses++;
+	if (current == RequestState::Failed)
+	{
+		// A failed read is dropped so the next Prefetch tries again
+		state.Stats.Failures++;
+		Destroy(request);
+		state.Requests.erase(it);
+	}
+	return nullptr;
+}
+
+void ProfileStore::Release(const std::string_view guid)
+{
+	StoreState &state = State();
+	std::unordered_map<std::string, std::unique_ptr<Request>>::iterator it = state.Requests.find(std::string(guid));
+	if (it == state.Requests.end())
+		return;
+
+	Drop(state, it);
+}
+
+void ProfileStore::SetClaimTimeout(const uint32_t seconds)
+{
+	State().ClaimTimeout = std::chrono::seconds(seconds);
+}
+
+bool ProfileStore::Save(const std::string_view guid, const void *data, const size_t size)
+{
+	StoreState &state = State();
+	if (!state.Opened || (!data && size))
+		return false;
+
+	// A profile loaded before this save is outdated now
+	const std::string key(guid);
+	std::unordered_map<std::string, std::unique_ptr<Request>>::iterator cached = state.Requests.find(key);
+	if (cached != state.Requests.end())
+		Drop(state, cached);
+
+	std::unordered_map<std::string, SaveSlot>::iterator it = state.Saves.find(key);
+	const bool writing = it != state.Saves.end();
+	if (!writing)
+		it = state.Saves.emplace(key, SaveSlot()).first;
+
+	SaveSlot &slot = it->second;
+	slot.Latest.assign((const uint8_t *)data, (const uint8_t *)data + size);
+	slot.Queued = true;
+	if (!writing)
+		SubmitSave(state, it->first, slot);
+	state.Stats.Saves++;
+	return true;
+}
+
+ProfileStoreStats ProfileStore::GetStats()
+{
+	const StoreState &state = State();
+	ProfileStoreStats stats = state.Stats;
+	const uint64_t gets = stats.Hits + stats.WaitHits + stats.Misses;
+	stats.HitRate = gets ? (double)(stats.Hits + stats.WaitHits) / (double)gets : 0.0;
+	stats.AverageWaitMicroseconds = state.Waits ? (double)state.WaitTotal / (double)state.Waits : 0.0;
+	return stats;
+}
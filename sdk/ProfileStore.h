@@ -0,0 +1,103 @@
+#pragma once
+
+// Turns the raw bytes of a saved profile into the plugin's own object. Runs on a worker thread with the thread
+// pool backend and on the tick thread with io_uring, so it has to be thread safe and must not call API:: functions.
+typedef void *(*ProfileDecoder)(void *context, const uint8_t *data, const size_t size);
+typedef void (*ProfileDestructor)(void *context, void *profile);
+
+struct PlayerProfile
+{
+	// False for a guid without a saved profile, e.g. a new player
+	bool Found = false;
+	std::vector<uint8_t> Data;
+	// What the decoder made of Data, nullptr without a decoder
+	void *Decoded = nullptr;
+};
+
+struct ProfileStoreStats
+{
+	bool IoUring = false;
+	uint64_t Prefetches = 0;
+	// Gets that found the profile already loaded
+	uint64_t Hits = 0;
+	// Gets that had to wait and got it within the wait
+	uint64_t WaitHits = 0;
+	// Gets that ran out of time or had no prefetch, and prefetches nobody got in time
+	uint64_t Misses = 0;
+	// Prefetched profiles dropped because no Get claimed them within the claim timeout
+	uint64_t Expired = 0;
+	uint64_t Failures = 0;
+	uint64_t Saves = 0;
+	uint64_t SaveFailures = 0;
+	double AverageWaitMicroseconds = 0.0;
+	// (Hits + WaitHits) / Gets
+	double HitRate = 0.0;
+};
+
+/// <summary>
+/// Loads player profiles ahead of time, keyed by guid.
+/// API_OnPlayerConnecting starts the read and by API_OnPlayerConnected (or a JoinPipeline stage) it is usually loaded
+/// and decoded, Get waits a bounded time for it otherwise. Reads go through io_uring on Linux when the kernel allows it
+/// and through the WorkerPool elsewhere. Profiles are files in a directory, one per guid. Tick thread only.
+/// The connected player is linked to its guid through JoinPipeline::GetGuid, which is empty for unpaired players.
+/// While many players connect at once almost all of them are unpaired, so prefetching only pays off then if the
+/// plugin knows the guid of a connected player and passes it to JoinPipeline::OnConnected.
+/// </summary>
+class ProfileStore
+{
+public:
+	/// <summary>
+	/// Opens the store, creating the directory if needed
+	/// </summary>
+	/// <param name="directory">The directory of the profile files</param>
+	/// <param name="ioUring">Use io_uring where available</param>
+	/// <returns name="opened">False if the directory could not be created</returns>
+	static bool Open(const std::string &directory, const bool ioUring = true);
+
+	/// <summary>
+	/// Waits for the reads and saves in flight and drops every loaded profile. Call before WorkerPool::Stop.
+	/// </summary>
+	static void Close();
+
+	static bool IsOpen();
+
+	static void SetDecoder(ProfileDecoder decoder, ProfileDestructor destructor, void *context);
+
+	/// <summary>
+	/// Starts loading a profile, call from API_OnPlayerConnecting. Does nothing if it is loading or loaded already.
+	/// A profile no Get returned within the claim timeout is dropped again by Poll.
+	/// </summary>
+	static void Prefetch(const std::string_view guid);
+
+	/// <summary>
+	/// Collects finished reads and drops unclaimed prefetches, call once per tick
+	/// </summary>
+	static void Poll();
+
+	/// <summary>
+	/// Gets a prefetched profile, waiting up to the given time for it if it is still loading
+	/// </summary>
+	/// <returns name="profile">The profile, nullptr if it is not loaded (yet) or the read failed. Valid until Release or Save of the guid.</returns>
+	static const PlayerProfile *Get(const std::string_view guid, const uint32_t waitMicroseconds = 5000);
+
+	/// <summary>
+	/// Drops a loaded profile, e.g. once it is copied into the player's state
+	/// </summary>
+	static void Release(const std::string_view guid);
+
+	/// <summary>
+	/// Sets how long a prefetched profile is kept without a Get returning it (120 seconds by default).
+	/// The server gives no guid on connect or disconnect, so a player that drops while connecting or is never
+	/// paired with its guid by the JoinPipeline would otherwise keep its profile loaded until Close.
+	/// </summary>
+	static void SetClaimTimeout(const uint32_t seconds);
+
+	/// <summary>
+	/// Writes a profile on a worker thread, the file is replaced in one step.
+	/// Saves of a guid are written one at a time and only the latest of those made meanwhile is written. A loaded
+	/// profile of the guid is dropped and a Prefetch before the write is done loads the saved data.
+	/// </summary>
+	static bool Save(const std::string_view guid, const void *data, const size_t size);
+
+	static ProfileStoreStats GetStats();
+};
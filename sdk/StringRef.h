@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+	/// <summary>
+	/// Non-owning pointer and length view of a narrow (UTF-8) string.
+	/// Plain C layout so it can cross the plugin boundary independently of the standard library.
+	/// Used for the text carried by events and recorded commands. The server imports and callbacks take
+	/// std::string / std::wstring by value, so there is no pointer and length entry point on the server side yet.
+	/// </summary>
+	struct StringRef
+	{
+		const char *Data;
+		size_t Length;
+	};
+
+	/// <summary>
+	/// Non-owning pointer and length view of a wide string.
+	/// </summary>
+	struct WStringRef
+	{
+		const wchar_t *Data;
+		size_t Length;
+	};
+#ifdef __cplusplus
+}
+#endif
+
+inline StringRef ToRef(const std::string_view view) { StringRef ref = { view.data(), view.size() }; return ref; }
+inline WStringRef ToRef(const std::wstring_view view) { WStringRef ref = { view.data(), view.size() }; return ref; }
+
+inline std::string_view ToView(const StringRef ref) { return std::string_view(ref.Data, ref.Length); }
+inline std::wstring_view ToView(const WStringRef ref) { return std::wstring_view(ref.Data, ref.Length); }
+
+inline std::string ToString(const StringRef ref) { return std::string(ref.Data, ref.Length); }
+inline std::wstring ToString(const WStringRef ref) { return std::wstring(ref.Data, ref.Length); }
@@ -0,0 +1,437 @@
+/**
+File:
+	SystemScheduler.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Ticks looked at when picking the offset of a low rate system, in intervals
+	const uint64_t BalanceHorizon = 1 << 16;
+	const double AverageWeight = 0.1;
+
+	struct System
+	{
+		int Id;
+		const char *Name;
+		SystemFunction Run;
+		void *Context;
+		SystemPhase Phase;
+		uint64_t Reads;
+		uint64_t Writes;
+		uint32_t Interval;
+		uint32_t Offset = 0;
+		bool TickThread;
+		bool Removed = false;
+		bool Balanced = false;
+		uint32_t Wave = 0;
+
+		// Written by the thread running the system, read by the tick thread after the wave
+		uint32_t Slot = 0;
+		uint32_t Start = 0;
+		uint32_t Duration = 0;
+		uint64_t Runs = 0;
+		double Average = 0.0;
+		uint64_t Max = 0;
+	};
+
+	struct Wave
+	{
+		std::vector<System *> Parallel;
+		std::vector<System *> TickThread;
+	};
+
+	struct TickTimeline
+	{
+		uint64_t Tick = 0;
+		uint64_t StartMicroseconds = 0;
+		std::vector<SystemTiming> Systems;
+	};
+
+	struct SchedulerState
+	{
+		std::vector<std::unique_ptr<System>> Systems;
+		std::vector<std::string> Resources;
+		int NextId = 0;
+		bool Dirty = false;
+		std::vector<Wave> Phases[(size_t)SystemPhase::Count];
+
+		uint64_t TickCount = 0;
+		Clock::time_point Epoch = Clock::now();
+
+		// Reused every tick
+		std::vector<System *> Due;
+		std::vector<System *> Ran;
+
+		std::vector<TickTimeline> Timeline = std::vector<TickTimeline>(120);
+		size_t TimelineCount = 0;
+	};
+
+	SchedulerState &State()
+	{
+		static SchedulerState state;
+		return state;
+	}
+
+	uint32_t MicrosecondsBetween(const Clock::time_point from, const Clock::time_point to)
+	{
+		return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+	}
+
+	bool Conflicts(const System &a, const System &b)
+	{
+		return (a.Writes & (b.Reads | b.Writes)) != 0 || (b.Writes & a.Reads) != 0;
+	}
+
+	double CostOf(const System &system)
+	{
+		return system.Runs ? system.Average + 1.0 : 1.0;
+	}
+
+	// Picks the offset whose ticks carry the least cost of the systems placed so far
+	uint32_t ChooseOffset(const SchedulerState &state, const uint32_t interval)
+	{
+		uint64_t horizon = interval;
+		for (size_t i = 0; i < state.Systems.size(); i++)
+		{
+			const System &other = *state.Systems[i];
+			if (other.Balanced && other.Interval > 1 && horizon < (uint64_t)interval * other.Interval)
+				horizon = (uint64_t)interval * other.Interval;
+		}
+		if (horizon > BalanceHorizon)
+			horizon = BalanceHorizon - BalanceHorizon % interval;
+
+		uint32_t best = 0;
+		double bestLoad = 0.0;
+		for (uint32_t offset = 0; offset < interval; offset++)
+		{
+			double load = 0.0;
+			for (size_t i = 0; i < state.Systems.size(); i++)
+			{
+				const System &other = *state.Systems[i];
+				if (!other.Balanced || other.Removed || other.Interval <= 1)
+					continue;
+
+				for (uint64_t tick = offset; tick < horizon; tick += interval)
+				{
+					if (tick % other.Interval == other.Offset)
+						load += CostOf(other);
+				}
+			}
+
+			if (offset == 0 || load < bestLoad)
+			{
+				best = offset;
+				bestLoad = load;
+			}
+		}
+		return best;
+	}
+
+	void Build(SchedulerState &state)
+	{
+		state.Systems.erase(std::remove_if(state.Systems.begin(), state.Systems.end(), [](const std::unique_ptr<System> &system) { return system->Removed; }), state.Systems.end());
+
+		// A system goes one wave after the last earlier system of its phase it conflicts with
+		for (size_t phase = 0; phase < (size_t)SystemPhase::Count; phase++)
+		{
+			std::vector<Wave> &waves = state.Phases[phase];
+			waves.clear();
+			for (size_t i = 0; i < state.Systems.size(); i++)
+			{
+				System &system = *state.Systems[i];
+				if ((size_t)system.Phase != phase)
+					continue;
+
+				system.Wave = 0;
+				for (size_t j = 0; j < i; j++)
+				{
+					const System &earlier = *state.Systems[j];
+					if (earlier.Phase == system.Phase && earlier.Wave >= system.Wave && Conflicts(earlier, system))
+						system.Wave = earlier.Wave + 1;
+				}
+
+				if (waves.size() <= system.Wave)
+					waves.resize(system.Wave + 1);
+				if (system.TickThread)
+					waves[system.Wave].TickThread.push_back(&system);
+				else
+					waves[system.Wave].Parallel.push_back(&system);
+			}
+		}
+		state.Dirty = false;
+	}
+
+	void RunSystem(System &system, const Clock::time_point tickStart, const size_t slot)
+	{
+		const Clock::time_point start = Clock::now();
+		system.Run(system.Context);
+		const Clock::time_point end = Clock::now();
+
+		system.Slot = (uint32_t)slot;
+		system.Start = MicrosecondsBetween(tickStart, start);
+		system.Duration = MicrosecondsBetween(start, end);
+		system.Average = system.Runs ? system.Average + (system.Duration - system.Average) * AverageWeight : system.Duration;
+		if (system.Duration > system.Max)
+			system.Max = system.Duration;
+		system.Runs++;
+	}
+
+	struct WaveRun
+	{
+		System *const *Systems;
+		Clock::time_point TickStart;
+	};
+
+	void RunWave(void *context, const size_t begin, const size_t end, const size_t slot)
+	{
+		const WaveRun &run = *(const WaveRun *)context;
+		for (size_t i = begin; i < end; i++)
+			RunSystem(*run.Systems[i], run.TickStart, slot);
+	}
+
+	bool IsDue(const System &system, const uint64_t tick)
+	{
+		return !system.Removed && tick % system.Interval == system.Offset;
+	}
+
+	void WriteEscaped(std::ofstream &out, const char *text)
+	{
+		for (const char *c = text; c && *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				out << '\\';
+			if ((unsigned char)*c >= 0x20)
+				out << *c;
+		}
+	}
+}
+
+uint64_t SystemScheduler::Resource(const char *name)
+{
+	SchedulerState &state = State();
+	for (size_t i = 0; i < state.Resources.size(); i++)
+	{
+		if (state.Resources[i] == name)
+			return (uint64_t)1 << i;
+	}
+
+	if (state.Resources.size() == 64)
+		return ~(uint64_t)0;
+	state.Resources.push_back(name);
+	return (uint64_t)1 << (state.Resources.size() - 1);
+}
+
+int SystemScheduler::Register(const char *name, SystemFunction run, void *context, const SystemPhase phase, const uint64_t reads, const uint64_t writes, const uint32_t interval, const bool tickThread)
+{
+	SchedulerState &state = State();
+	if (!run || phase >= SystemPhase::Count)
+		return -1;
+
+	std::unique_ptr<System> system(new System());
+	system->Id = state.NextId++;
+	system->Name = name ? name : "";
+	system->Run = run;
+	system->Context = context;
+	system->Phase = phase;
+	system->Reads = reads;
+	system->Writes = writes;
+	system->Interval = interval ? interval : 1;
+	system->TickThread = tickThread;
+	system->Offset = system->Interval > 1 ? ChooseOffset(state, system->Interval) : 0;
+	system->Balanced = true;
+
+	// The plan only holds pointers, so adding from inside a tick thread system is safe and takes effect next tick.
+	// Systems on the Parallel threads must not call this, nothing guards the system list.
+	state.Systems.push_back(std::move(system));
+	state.Dirty = true;
+	return state.Systems.back()->Id;
+}
+
+bool SystemScheduler::Unregister(const int system)
+{
+	SchedulerState &state = State();
+	for (size_t i = 0; i < state.Systems.size(); i++)
+	{
+		if (state.Systems[i]->Id == system && !state.Systems[i]->Removed)
+		{
+			state.Systems[i]->Removed = true;
+			state.Dirty = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t SystemScheduler::Tick()
+{
+	SchedulerState &state = State();
+	if (state.Dirty)
+		Build(state);
+
+	const Clock::time_point tickStart = Clock::now();
+	const uint64_t tick = state.TickCount++;
+	state.Ran.clear();
+
+	for (size_t phase = 0; phase < (size_t)SystemPhase::Count; phase++)
+	{
+		std::vector<Wave> &waves = state.Phases[phase];
+		for (size_t w = 0; w < waves.size(); w++)
+		{
+			state.Due.clear();
+			for (size_t i = 0; i < waves[w].Parallel.size(); i++)
+			{
+				if (IsDue(*waves[w].Parallel[i], tick))
+					state.Due.push_back(waves[w].Parallel[i]);
+			}
+
+			if (!state.Due.empty())
+			{
+				WaveRun run = { state.Due.data(), tickStart };
+				Parallel::Run(state.Due.size(), RunWave, &run, 1);
+				state.Ran.insert(state.Ran.end(), state.Due.begin(), state.Due.end());
+			}
+
+			for (size_t i = 0; i < waves[w].TickThread.size(); i++)
+			{
+				System *system = waves[w].TickThread[i];
+				if (!IsDue(*system, tick))
+					continue;
+				RunSystem(*system, tickStart, 0);
+				state.Ran.push_back(system);
+			}
+		}
+	}
+
+	if (!state.Timeline.empty())
+	{
+		TickTimeline &timeline = state.Timeline[tick % state.Timeline.size()];
+		timeline.Tick = tick;
+		timeline.StartMicroseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(tickStart - state.Epoch).count();
+		timeline.Systems.clear();
+		for (size_t i = 0; i < state.Ran.size(); i++)
+		{
+			const System &system = *state.Ran[i];
+			timeline.Systems.push_back({ tick, system.Id, system.Wave, system.Slot, system.Start, system.Duration });
+		}
+		if (state.TimelineCount < state.Timeline.size())
+			state.TimelineCount++;
+	}
+
+	return state.Ran.size();
+}
+
+void SystemScheduler::Rebalance()
+{
+	SchedulerState &state = State();
+	std::vector<System *> balancing;
+	for (size_t i = 0; i < state.Systems.size(); i++)
+	{
+		if (state.Systems[i]->Interval > 1 && !state.Systems[i]->Removed)
+		{
+			state.Systems[i]->Balanced = false;
+			balancing.push_back(state.Systems[i].get());
+		}
+	}
+
+	// Most expensive first, so the cheap ones fill the gaps
+	std::stable_sort(balancing.begin(), balancing.end(), [](const System *a, const System *b) { return CostOf(*a) > CostOf(*b); });
+	for (size_t i = 0; i < balancing.size(); i++)
+	{
+		balancing[i]->Offset = ChooseOffset(state, balancing[i]->Interval);
+		balancing[i]->Balanced = true;
+	}
+}
+
+bool SystemScheduler::GetStats(const int system, SystemStats &stats)
+{
+	SchedulerState &state = State();
+	for (size_t i = 0; i < state.Systems.size(); i++)
+	{
+		const System &current = *state.Systems[i];
+		if (current.Id != system || current.Removed)
+			continue;
+
+		stats.Name = current.Name;
+		stats.Runs = current.Runs;
+		stats.AverageMicroseconds = current.Average;
+		stats.MaxMicroseconds = current.Max;
+		stats.Offset = current.Offset;
+		stats.Wave = current.Wave;
+		return true;
+	}
+	return false;
+}
+
+void SystemScheduler::SetTimelineTicks(const size_t ticks)
+{
+	SchedulerState &state = State();
+	state.Timeline.clear();
+	state.Timeline.resize(ticks);
+	state.TimelineCount = 0;
+}
+
+void SystemScheduler::GetTimeline(std::vector<SystemTiming> &timeline)
+{
+	SchedulerState &state = State();
+	timeline.clear();
+	for (size_t i = state.TimelineCount; i > 0; i--)
+	{
+		const TickTimeline &tick = state.Timeline[(state.TickCount - i) % state.Timeline.size()];
+		timeline.insert(timeline.end(), tick.Systems.begin(), tick.Systems.end());
+	}
+}
+
+bool SystemScheduler::ExportTimeline(const std::string &path)
+{
+	SchedulerState &state = State();
+	std::ofstream out(path.c_str(), std::ios::trunc);
+	if (!out)
+		return false;
+
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (size_t i = state.TimelineCount; i > 0; i--)
+	{
+		const TickTimeline &tick = state.Timeline[(state.TickCount - i) % state.Timeline.size()];
+		for (size_t j = 0; j < tick.Systems.size(); j++)
+		{
+			const SystemTiming &timing = tick.Systems[j];
+			const char *name = "";
+			for (size_t k = 0; k < state.Systems.size(); k++)
+			{
+				if (state.Systems[k]->Id == timing.System)
+					name = state.Systems[k]->Name;
+			}
+
+			out << (first ? "" : ",") << "{\"name\":\"";
+			WriteEscaped(out, name);
+			out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << timing.Slot
+				<< ",\"ts\":" << tick.StartMicroseconds + timing.StartMicroseconds
+				<< ",\"dur\":" << timing.DurationMicroseconds
+				<< ",\"args\":{\"tick\":" << timing.Tick << ",\"wave\":" << timing.Wave << "}}";
+			first = false;
+		}
+	}
+	out << "]}";
+	return (bool)out;
+}
+
+void SystemScheduler::Clear()
+{
+	SchedulerState &state = State();
+	state.Systems.clear();
+	for (size_t phase = 0; phase < (size_t)SystemPhase::Count; phase++)
+		state.Phases[phase].clear();
+	state.Due.clear();
+	state.Ran.clear();
+	state.TimelineCount = 0;
+	state.Dirty = false;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+typedef void (*SystemFunction)(void *context);
+
+enum class SystemPhase : uint8_t
+{
+	PreUpdate,
+	Update,
+	PostUpdate,
+	Count
+};
+
+struct SystemStats
+{
+	const char *Name = nullptr;
+	uint64_t Runs = 0;
+	double AverageMicroseconds = 0.0;
+	uint64_t MaxMicroseconds = 0;
+	// The tick (modulo the interval) the system runs on
+	uint32_t Offset = 0;
+	uint32_t Wave = 0;
+};
+
+/// <summary>
+/// One system run in the timeline of a tick, times are relative to the start of SystemScheduler::Tick
+/// </summary>
+struct SystemTiming
+{
+	uint64_t Tick;
+	int System;
+	uint32_t Wave;
+	// Parallel slot that ran it, 0 is the tick thread
+	uint32_t Slot;
+	uint32_t StartMicroseconds;
+	uint32_t DurationMicroseconds;
+};
+
+/// <summary>
+/// Runs the plugin's per tick systems in phases.
+/// Systems declare the resources (component or state types) they read and write, and every phase is split into waves
+/// of systems that do not conflict with each other, in registration order. A wave runs on the Parallel threads,
+/// tick thread systems of the wave after it. Systems that run every N ticks are spread over the ticks by their cost.
+/// Off-thread systems must not call API:: functions, they can record them with CommandBuffer.
+/// </summary>
+class SystemScheduler
+{
+public:
+	/// <summary>
+	/// Gets the bit of a named resource for the read and write sets, the same name always gives the same bit.
+	/// Past 64 resources every bit is returned, which conflicts with everything.
+	/// </summary>
+	static uint64_t Resource(const char *name);
+
+	/// <summary>
+	/// Adds a system, from the tick thread only (tick thread systems included)
+	/// </summary>
+	/// <param name="name">The name shown in the stats and the timeline, has to outlive the system</param>
+	/// <param name="run">The function of the system</param>
+	/// <param name="context">Passed to run as is</param>
+	/// <param name="phase">The phase it runs in</param>
+	/// <param name="reads">The resources it reads</param>
+	/// <param name="writes">The resources it writes</param>
+	/// <param name="interval">Runs every interval ticks</param>
+	/// <param name="tickThread">Runs on the tick thread, for systems calling API:: functions</param>
+	/// <returns name="system">The id of the system, -1 if run is nullptr</returns>
+	static int Register(const char *name, SystemFunction run, void *context, const SystemPhase phase, const uint64_t reads, const uint64_t writes, const uint32_t interval = 1, const bool tickThread = false);
+
+	/// <summary>
+	/// Removes a system, it does not run again. From the tick thread only (tick thread systems included)
+	/// </summary>
+	static bool Unregister(const int system);
+
+	/// <summary>
+	/// Runs the systems due this tick, call once from API_OnTick
+	/// </summary>
+	/// <returns name="ran">The number of systems run</returns>
+	static size_t Tick();
+
+	/// <summary>
+	/// Spreads the low rate systems over the ticks again using their measured cost
+	/// </summary>
+	static void Rebalance();
+
+	static bool GetStats(const int system, SystemStats &stats);
+
+	/// <summary>
+	/// Sets the number of ticks kept in the timeline (120 by default, 0 turns it off)
+	/// </summary>
+	static void SetTimelineTicks(const size_t ticks);
+
+	/// <summary>
+	/// Gets the kept timeline, oldest tick first
+	/// </summary>
+	static void GetTimeline(std::vector<SystemTiming> &timeline);
+
+	/// <summary>
+	/// Writes the kept timeline in the Chrome trace event format (chrome://tracing, Perfetto)
+	/// </summary>
+	/// <returns name="written">False if the file could not be written</returns>
+	static bool ExportTimeline(const std::string &path);
+
+	static void Clear();
+};
@@ -0,0 +1,245 @@
+/**
+File:
+	Task.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <chrono>
+#include <deque>
+
+namespace
+{
+	// Size classes 64, 128, ... 4096
+	const size_t ClassCount = 7;
+
+	struct PoolState
+	{
+		std::vector<void *> Free[ClassCount];
+		size_t Pooled = 0;
+
+		~PoolState()
+		{
+			for (size_t cls = 0; cls < ClassCount; cls++)
+			{
+				for (size_t i = 0; i < Free[cls].size(); i++)
+					::operator delete(Free[cls][i]);
+			}
+		}
+	};
+
+	PoolState &Pool()
+	{
+		static PoolState state;
+		return state;
+	}
+
+	size_t ClassOf(const size_t size)
+	{
+		size_t cls = 0;
+		while ((FramePool::MinFrameSize << cls) < size)
+			cls++;
+		return cls;
+	}
+
+	struct SchedulerState
+	{
+		std::vector<Task::Handle> Live;
+		std::deque<Task::Handle> Ready;
+		std::vector<Task::Handle> NextTick;
+		std::vector<Task::Handle> Yielded;
+
+		uint32_t Budget = 2000;
+		bool InTick = false;
+		std::chrono::steady_clock::time_point TickStart;
+		TaskStats Stats;
+	};
+
+	SchedulerState &Scheduler()
+	{
+		static SchedulerState state;
+		return state;
+	}
+
+	uint64_t ElapsedMicroseconds(const SchedulerState &state)
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - state.TickStart).count();
+	}
+
+	void Wake(void *address)
+	{
+		Task::Handle coroutine = Task::Handle::from_address(address);
+		coroutine.promise().Timer = TimerHandle();
+		Scheduler().Ready.push_back(coroutine);
+	}
+
+	void Destroy(SchedulerState &state, Task::Handle coroutine)
+	{
+		// Swap the last live task into the slot
+		const size_t slot = coroutine.promise().Slot;
+		state.Live[slot] = state.Live.back();
+		state.Live[slot].promise().Slot = slot;
+		state.Live.pop_back();
+
+		TimerWheel::Cancel(coroutine.promise().Timer);
+		coroutine.destroy();
+	}
+}
+
+void *FramePool::Allocate(const size_t size)
+{
+	if (size > MaxFrameSize)
+		return ::operator new(size);
+
+	PoolState &state = Pool();
+	std::vector<void *> &free = state.Free[ClassOf(size)];
+	if (free.empty())
+		return ::operator new(MinFrameSize << ClassOf(size));
+
+	void *frame = free.back();
+	free.pop_back();
+	state.Pooled--;
+	return frame;
+}
+
+void FramePool::Free(void *frame, const size_t size)
+{
+	if (size > MaxFrameSize)
+	{
+		::operator delete(frame);
+		return;
+	}
+
+	PoolState &state = Pool();
+	state.Free[ClassOf(size)].push_back(frame);
+	state.Pooled++;
+}
+
+size_t FramePool::GetPooledCount()
+{
+	return Pool().Pooled;
+}
+
+void Task::promise_type::unhandled_exception()
+{
+	try
+	{
+		throw;
+	}
+	catch (const std::exception &exception)
+	{
+		std::wostringstream message;
+		message << L"Task failed: " << exception.what();
+		API::Server::PrintMessage(message.str());
+	}
+	catch (...)
+	{
+		API::Server::PrintMessage(L"Task failed with an unknown exception");
+	}
+}
+
+void TaskScheduler::NextTickAwaiter::await_suspend(std::coroutine_handle<Task::promise_type> coroutine) const
+{
+	Scheduler().NextTick.push_back(coroutine);
+}
+
+void TaskScheduler::TimerAwaiter::await_suspend(std::coroutine_handle<Task::promise_type> coroutine) const
+{
+	coroutine.promise().Timer = Milliseconds ? TimerWheel::AfterMilliseconds(Amount, Wake, coroutine.address()) : TimerWheel::After(Amount, Wake, coroutine.address());
+}
+
+void TaskScheduler::YieldAwaiter::await_suspend(std::coroutine_handle<Task::promise_type> coroutine) const
+{
+	Scheduler().Yielded.push_back(coroutine);
+}
+
+void TaskScheduler::Run(Task &&task)
+{
+	SchedulerState &state = Scheduler();
+	Task::Handle coroutine = task.Release();
+	if (!coroutine)
+		return;
+
+	coroutine.promise().Slot = state.Live.size();
+	state.Live.push_back(coroutine);
+	state.Ready.push_back(coroutine);
+}
+
+size_t TaskScheduler::Tick()
+{
+	SchedulerState &state = Scheduler();
+	state.TickStart = std::chrono::steady_clock::now();
+	state.InTick = true;
+
+	// Tasks that yielded last tick go first, then the backlog, then the tasks waiting for this tick
+	for (size_t i = state.Yielded.size(); i > 0; i--)
+		state.Ready.push_front(state.Yielded[i - 1]);
+	state.Yielded.clear();
+	state.Ready.insert(state.Ready.end(), state.NextTick.begin(), state.NextTick.end());
+	state.NextTick.clear();
+
+	size_t resumed = 0;
+	uint64_t elapsed = 0;
+	while (!state.Ready.empty() && elapsed < state.Budget)
+	{
+		Task::Handle coroutine = state.Ready.front();
+		state.Ready.pop_front();
+
+		coroutine.resume();
+		resumed++;
+		if (coroutine.done())
+		{
+			Destroy(state, coroutine);
+			state.Stats.Completed++;
+		}
+		elapsed = ElapsedMicroseconds(state);
+	}
+
+	if (elapsed > state.Budget)
+	{
+		state.Stats.Overruns++;
+		if (elapsed - state.Budget > state.Stats.MaxOverrunMicroseconds)
+			state.Stats.MaxOverrunMicroseconds = elapsed - state.Budget;
+	}
+
+	state.InTick = false;
+	state.Stats.Resumes += resumed;
+	state.Stats.LastTickMicroseconds = elapsed;
+	return resumed;
+}
+
+void TaskScheduler::SetBudget(const uint32_t microseconds)
+{
+	Scheduler().Budget = microseconds;
+}
+
+uint32_t TaskScheduler::GetBudget()
+{
+	return Scheduler().Budget;
+}
+
+bool TaskScheduler::IsBudgetSpent()
+{
+	const SchedulerState &state = Scheduler();
+	return state.InTick && ElapsedMicroseconds(state) >= state.Budget;
+}
+
+void TaskScheduler::Clear()
+{
+	SchedulerState &state = Scheduler();
+	while (!state.Live.empty())
+		Destroy(state, state.Live.back());
+
+	state.Ready.clear();
+	state.NextTick.clear();
+	state.Yielded.clear();
+}
+
+TaskStats TaskScheduler::GetStats()
+{
+	SchedulerState &state = Scheduler();
+	TaskStats stats = state.Stats;
+	stats.Live = state.Live.size();
+	stats.Backlog = state.Ready.size() + state.Yielded.size();
+	return stats;
+}
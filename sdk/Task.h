@@ -0,0 +1,178 @@
+#pragma once
+
+/// <summary>
+/// Size class pool for coroutine frames. Freed frames are kept for the next task, so starting tasks
+/// does not allocate in steady state. Frames larger than MaxFrameSize go to the global allocator.
+/// Tick thread only.
+/// </summary>
+class FramePool
+{
+public:
+	static const size_t MinFrameSize = 64;
+	static const size_t MaxFrameSize = 4096;
+
+	static void *Allocate(const size_t size);
+	static void Free(void *frame, const size_t size);
+
+	/// <summary>
+	/// Gets the number of frames kept for reuse
+	/// </summary>
+	static size_t GetPooledCount();
+};
+
+/// <summary>
+/// A coroutine run by the TaskScheduler. It starts suspended and runs once passed to TaskScheduler::Run.
+/// Exceptions leaving the coroutine are printed and end the task.
+/// </summary>
+class Task
+{
+public:
+	struct promise_type
+	{
+		// Position in the scheduler's list of live tasks
+		size_t Slot = 0;
+		// Pending delay, cancelled when the task is destroyed while waiting
+		TimerHandle Timer;
+
+		Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() { }
+		void unhandled_exception();
+
+		static void *operator new(const size_t size) { return FramePool::Allocate(size); }
+		static void operator delete(void *frame, const size_t size) { FramePool::Free(frame, size); }
+	};
+
+	typedef std::coroutine_handle<promise_type> Handle;
+
+private:
+	Handle Coroutine;
+
+public:
+	Task() { }
+	explicit Task(Handle coroutine) : Coroutine(coroutine) { }
+	Task(Task &&other) : Coroutine(other.Coroutine) { other.Coroutine = nullptr; }
+	Task &operator=(Task &&other)
+	{
+		if (this != &other)
+		{
+			if (Coroutine)
+				Coroutine.destroy();
+			Coroutine = other.Coroutine;
+			other.Coroutine = nullptr;
+		}
+		return *this;
+	}
+	Task(const Task &) = delete;
+	Task &operator=(const Task &) = delete;
+
+	// A task that was never run is destroyed with its handle
+	~Task()
+	{
+		if (Coroutine)
+			Coroutine.destroy();
+	}
+
+	Handle Release()
+	{
+		Handle coroutine = Coroutine;
+		Coroutine = nullptr;
+		return coroutine;
+	}
+};
+
+struct TaskStats
+{
+	// Tasks started and not finished yet
+	size_t Live = 0;
+	// Tasks ready to run that did not fit in the last tick's budget
+	size_t Backlog = 0;
+	uint64_t Completed = 0;
+	uint64_t Resumes = 0;
+	// Ticks in which a single resume pushed the scheduler past its budget, and the worst overshoot
+	uint64_t Overruns = 0;
+	uint64_t MaxOverrunMicroseconds = 0;
+	uint64_t LastTickMicroseconds = 0;
+};
+
+/// <summary>
+/// Cooperative scheduler for Tasks, resumed from API_OnTick until the per tick time budget is spent.
+/// Tasks give the tick thread back with co_await on NextTick, WaitTicks, Delay or Yield. Tick thread only.
+/// </summary>
+class TaskScheduler
+{
+public:
+	struct NextTickAwaiter
+	{
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<Task::promise_type> coroutine) const;
+		void await_resume() const noexcept { }
+	};
+
+	struct TimerAwaiter
+	{
+		uint32_t Amount;
+		bool Milliseconds;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<Task::promise_type> coroutine) const;
+		void await_resume() const noexcept { }
+	};
+
+	struct YieldAwaiter
+	{
+		bool await_ready() const noexcept { return !IsBudgetSpent(); }
+		void await_suspend(std::coroutine_handle<Task::promise_type> coroutine) const;
+		void await_resume() const noexcept { }
+	};
+
+	/// <summary>
+	/// Starts a task, it first runs during the current or next Tick
+	/// </summary>
+	static void Run(Task &&task);
+
+	/// <summary>
+	/// Resumes ready tasks until the budget is spent, call once per tick
+	/// </summary>
+	/// <returns name="resumed">The number of tasks resumed</returns>
+	static size_t Tick();
+
+	/// <summary>
+	/// Sets the time tasks may use per tick (2000 microseconds by default)
+	/// </summary>
+	static void SetBudget(const uint32_t microseconds);
+	static uint32_t GetBudget();
+
+	/// <summary>
+	/// Checks if the current tick's budget is spent, for tasks that want to check before doing more work
+	/// </summary>
+	static bool IsBudgetSpent();
+
+	/// <summary>
+	/// Destroys every live task, call from API_Close
+	/// </summary>
+	static void Clear();
+
+	static TaskStats GetStats();
+
+	/// <summary>
+	/// Suspends until the next tick
+	/// </summary>
+	static NextTickAwaiter NextTick() { return NextTickAwaiter(); }
+
+	/// <summary>
+	/// Suspends for a number of ticks
+	/// </summary>
+	static TimerAwaiter WaitTicks(const uint32_t ticks) { return TimerAwaiter{ ticks, false }; }
+
+	/// <summary>
+	/// Suspends for a number of milliseconds
+	/// </summary>
+	static TimerAwaiter Delay(const uint32_t milliseconds) { return TimerAwaiter{ milliseconds, true }; }
+
+	/// <summary>
+	/// Suspends only if this tick's budget is spent, the task then continues first thing next tick
+	/// </summary>
+	static YieldAwaiter Yield() { return YieldAwaiter(); }
+};
@@ -0,0 +1,181 @@
+/**
+File:
+	TickClock.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <bit>
+#include <chrono>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Log-linear histogram: exact below 64 us, then 16 buckets per power of two up to 2^38 us
+	const uint32_t LinearBuckets = 64;
+	const uint32_t SubBucketBits = 4;
+	const uint32_t MaxExponent = 38;
+	const uint32_t BucketCount = LinearBuckets + (MaxExponent - 6) * (1 << SubBucketBits);
+
+	const double RateWeight = 0.05;
+
+	struct ClockState
+	{
+		bool Started = false;
+		Clock::time_point First;
+		Clock::time_point Last;
+		uint64_t TickCount = 0;
+		uint64_t Timestamp = 0;
+		uint64_t Delta = 0;
+		double Rate = 0.0;
+
+		uint32_t Histogram[BucketCount] = {};
+		uint64_t Intervals = 0;
+		uint64_t Max = 0;
+		uint64_t Stalls = 0;
+
+		TickStallCallback StallCallback = nullptr;
+		void *StallContext = nullptr;
+		uint64_t StallThreshold = 0;
+	};
+
+	ClockState &State()
+	{
+		static ClockState state;
+		return state;
+	}
+
+	uint32_t BucketOf(const uint64_t microseconds)
+	{
+		if (microseconds < LinearBuckets)
+			return (uint32_t)microseconds;
+
+		const uint32_t exponent = 63 - (uint32_t)std::countl_zero(microseconds);
+		if (exponent >= MaxExponent)
+			return BucketCount - 1;
+
+		const uint32_t sub = (uint32_t)(microseconds >> (exponent - SubBucketBits)) & ((1 << SubBucketBits) - 1);
+		return LinearBuckets + ((exponent - 6) << SubBucketBits) + sub;
+	}
+
+	uint64_t UpperBoundOf(const uint32_t bucket)
+	{
+		if (bucket < LinearBuckets)
+			return bucket;
+
+		const uint32_t exponent = ((bucket - LinearBuckets) >> SubBucketBits) + 6;
+		const uint64_t sub = (bucket - LinearBuckets) & ((1 << SubBucketBits) - 1);
+		return ((((uint64_t)1 << SubBucketBits) + sub + 1) << (exponent - SubBucketBits)) - 1;
+	}
+
+	uint64_t Percentile(const ClockState &state, const uint64_t rank)
+	{
+		uint64_t seen = 0;
+		for (uint32_t bucket = 0; bucket < BucketCount; bucket++)
+		{
+			seen += state.Histogram[bucket];
+			if (seen > rank)
+			{
+				const uint64_t bound = UpperBoundOf(bucket);
+				return bound < state.Max ? bound : state.Max;
+			}
+		}
+		return state.Max;
+	}
+}
+
+void TickClock::Tick()
+{
+	ClockState &state = State();
+	const Clock::time_point now = Clock::now();
+	if (!state.Started)
+	{
+		state.Started = true;
+		state.First = now;
+		state.Last = now;
+		return;
+	}
+
+	const uint64_t delta = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - state.Last).count();
+	state.Last = now;
+	state.TickCount++;
+	state.Delta = delta;
+	state.Timestamp += delta;
+
+	state.Histogram[BucketOf(delta)]++;
+	state.Intervals++;
+	if (delta > state.Max)
+		state.Max = delta;
+
+	if (delta)
+	{
+		const double rate = 1000000.0 / (double)delta;
+		state.Rate = state.Rate != 0.0 ? state.Rate + (rate - state.Rate) * RateWeight : rate;
+	}
+
+	if (state.StallThreshold && delta > state.StallThreshold)
+	{
+		state.Stalls++;
+		if (state.StallCallback)
+			state.StallCallback(state.StallContext, delta);
+	}
+}
+
+uint64_t TickClock::GetTick()
+{
+	return State().TickCount;
+}
+
+double TickClock::GetDelta()
+{
+	return (double)State().Delta / 1000000.0;
+}
+
+uint64_t TickClock::GetDeltaMicroseconds()
+{
+	return State().Delta;
+}
+
+uint64_t TickClock::GetTimestamp()
+{
+	return State().Timestamp;
+}
+
+double TickClock::GetRate()
+{
+	return State().Rate;
+}
+
+TickIntervalStats TickClock::GetStats()
+{
+	const ClockState &state = State();
+	TickIntervalStats stats;
+	stats.Count = state.Intervals;
+	stats.MaxMicroseconds = state.Max;
+	stats.Stalls = state.Stalls;
+	if (state.Intervals)
+	{
+		stats.P50Microseconds = Percentile(state, state.Intervals / 2);
+		stats.P99Microseconds = Percentile(state, state.Intervals * 99 / 100);
+	}
+	return stats;
+}
+
+void TickClock::ResetStats()
+{
+	ClockState &state = State();
+	for (uint32_t bucket = 0; bucket < BucketCount; bucket++)
+		state.Histogram[bucket] = 0;
+	state.Intervals = 0;
+	state.Max = 0;
+	state.Stalls = 0;
+}
+
+void TickClock::SetStallHandler(TickStallCallback callback, void *context, const uint64_t thresholdMicroseconds)
+{
+	ClockState &state = State();
+	state.StallCallback = callback;
+	state.StallContext = context;
+	state.StallThreshold = thresholdMicroseconds;
+}
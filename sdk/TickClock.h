@@ -0,0 +1,59 @@
+#pragma once
+
+typedef void (*TickStallCallback)(void *context, const uint64_t intervalMicroseconds);
+
+struct TickIntervalStats
+{
+	uint64_t Count = 0;
+	// Percentiles are the upper bound of their histogram bucket, within 1/16 of the value
+	uint64_t P50Microseconds = 0;
+	uint64_t P99Microseconds = 0;
+	uint64_t MaxMicroseconds = 0;
+	uint64_t Stalls = 0;
+};
+
+/// <summary>
+/// Monotonic clock of the server ticks, API_OnTick calls Tick first so everything after it sees this tick's times.
+/// Keeps the delta time, the tick number, a smoothed tick rate and a histogram of the tick intervals, and calls a
+/// handler when the time between two ticks passes the stall threshold. Tick thread only.
+/// </summary>
+class TickClock
+{
+public:
+	/// <summary>
+	/// Starts a new tick, call once at the start of API_OnTick
+	/// </summary>
+	static void Tick();
+
+	/// <summary>
+	/// Gets the number of the current tick, the first one is 0
+	/// </summary>
+	static uint64_t GetTick();
+
+	/// <summary>
+	/// Gets the time since the previous tick in seconds, 0 on the first tick
+	/// </summary>
+	static double GetDelta();
+	static uint64_t GetDeltaMicroseconds();
+
+	/// <summary>
+	/// Gets the start of the current tick in microseconds since the first one
+	/// </summary>
+	static uint64_t GetTimestamp();
+
+	/// <summary>
+	/// Gets the exponentially smoothed number of ticks per second
+	/// </summary>
+	static double GetRate();
+
+	static TickIntervalStats GetStats();
+	static void ResetStats();
+
+	/// <summary>
+	/// Sets the handler called from Tick when a tick comes later than the threshold after the previous one
+	/// </summary>
+	/// <param name="callback">The handler, nullptr to remove it</param>
+	/// <param name="context">Passed to the handler as is</param>
+	/// <param name="thresholdMicroseconds">The longest interval that is not a stall</param>
+	static void SetStallHandler(TickStallCallback callback, void *context, const uint64_t thresholdMicroseconds);
+};
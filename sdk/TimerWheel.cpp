@@ -0,0 +1,350 @@
+/**
+File:
+	TimerWheel.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <chrono>
+
+namespace
+{
+	// Level 0 has 256 slots of one unit, levels 1-3 have 64 slots each covering 64 times the level below
+	const uint32_t Level0Bits = 8;
+	const uint32_t LevelBits = 6;
+	const uint32_t Level0Size = 1 << Level0Bits;
+	const uint32_t LevelSize = 1 << LevelBits;
+	const uint32_t SlotCount = Level0Size + 3 * LevelSize;
+	const uint64_t Range = 1ULL << (Level0Bits + 3 * LevelBits);
+
+	const int32_t None = -1;
+
+	enum class NodeState : uint8_t
+	{
+		Free,
+		Pending,
+		Running,
+		Cancelled
+	};
+
+	struct TimerNode
+	{
+		uint64_t Expires;
+		uint32_t Period;
+		uint32_t Generation;
+		TimerCallback Callback;
+		void *Context;
+		int32_t Prev;
+		int32_t Next;
+		int32_t Slot;
+		uint8_t Wheel;
+		NodeState State;
+	};
+
+	struct Wheel
+	{
+		uint64_t Now = 0;
+		size_t Count = 0;
+		int32_t Heads[SlotCount];
+
+		Wheel() { std::fill(Heads, Heads + SlotCount, None); }
+	};
+
+	struct TimerState
+	{
+		std::vector<TimerNode> Nodes;
+		int32_t FreeList = None;
+
+		// 0 counts ticks, 1 counts milliseconds since Start
+		Wheel Wheels[2];
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+		// Expired timers of the slot being run, reused every tick
+		std::vector<int32_t> Running;
+	};
+
+	TimerState &State()
+	{
+		static TimerState state;
+		return state;
+	}
+
+	uint64_t Milliseconds(const TimerState &state)
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - state.Start).count();
+	}
+
+	uint32_t SlotFor(const uint64_t now, uint64_t expires)
+	{
+		uint64_t delta = expires - now;
+		if (delta >= Range)
+		{
+			// Parked in the farthest top level slot and cascaded down again when it comes around
+			expires = now + Range - 1;
+			delta = Range - 1;
+		}
+
+		if (delta < Level0Size)
+			return (uint32_t)(expires & (Level0Size - 1));
+		if (delta < (1ULL << (Level0Bits + LevelBits)))
+			return Level0Size + (uint32_t)((expires >> Level0Bits) & (LevelSize - 1));
+		if (delta < (1ULL << (Level0Bits + 2 * LevelBits)))
+			return Level0Size + LevelSize + (uint32_t)((expires >> (Level0Bits + LevelBits)) & (LevelSize - 1));
+		return Level0Size + 2 * LevelSize + (uint32_t)((expires >> (Level0Bits + 2 * LevelBits)) & (LevelSize - 1));
+	}
+
+	void Link(TimerState &state, const int32_t index)
+	{
+		TimerNode &node = state.Nodes[index];
+		Wheel &wheel = state.Wheels[node.Wheel];
+		const uint32_t slot = SlotFor(wheel.Now, node.Expires);
+
+		node.Slot = (int32_t)slot;
+		node.Prev = None;
+		node.Next = wheel.Heads[slot];
+		if (node.Next != None)
+			state.Nodes[node.Next].Prev = index;
+		wheel.Heads[slot] = index;
+	}
+
+	void Unlink(TimerState &state, const int32_t index)
+	{
+		TimerNode &node = state.Nodes[index];
+		Wheel &wheel = state.Wheels[node.Wheel];
+
+		if (node.Prev != None)
+			state.Nodes[node.Prev].Next = node.Next;
+		else
+			wheel.Heads[node.Slot] = node.Next;
+		if (node.Next != None)
+			state.Nodes[node.Next].Prev = node.Prev;
+		node.Slot = None;
+	}
+
+	void Free(TimerState &state, const int32_t index)
+	{
+		TimerNode &node = state.Nodes[index];
+		state.Wheels[node.Wheel].Count--;
+
+		node.State = NodeState::Free;
+		node.Generation = node.Generation + 1 ? node.Generation + 1 : 1;
+		node.Next = state.FreeList;
+		state.FreeList = index;
+	}
+
+	TimerHandle Schedule(const uint8_t wheelIndex, const uint64_t now, const uint32_t delay, const uint32_t period, TimerCallback callback, void *context)
+	{
+		TimerState &state = State();
+		if (!callback)
+			return TimerHandle();
+
+		int32_t index = state.FreeList;
+		if (index != None)
+			state.FreeList = state.Nodes[index].Next;
+		else
+		{
+			index = (int32_t)state.Nodes.size();
+			state.Nodes.push_back(TimerNode());
+			state.Nodes[index].Generation = 1;
+		}
+
+		TimerNode &node = state.Nodes[index];
+		node.Expires = now + (delay ? delay : 1);
+		node.Period = period;
+		node.Callback = callback;
+		node.Context = context;
+		node.Wheel = wheelIndex;
+		node.State = NodeState::Pending;
+		state.Wheels[wheelIndex].Count++;
+		Link(state, index);
+
+		TimerHandle handle;
+		handle.Index = (uint32_t)index;
+		handle.Generation = node.Generation;
+		return handle;
+	}
+
+	// Moves every timer of a higher level slot down to where it belongs now
+	void Cascade(TimerState &state, Wheel &wheel, const uint32_t slot)
+	{
+		int32_t index = wheel.Heads[slot];
+		wheel.Heads[slot] = None;
+		while (index != None)
+		{
+			const int32_t next = state.Nodes[index].Next;
+			Link(state, index);
+			index = next;
+		}
+	}
+
+	size_t Advance(TimerState &state, const uint8_t wheelIndex)
+	{
+		Wheel &wheel = state.Wheels[wheelIndex];
+		const uint64_t now = ++wheel.Now;
+
+		if ((now & (Level0Size - 1)) == 0)
+		{
+			const uint32_t first = (uint32_t)((now >> Level0Bits) & (LevelSize - 1));
+			Cascade(state, wheel, Level0Size + first);
+			if (first == 0)
+			{
+				const uint32_t second = (uint32_t)((now >> (Level0Bits + LevelBits)) & (LevelSize - 1));
+				Cascade(state, wheel, Level0Size + LevelSize + second);
+				if (second == 0)
+					Cascade(state, wheel, Level0Size + 2 * LevelSize + (uint32_t)((now >> (Level0Bits + 2 * LevelBits)) & (LevelSize - 1)));
+			}
+		}
+
+		const uint32_t slot = (uint32_t)(now & (Level0Size - 1));
+		if (wheel.Heads[slot] == None)
+			return 0;
+
+		// Detached first, callbacks may schedule into the same slot or cancel timers that expire with them
+		state.Running.clear();
+		for (int32_t index = wheel.Heads[slot]; index != None; index = state.Nodes[index].Next)
+		{
+			state.Nodes[index].State = NodeState::Running;
+			state.Nodes[index].Slot = None;
+			state.Running.push_back(index);
+		}
+		wheel.Heads[slot] = None;
+
+		size_t fired = 0;
+		for (size_t i = 0; i < state.Running.size(); i++)
+		{
+			const int32_t index = state.Running[i];
+			if (state.Nodes[index].State == NodeState::Running)
+			{
+				state.Nodes[index].Callback(state.Nodes[index].Context);
+				fired++;
+			}
+
+			// The pool may have grown during the callback
+			TimerNode &node = state.Nodes[index];
+			if (node.State == NodeState::Running && node.Period)
+			{
+				node.Expires = node.Expires + node.Period > now ? node.Expires + node.Period : now + node.Period;
+				node.State = NodeState::Pending;
+				Link(state, index);
+			}
+			else
+				Free(state, index);
+		}
+		return fired;
+	}
+}
+
+TimerHandle TimerWheel::After(const uint32_t ticks, TimerCallback callback, void *context)
+{
+	return Schedule(0, State().Wheels[0].Now, ticks, 0, callback, context);
+}
+
+TimerHandle TimerWheel::Every(const uint32_t ticks, TimerCallback callback, void *context)
+{
+	const uint32_t period = ticks ? ticks : 1;
+	return Schedule(0, State().Wheels[0].Now, period, period, callback, context);
+}
+
+TimerHandle TimerWheel::AfterMilliseconds(const uint32_t milliseconds, TimerCallback callback, void *context)
+{
+	return Schedule(1, Milliseconds(State()), milliseconds, 0, callback, context);
+}
+
+TimerHandle TimerWheel::EveryMilliseconds(const uint32_t milliseconds, TimerCallback callback, void *context)
+{
+	const uint32_t period = milliseconds ? milliseconds : 1;
+	return Schedule(1, Milliseconds(State()), period, period, callback, context);
+}
+
+bool TimerWheel::Cancel(TimerHandle &handle)
+{
+	TimerState &state = State();
+	if (!IsActive(handle))
+	{
+		handle = TimerHandle();
+		return false;
+	}
+
+	TimerNode &node = state.Nodes[handle.Index];
+	if (node.State == NodeState::Running)
+		node.State = NodeState::Cancelled;
+	else
+	{
+		Unlink(state, (int32_t)handle.Index);
+		Free(state, (int32_t)handle.Index);
+	}
+
+	handle = TimerHandle();
+	return true;
+}
+
+bool TimerWheel::IsActive(const TimerHandle handle)
+{
+	const TimerState &state = State();
+	if (handle.Generation == 0 || handle.Index >= state.Nodes.size())
+		return false;
+
+	const TimerNode &node = state.Nodes[handle.Index];
+	return node.Generation == handle.Generation && (node.State == NodeState::Pending || node.State == NodeState::Running);
+}
+
+size_t TimerWheel::Tick()
+{
+	TimerState &state = State();
+	size_t fired = Advance(state, 0);
+
+	// Every millisecond since the last tick is stepped, an empty wheel just jumps ahead
+	Wheel &wheel = state.Wheels[1];
+	const uint64_t now = Milliseconds(state);
+	while (wheel.Now < now)
+	{
+		if (wheel.Count == 0)
+		{
+			wheel.Now = now;
+			break;
+		}
+		fired += Advance(state, 1);
+	}
+	return fired;
+}
+
+void TimerWheel::Reserve(const size_t timers)
+{
+	TimerState &state = State();
+	while (state.Nodes.size() < timers)
+	{
+		TimerNode node = TimerNode();
+		node.Generation = 1;
+		node.State = NodeState::Free;
+		node.Next = state.FreeList;
+		state.FreeList = (int32_t)state.Nodes.size();
+		state.Nodes.push_back(node);
+	}
+	state.Running.reserve(timers);
+}
+
+void TimerWheel::Clear()
+{
+	TimerState &state = State();
+	for (size_t i = 0; i < state.Nodes.size(); i++)
+	{
+		if (state.Nodes[i].State == NodeState::Pending)
+		{
+			Unlink(state, (int32_t)i);
+			Free(state, (int32_t)i);
+		}
+		else if (state.Nodes[i].State == NodeState::Running)
+			state.Nodes[i].State = NodeState::Cancelled;
+	}
+}
+
+uint64_t TimerWheel::GetTick()
+{
+	return State().Wheels[0].Now;
+}
+
+size_t TimerWheel::GetCount()
+{
+	const TimerState &state = State();
+	return state.Wheels[0].Count + state.Wheels[1].Count;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+struct TimerHandle
+{
+	uint32_t Index = 0;
+	// 0 is never a live generation, so a default handle is always inactive
+	uint32_t Generation = 0;
+};
+
+typedef void (*TimerCallback)(void *context);
+
+/// <summary>
+/// Hierarchical timer wheels for delayed and repeating actions, driven by API_OnTick.
+/// One wheel counts server ticks, the other wall clock milliseconds. Scheduling and cancelling are O(1),
+/// expiry is amortized O(1) per timer. Timers live in a node pool that only grows, so scheduling does not
+/// allocate once the pool is large enough (see Reserve). Tick thread only.
+/// </summary>
+class TimerWheel
+{
+public:
+	/// <summary>
+	/// Runs a callback once after a number of ticks (at least 1)
+	/// </summary>
+	/// <param name="ticks">The delay in ticks</param>
+	/// <param name="callback">The callback</param>
+	/// <param name="context">Passed to the callback as is</param>
+	static TimerHandle After(const uint32_t ticks, TimerCallback callback, void *context = nullptr);
+
+	/// <summary>
+	/// Runs a callback every number of ticks (at least 1), the first time after one period
+	/// </summary>
+	static TimerHandle Every(const uint32_t ticks, TimerCallback callback, void *context = nullptr);
+
+	/// <summary>
+	/// Runs a callback once after a number of milliseconds, on the first tick at or after that time
+	/// </summary>
+	static TimerHandle AfterMilliseconds(const uint32_t milliseconds, TimerCallback callback, void *context = nullptr);
+
+	/// <summary>
+	/// Runs a callback every number of milliseconds. A period that passed more than once between two ticks runs once.
+	/// </summary>
+	static TimerHandle EveryMilliseconds(const uint32_t milliseconds, TimerCallback callback, void *context = nullptr);
+
+	/// <summary>
+	/// Cancels a timer, can be called from inside its own callback
+	/// </summary>
+	/// <returns name="cancelled">False if the timer already expired or was cancelled</returns>
+	static bool Cancel(TimerHandle &handle);
+
+	static bool IsActive(const TimerHandle handle);
+
+	/// <summary>
+	/// Advances both wheels and runs the expired callbacks, call once per tick
+	/// </summary>
+	/// <returns name="fired">The number of callbacks run</returns>
+	static size_t Tick();
+
+	/// <summary>
+	/// Grows the node pool so this many timers can be scheduled without allocating
+	/// </summary>
+	static void Reserve(const size_t timers);
+
+	/// <summary>
+	/// Cancels every timer
+	/// </summary>
+	static void Clear();
+
+	static uint64_t GetTick();
+	static size_t GetCount();
+};
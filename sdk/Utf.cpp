@@ -0,0 +1,304 @@
+/**
+File:
+	Utf.cpp
+*/
+
+#include "../stdafx.h"
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTF_SSE2
+#endif
+
+static_assert(sizeof(wchar_t) == 2 || sizeof(wchar_t) == 4, "unsupported wchar_t size");
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	const char32_t Replacement = 0xFFFD;
+
+	unsigned int CountTrailingZeros(const unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	// Number of leading ASCII bytes in input
+	size_t AsciiPrefix(const char *input, const size_t length)
+	{
+		size_t i = 0;
+#ifdef UTF_SSE2
+		for (; i + 16 <= length; i += 16)
+		{
+			const int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(input + i)));
+			if (mask)
+				return i + CountTrailingZeros((unsigned int)mask);
+		}
+#endif
+		while (i < length && (uint8_t)input[i] < 0x80)
+			i++;
+		return i;
+	}
+
+	// Widens an ASCII run, 16 bytes at a time
+	template <typename Unit>
+	void WidenAscii(const char *input, const size_t length, Unit *output)
+	{
+		size_t i = 0;
+#ifdef UTF_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= length; i += 16)
+		{
+			const __m128i bytes = _mm_loadu_si128((const __m128i *)(input + i));
+			const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+			const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+			if (sizeof(Unit) == 2)
+			{
+				_mm_storeu_si128((__m128i *)(output + i), low);
+				_mm_storeu_si128((__m128i *)(output + i + 8), high);
+			}
+			else
+			{
+				_mm_storeu_si128((__m128i *)(output + i), _mm_unpacklo_epi16(low, zero));
+				_mm_storeu_si128((__m128i *)(output + i + 4), _mm_unpackhi_epi16(low, zero));
+				_mm_storeu_si128((__m128i *)(output + i + 8), _mm_unpacklo_epi16(high, zero));
+				_mm_storeu_si128((__m128i *)(output + i + 12), _mm_unpackhi_epi16(high, zero));
+			}
+		}
+#endif
+		for (; i < length; i++)
+			output[i] = (Unit)(uint8_t)input[i];
+	}
+
+	// Decodes one non-ASCII sequence, returns its length or 0 if it is invalid
+	size_t DecodeSequence(const uint8_t *s, const size_t available, char32_t &codepoint)
+	{
+		const uint8_t lead = s[0];
+		if (lead >= 0xC2 && lead <= 0xDF)
+		{
+			if (available < 2 || (s[1] & 0xC0) != 0x80)
+				return 0;
+			codepoint = ((lead & 0x1F) << 6) | (s[1] & 0x3F);
+			return 2;
+		}
+
+		if (lead >= 0xE0 && lead <= 0xEF)
+		{
+			if (available < 3 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80)
+				return 0;
+			codepoint = ((lead & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+			// Overlong encodings and surrogates
+			if (codepoint < 0x800 || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+				return 0;
+			return 3;
+		}
+
+		if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			if (available < 4 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 || (s[3] & 0xC0) != 0x80)
+				return 0;
+			codepoint = ((lead & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+			if (codepoint < 0x10000 || codepoint > 0x10FFFF)
+				return 0;
+			return 4;
+		}
+		return 0;
+	}
+
+	size_t EncodeUtf8(const char32_t codepoint, char *output)
+	{
+		if (codepoint < 0x80)
+		{
+			output[0] = (char)codepoint;
+			return 1;
+		}
+		if (codepoint < 0x800)
+		{
+			output[0] = (char)(0xC0 | (codepoint >> 6));
+			output[1] = (char)(0x80 | (codepoint & 0x3F));
+			return 2;
+		}
+		if (codepoint < 0x10000)
+		{
+			output[0] = (char)(0xE0 | (codepoint >> 12));
+			output[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+			output[2] = (char)(0x80 | (codepoint & 0x3F));
+			return 3;
+		}
+		output[0] = (char)(0xF0 | (codepoint >> 18));
+		output[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+		output[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		output[3] = (char)(0x80 | (codepoint & 0x3F));
+		return 4;
+	}
+
+	size_t EncodeUnits(const char32_t codepoint, char16_t *output)
+	{
+		if (codepoint < 0x10000)
+		{
+			output[0] = (char16_t)codepoint;
+			return 1;
+		}
+		output[0] = (char16_t)(0xD800 + ((codepoint - 0x10000) >> 10));
+		output[1] = (char16_t)(0xDC00 + ((codepoint - 0x10000) & 0x3FF));
+		return 2;
+	}
+
+	size_t EncodeUnits(const char32_t codepoint, char32_t *output)
+	{
+		output[0] = codepoint;
+		return 1;
+	}
+
+	// Shared UTF-8 decoder, strict mode fails on the first invalid sequence
+	template <typename Unit>
+	ptrdiff_t DecodeUtf8(const char *input, const size_t length, Unit *output, const bool strict)
+	{
+		size_t in = 0;
+		size_t out = 0;
+		while (in < length)
+		{
+			const size_t ascii = AsciiPrefix(input + in, length - in);
+			WidenAscii(input + in, ascii, output + out);
+			in += ascii;
+			out += ascii;
+
+			// Handle the non-ASCII run until the next ASCII byte
+			while (in < length && (uint8_t)input[in] >= 0x80)
+			{
+				char32_t codepoint;
+				size_t size = DecodeSequence((const uint8_t *)input + in, length - in, codepoint);
+				if (!size)
+				{
+					if (strict)
+						return -1;
+					codepoint = Replacement;
+					size = 1;
+				}
+				in += size;
+				out += EncodeUnits(codepoint, output + out);
+			}
+		}
+		return (ptrdiff_t)out;
+	}
+
+	// Shared UTF-16 / UTF-32 encoder, strict mode fails on the first invalid unit
+	template <typename Unit>
+	ptrdiff_t EncodeUtf8(const Unit *input, const size_t length, char *output, const bool strict)
+	{
+		size_t in = 0;
+		size_t out = 0;
+		while (in < length)
+		{
+#ifdef UTF_SSE2
+			// Narrow 8 (UTF-16) or 4 (UTF-32) ASCII units at a time
+			const size_t lanes = 16 / sizeof(Unit);
+			while (in + lanes <= length)
+			{
+				const __m128i units = _mm_loadu_si128((const __m128i *)(input + in));
+				const __m128i high = sizeof(Unit) == 2 ? _mm_srli_epi16(units, 7) : _mm_srli_epi32(units, 7);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xFFFF)
+					break;
+
+				const __m128i packed = sizeof(Unit) == 2 ? _mm_packus_epi16(units, units) : _mm_packus_epi16(_mm_packs_epi32(units, units), units);
+				if (sizeof(Unit) == 2)
+					_mm_storel_epi64((__m128i *)(output + out), packed);
+				else
+				{
+					const int word = _mm_cvtsi128_si32(packed);
+					memcpy(output + out, &word, 4);
+				}
+				in += lanes;
+				out += lanes;
+			}
+			if (in >= length)
+				break;
+#endif
+			char32_t codepoint = (char32_t)input[in++];
+			if (sizeof(Unit) == 2 && codepoint >= 0xD800 && codepoint <= 0xDFFF)
+			{
+				const bool paired = codepoint <= 0xDBFF && in < length && input[in] >= 0xDC00 && input[in] <= 0xDFFF;
+				if (paired)
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + ((char32_t)input[in++] - 0xDC00);
+				else if (strict)
+					return -1;
+				else
+					codepoint = Replacement;
+			}
+			else if (codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+			{
+				if (strict)
+					return -1;
+				codepoint = Replacement;
+			}
+			out += EncodeUtf8(codepoint, output + out);
+		}
+		return (ptrdiff_t)out;
+	}
+
+	// wchar_t is UTF-16 on Windows and UTF-32 everywhere else
+	typedef std::conditional<sizeof(wchar_t) == 2, char16_t, char32_t>::type WideUnit;
+}
+
+ptrdiff_t Utf::Utf8ToUtf16(const char *input, const size_t length, char16_t *output)
+{
+	return DecodeUtf8(input, length, output, true);
+}
+
+ptrdiff_t Utf::Utf8ToUtf32(const char *input, const size_t length, char32_t *output)
+{
+	return DecodeUtf8(input, length, output, true);
+}
+
+ptrdiff_t Utf::Utf16ToUtf8(const char16_t *input, const size_t length, char *output)
+{
+	return EncodeUtf8(input, length, output, true);
+}
+
+ptrdiff_t Utf::Utf32ToUtf8(const char32_t *input, const size_t length, char *output)
+{
+	return EncodeUtf8(input, length, output, true);
+}
+
+bool Utf::IsValidUtf8(const char *input, const size_t length)
+{
+	size_t in = 0;
+	while (in < length)
+	{
+		in += AsciiPrefix(input + in, length - in);
+		while (in < length && (uint8_t)input[in] >= 0x80)
+		{
+			char32_t codepoint;
+			const size_t size = DecodeSequence((const uint8_t *)input + in, length - in, codepoint);
+			if (!size)
+				return false;
+			in += size;
+		}
+	}
+	return true;
+}
+
+std::wstring Utf::ToWide(const std::string_view text)
+{
+	// A UTF-8 input never produces more code units than it has bytes
+	std::wstring result(text.size(), L'\0');
+	const ptrdiff_t written = DecodeUtf8(text.data(), text.size(), (WideUnit *)&result[0], false);
+	result.resize((size_t)written);
+	return result;
+}
+
+std::string Utf::ToUtf8(const std::wstring_view text)
+{
+	std::string result(text.size() * (sizeof(wchar_t) == 2 ? 3 : 4), '\0');
+	const ptrdiff_t written = EncodeUtf8((const WideUnit *)text.data(), text.size(), &result[0], false);
+	result.resize((size_t)written);
+	return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/// <summary>
+/// Validating UTF-8 / UTF-16 / UTF-32 transcoding.
+/// ASCII runs are converted 16 bytes at a time with SSE2 where available.
+/// The Wide helpers pick UTF-16 or UTF-32 depending on the size of wchar_t,
+/// so the narrow (UTF-8) and wide halves of the API can be mixed on every platform.
+/// </summary>
+namespace Utf
+{
+	/// <summary>
+	/// Converts UTF-8 to UTF-16
+	/// </summary>
+	/// <param name="input">The UTF-8 input</param>
+	/// <param name="length">The number of bytes in input</param>
+	/// <param name="output">Receives the code units, needs room for length units</param>
+	/// <returns name="written">The number of code units written, or -1 if the input is not valid UTF-8</returns>
+	ptrdiff_t Utf8ToUtf16(const char *input, const size_t length, char16_t *output);
+
+	/// <summary>
+	/// Converts UTF-8 to UTF-32
+	/// </summary>
+	/// <param name="output">Receives the code points, needs room for length code points</param>
+	/// <returns name="written">The number of code points written, or -1 if the input is not valid UTF-8</returns>
+	ptrdiff_t Utf8ToUtf32(const char *input, const size_t length, char32_t *output);
+
+	/// <summary>
+	/// Converts UTF-16 to UTF-8
+	/// </summary>
+	/// <param name="output">Receives the bytes, needs room for length * 3 bytes</param>
+	/// <returns name="written">The number of bytes written, or -1 if the input has unpaired surrogates</returns>
+	ptrdiff_t Utf16ToUtf8(const char16_t *input, const size_t length, char *output);
+
+	/// <summary>
+	/// Converts UTF-32 to UTF-8
+	/// </summary>
+	/// <param name="output">Receives the bytes, needs room for length * 4 bytes</param>
+	/// <returns name="written">The number of bytes written, or -1 if the input has invalid code points</returns>
+	ptrdiff_t Utf32ToUtf8(const char32_t *input, const size_t length, char *output);
+
+	/// <summary>
+	/// Checks if the input is valid UTF-8
+	/// </summary>
+	bool IsValidUtf8(const char *input, const size_t length);
+
+	/// <summary>
+	/// Converts UTF-8 to a wide string, invalid sequences are replaced with U+FFFD
+	/// </summary>
+	std::wstring ToWide(const std::string_view text);
+
+	/// <summary>
+	/// Converts a wide string to UTF-8, invalid code units are replaced with U+FFFD
+	/// </summary>
+	std::string ToUtf8(const std::wstring_view text);
+}
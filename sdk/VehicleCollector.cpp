@@ -0,0 +1,227 @@
+/**
+File:
+	VehicleCollector.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <unordered_map>
+
+namespace
+{
+	const uint8_t FlagPinned = 1;
+
+	struct CollectorState
+	{
+		VehicleCollectorConfig Config;
+		VehicleCollectorStats Stats;
+		uint32_t Tick = 0;
+		size_t Cursor = 0;
+		size_t PlayerCursor = 0;
+
+		// Tracked vehicles, kept packed so a slice is a linear walk
+		std::vector<int> Entities;
+		std::vector<uint32_t> LastTouched;
+		std::vector<CVector3> LastPosition;
+		std::vector<uint8_t> Flags;
+		std::unordered_map<int, size_t> Slots;
+
+		// Players and their last read positions, in the same order
+		std::vector<int> Players;
+		std::vector<CVector3> PlayerPositions;
+	};
+
+	CollectorState &State()
+	{
+		static CollectorState state;
+		return state;
+	}
+
+	float DistanceSquared(const CVector3 &a, const CVector3 &b)
+	{
+		const float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+		return x * x + y * y + z * z;
+	}
+
+	// Removes a slot by moving the last vehicle into it
+	void RemoveSlot(CollectorState &state, const size_t slot)
+	{
+		const size_t last = state.Entities.size() - 1;
+		state.Slots.erase(state.Entities[slot]);
+		if (slot != last)
+		{
+			state.Entities[slot] = state.Entities[last];
+			state.LastTouched[slot] = state.LastTouched[last];
+			state.LastPosition[slot] = state.LastPosition[last];
+			state.Flags[slot] = state.Flags[last];
+			state.Slots[state.Entities[slot]] = slot;
+		}
+
+		state.Entities.pop_back();
+		state.LastTouched.pop_back();
+		state.LastPosition.pop_back();
+		state.Flags.pop_back();
+	}
+}
+
+void VehicleCollector::Configure(const VehicleCollectorConfig &config)
+{
+	State().Config = config;
+}
+
+const VehicleCollectorConfig &VehicleCollector::GetConfig()
+{
+	return State().Config;
+}
+
+void VehicleCollector::Track(const int entity)
+{
+	CollectorState &state = State();
+	if (!state.Slots.emplace(entity, state.Entities.size()).second)
+	{
+		Touch(entity);
+		return;
+	}
+
+	state.Entities.push_back(entity);
+	state.LastTouched.push_back(state.Tick);
+	// Unknown until the first examination, which then never counts as movement
+	state.LastPosition.push_back(CVector3(std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::quiet_NaN()));
+	state.Flags.push_back(0);
+}
+
+void VehicleCollector::Untrack(const int entity)
+{
+	CollectorState &state = State();
+	std::unordered_map<int, size_t>::iterator it = state.Slots.find(entity);
+	if (it != state.Slots.end())
+		RemoveSlot(state, it->second);
+}
+
+void VehicleCollector::Touch(const int entity)
+{
+	CollectorState &state = State();
+	std::unordered_map<int, size_t>::iterator it = state.Slots.find(entity);
+	if (it != state.Slots.end())
+		state.LastTouched[it->second] = state.Tick;
+}
+
+void VehicleCollector::Pin(const int entity, const bool pinned)
+{
+	CollectorState &state = State();
+	std::unordered_map<int, size_t>::iterator it = state.Slots.find(entity);
+	if (it == state.Slots.end())
+		return;
+
+	if (pinned)
+		state.Flags[it->second] |= FlagPinned;
+	else
+	{
+		state.Flags[it->second] &= ~FlagPinned;
+		state.LastTouched[it->second] = state.Tick;
+	}
+}
+
+void VehicleCollector::AddPlayer(const int entity)
+{
+	CollectorState &state = State();
+	if (std::find(state.Players.begin(), state.Players.end(), entity) != state.Players.end())
+		return;
+
+	// Read right away, a player without a position would not keep the vehicles around it alive
+	state.Players.push_back(entity);
+	state.PlayerPositions.push_back(API::Entity::GetPosition(entity));
+}
+
+void VehicleCollector::RemovePlayer(const int entity)
+{
+	CollectorState &state = State();
+	std::vector<int>::iterator it = std::find(state.Players.begin(), state.Players.end(), entity);
+	if (it != state.Players.end())
+	{
+		const size_t slot = it - state.Players.begin();
+		*it = state.Players.back();
+		state.Players.pop_back();
+		state.PlayerPositions[slot] = state.PlayerPositions.back();
+		state.PlayerPositions.pop_back();
+	}
+}
+
+size_t VehicleCollector::Tick()
+{
+	CollectorState &state = State();
+	const VehicleCollectorConfig &config = state.Config;
+	state.Tick++;
+
+	// A slice of the player positions is refreshed, shared by every vehicle examined this tick
+	const size_t playerReads = std::min<size_t>(state.Players.size(), config.PlayerBudget);
+	for (size_t i = 0; i < playerReads; i++)
+	{
+		if (state.PlayerCursor >= state.Players.size())
+			state.PlayerCursor = 0;
+		state.PlayerPositions[state.PlayerCursor] = API::Entity::GetPosition(state.Players[state.PlayerCursor]);
+		state.PlayerCursor++;
+	}
+	uint32_t calls = 0;
+
+	const float playerDistance = config.PlayerDistance * config.PlayerDistance;
+	const float moveDistance = config.MoveDistance * config.MoveDistance;
+	size_t collected = 0;
+	size_t remaining = state.Entities.size();
+
+	while (remaining > 0 && calls < config.CallBudget)
+	{
+		if (state.Cursor >= state.Entities.size())
+			state.Cursor = 0;
+
+		const size_t slot = state.Cursor;
+		remaining--;
+
+		// Pinned vehicles cost no server call, skip them without reading the position
+		if (state.Flags[slot] & FlagPinned)
+		{
+			state.Cursor++;
+			continue;
+		}
+
+		const CVector3 position = API::Entity::GetPosition(state.Entities[slot]);
+		calls++;
+		state.Stats.Examined++;
+
+		bool used = DistanceSquared(position, state.LastPosition[slot]) > moveDistance;
+		for (size_t i = 0; !used && i < state.PlayerPositions.size(); i++)
+			used = DistanceSquared(position, state.PlayerPositions[i]) < playerDistance;
+		state.LastPosition[slot] = position;
+
+		if (used)
+			state.LastTouched[slot] = state.Tick;
+		else if (state.Tick - state.LastTouched[slot] >= config.IdleTicks && collected < config.DestroyBudget
+			&& calls < config.CallBudget && !EntityManager::IsOwned(state.Entities[slot]) && !EntityPool::IsActive(state.Entities[slot]))
+		{
+			const int entity = state.Entities[slot];
+			PlateIndex::Remove(entity);
+			API::Entity::Destroy(entity);
+			calls++;
+			collected++;
+
+			// The last vehicle moves into this slot, examine it next without advancing
+			RemoveSlot(state, slot);
+			continue;
+		}
+		state.Cursor++;
+	}
+
+	state.Stats.Collected += collected;
+	state.Stats.Tracked = state.Entities.size();
+	state.Stats.Players = state.Players.size();
+	state.Stats.LastCalls = calls;
+	state.Stats.LastPlayerReads = (uint32_t)playerReads;
+
+	state.Stats.SweepTicks = config.CallBudget ? (uint32_t)((state.Entities.size() + config.CallBudget - 1) / config.CallBudget) : 0;
+	return collected;
+}
+
+VehicleCollectorStats VehicleCollector::GetStats()
+{
+	return State().Stats;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+struct VehicleCollectorConfig
+{
+	// Vehicles are collected after this many ticks without interaction
+	uint32_t IdleTicks = 18000;
+	// Vehicles closer than this to a player are never collected and count as interacted with
+	float PlayerDistance = 150.0f;
+	// Vehicles that moved further than this since they were last examined count as interacted with
+	float MoveDistance = 1.0f;
+	// Maximum number of vehicle server calls (position reads and destroys) per tick
+	uint32_t CallBudget = 128;
+	// Maximum number of player position reads per tick, the other players keep their last read position
+	uint32_t PlayerBudget = 32;
+	// Maximum number of vehicles destroyed per tick
+	uint32_t DestroyBudget = 4;
+};
+
+struct VehicleCollectorStats
+{
+	uint64_t Examined = 0;
+	uint64_t Collected = 0;
+	size_t Tracked = 0;
+	size_t Players = 0;
+	// Vehicle server calls made by the last Tick
+	uint32_t LastCalls = 0;
+	// Player position reads made by the last Tick
+	uint32_t LastPlayerReads = 0;
+	// Ticks needed to examine every tracked vehicle once
+	uint32_t SweepTicks = 0;
+};
+
+/// <summary>
+/// Destroys tracked vehicles that nobody used for a while.
+/// Every tick a slice of the tracked vehicles and a slice of the player positions are examined round robin under
+/// their own call budgets, so the cost per tick stays flat no matter how many vehicles and players there are.
+/// Only vehicles passed to Track (or Vehicle::Track) are collected, nothing is tracked automatically.
+/// Vehicles that are pinned, owned by a handle or acquired from the EntityPool are never collected. Tick thread only.
+/// </summary>
+class VehicleCollector
+{
+public:
+	static void Configure(const VehicleCollectorConfig &config);
+	static const VehicleCollectorConfig &GetConfig();
+
+	/// <summary>
+	/// Starts tracking a vehicle, it counts as interacted with now.
+	/// The vehicle is destroyed once abandoned, so only track vehicles no other code keeps the id of.
+	/// </summary>
+	/// <param name="entity">The vehicle entity</param>
+	static void Track(const int entity);
+
+	/// <summary>
+	/// Stops tracking a vehicle without destroying it
+	/// </summary>
+	static void Untrack(const int entity);
+
+	/// <summary>
+	/// Marks a vehicle as interacted with (entered, repaired, locked, ...)
+	/// </summary>
+	static void Touch(const int entity);
+
+	/// <summary>
+	/// Pins or unpins a vehicle, pinned vehicles are never collected
+	/// </summary>
+	static void Pin(const int entity, const bool pinned);
+
+	/// <summary>
+	/// Adds a player whose position keeps nearby vehicles alive
+	/// </summary>
+	static void AddPlayer(const int entity);
+
+	/// <summary>
+	/// Removes a player, call when the player disconnects
+	/// </summary>
+	static void RemovePlayer(const int entity);
+
+	/// <summary>
+	/// Reads the player positions and examines the next slice of vehicles, call once per tick
+	/// </summary>
+	/// <returns name="collected">The number of vehicles destroyed</returns>
+	static size_t Tick();
+
+	static VehicleCollectorStats GetStats();
+};
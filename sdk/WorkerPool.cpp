@@ -0,0 +1,296 @@
+/**
+File:
+	WorkerPool.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	struct Job
+	{
+		std::atomic<Job *> Next;
+		WorkerJob Work;
+		WorkerJob Complete;
+		void *Context;
+		uint64_t Submitted;
+	};
+
+	// Intrusive multi producer, single consumer queue (Vyukov). Workers push finished jobs, the tick thread pops.
+	class CompletionQueue
+	{
+	private:
+		std::atomic<Job *> Head;
+		Job *Tail;
+		Job Stub;
+
+	public:
+		CompletionQueue()
+		{
+			Stub.Next.store(nullptr, std::memory_order_relaxed);
+			Head.store(&Stub, std::memory_order_relaxed);
+			Tail = &Stub;
+		}
+
+		void Push(Job *job)
+		{
+			job->Next.store(nullptr, std::memory_order_relaxed);
+			Job *previous = Head.exchange(job, std::memory_order_acq_rel);
+			previous->Next.store(job, std::memory_order_release);
+		}
+
+		// Returns nullptr when empty, or when a push is half done (it shows up on the next call)
+		Job *Pop()
+		{
+			Job *tail = Tail;
+			Job *next = tail->Next.load(std::memory_order_acquire);
+			if (tail == &Stub)
+			{
+				if (!next)
+					return nullptr;
+				Tail = next;
+				tail = next;
+				next = next->Next.load(std::memory_order_acquire);
+			}
+
+			if (next)
+			{
+				Tail = next;
+				return tail;
+			}
+
+			if (tail != Head.load(std::memory_order_acquire))
+				return nullptr;
+
+			Push(&Stub);
+			next = tail->Next.load(std::memory_order_acquire);
+			if (next)
+			{
+				Tail = next;
+				return tail;
+			}
+			return nullptr;
+		}
+	};
+
+	struct PoolState
+	{
+		std::vector<std::thread> Workers;
+		std::mutex Mutex;
+		std::condition_variable Wake;
+		std::deque<Job *> Queue;
+		bool Stopping = false;
+		// Set by Stop until the next Start, jobs submitted meanwhile run on the tick thread instead of restarting the workers
+		bool Stopped = false;
+
+		CompletionQueue Completions;
+		std::atomic<size_t> Running{ 0 };
+		std::atomic<size_t> Finished{ 0 };
+		std::atomic<uint64_t> BusyNanoseconds{ 0 };
+
+		// Tick thread only
+		std::vector<std::unique_ptr<Job>> Jobs;
+		std::vector<Job *> FreeJobs;
+		uint64_t Completed = 0;
+		uint64_t LatencyTotal = 0;
+		uint64_t LatencyMax = 0;
+		uint64_t StatsSince = 0;
+
+		// Workers still running at exit are stopped without running their completions
+		~PoolState()
+		{
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+				Stopping = true;
+			}
+			Wake.notify_all();
+			for (size_t i = 0; i < Workers.size(); i++)
+				Workers[i].join();
+		}
+	};
+
+	PoolState &State()
+	{
+		static PoolState state;
+		return state;
+	}
+
+	uint64_t Nanoseconds()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void WorkerLoop(PoolState *state)
+	{
+		for (;;)
+		{
+			Job *job;
+			{
+				std::unique_lock<std::mutex> lock(state->Mutex);
+				state->Wake.wait(lock, [state] { return state->Stopping || !state->Queue.empty(); });
+
+				// Stop only once the queue is empty, so every submitted job gets its completion
+				if (state->Queue.empty())
+					return;
+				job = state->Queue.front();
+				state->Queue.pop_front();
+				state->Running.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			const uint64_t start = Nanoseconds();
+			job->Work(job->Context);
+			state->BusyNanoseconds.fetch_add(Nanoseconds() - start, std::memory_order_relaxed);
+
+			state->Running.fetch_sub(1, std::memory_order_relaxed);
+			state->Finished.fetch_add(1, std::memory_order_relaxed);
+			state->Completions.Push(job);
+		}
+	}
+}
+
+void WorkerPool::Start(const size_t workers)
+{
+	PoolState &state = State();
+	if (!state.Workers.empty())
+		return;
+
+	size_t count = workers;
+	if (count == 0)
+	{
+		const size_t hardware = std::thread::hardware_concurrency();
+		count = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	state.Stopping = false;
+	state.Stopped = false;
+	state.StatsSince = Nanoseconds();
+	state.BusyNanoseconds.store(0, std::memory_order_relaxed);
+	for (size_t i = 0; i < count; i++)
+		state.Workers.emplace_back(WorkerLoop, &state);
+}
+
+void WorkerPool::Stop()
+{
+	PoolState &state = State();
+	state.Stopped = true;
+	if (state.Workers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		state.Stopping = true;
+	}
+	state.Wake.notify_all();
+	for (size_t i = 0; i < state.Workers.size(); i++)
+		state.Workers[i].join();
+	state.Workers.clear();
+
+	Drain();
+}
+
+void WorkerPool::Submit(WorkerJob work, WorkerJob complete, void *context)
+{
+	PoolState &state = State();
+	if (!work)
+		return;
+	if (state.Workers.empty())
+	{
+		// E.g. a completion run by Stop that submits a follow-up job, no threads may outlive the plugin
+		if (state.Stopped)
+		{
+			work(context);
+			if (complete)
+				complete(context);
+			return;
+		}
+		Start();
+	}
+
+	Job *job;
+	if (!state.FreeJobs.empty())
+	{
+		job = state.FreeJobs.back();
+		state.FreeJobs.pop_back();
+	}
+	else
+	{
+		state.Jobs.emplace_back(new Job());
+		job = state.Jobs.back().get();
+	}
+
+	job->Work = work;
+	job->Complete = complete;
+	job->Context = context;
+	job->Submitted = Nanoseconds();
+
+	{
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		state.Queue.push_back(job);
+	}
+	state.Wake.notify_one();
+}
+
+size_t WorkerPool::Drain()
+{
+	PoolState &state = State();
+	size_t completed = 0;
+	while (Job *job = state.Completions.Pop())
+	{
+		state.Finished.fetch_sub(1, std::memory_order_relaxed);
+		if (job->Complete)
+			job->Complete(job->Context);
+
+		const uint64_t latency = (Nanoseconds() - job->Submitted) / 1000;
+		state.LatencyTotal += latency;
+		if (latency > state.LatencyMax)
+			state.LatencyMax = latency;
+
+		state.FreeJobs.push_back(job);
+		completed++;
+	}
+
+	state.Completed += completed;
+	return completed;
+}
+
+bool WorkerPool::IsRunning()
+{
+	return !State().Workers.empty();
+}
+
+WorkerPoolStats WorkerPool::GetStats()
+{
+	PoolState &state = State();
+	WorkerPoolStats stats;
+	stats.Workers = state.Workers.size();
+	{
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		stats.Queued = state.Queue.size();
+	}
+	stats.Running = state.Running.load(std::memory_order_relaxed);
+	stats.PendingCompletions = state.Finished.load(std::memory_order_relaxed);
+	stats.Completed = state.Completed;
+	stats.AverageLatencyMicroseconds = state.Completed ? (double)state.LatencyTotal / (double)state.Completed : 0.0;
+	stats.MaxLatencyMicroseconds = state.LatencyMax;
+
+	const uint64_t wall = (Nanoseconds() - state.StatsSince) * (uint64_t)stats.Workers;
+	stats.Utilization = wall ? (double)state.BusyNanoseconds.load(std::memory_order_relaxed) / (double)wall : 0.0;
+	return stats;
+}
+
+void WorkerPool::ResetStats()
+{
+	PoolState &state = State();
+	state.Completed = 0;
+	state.LatencyTotal = 0;
+	state.LatencyMax = 0;
+	state.StatsSince = Nanoseconds();
+	state.BusyNanoseconds.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+typedef void (*WorkerJob)(void *context);
+
+struct WorkerPoolStats
+{
+	size_t Workers = 0;
+	// Jobs waiting for a worker
+	size_t Queued = 0;
+	// Jobs being run by a worker
+	size_t Running = 0;
+	// Finished jobs whose completion has not been run on the tick thread yet
+	size_t PendingCompletions = 0;
+	uint64_t Completed = 0;
+	// Time from Submit to the completion running on the tick thread
+	double AverageLatencyMicroseconds = 0.0;
+	uint64_t MaxLatencyMicroseconds = 0;
+	// Share of the worker time spent running jobs since the last ResetStats (0..1)
+	double Utilization = 0.0;
+};
+
+/// <summary>
+/// Fixed pool of worker threads for plugin compute jobs.
+/// A job's work function runs on a worker, its completion runs on the tick thread when Drain is called
+/// at the start of API_OnTick, so API:: calls stay on the tick thread. Finished jobs are handed back through
+/// a lock-free multi producer, single consumer queue. Submit and Drain are tick thread only.
+/// </summary>
+class WorkerPool
+{
+public:
+	/// <summary>
+	/// Starts the workers, Submit starts them on first use otherwise
+	/// </summary>
+	/// <param name="workers">The number of workers, 0 for one less than the number of hardware threads</param>
+	static void Start(const size_t workers = 0);
+
+	/// <summary>
+	/// Finishes every submitted job, stops the workers and runs the remaining completions. Call from API_Close.
+	/// Until Start is called again, Submit runs jobs and their completions on the calling thread.
+	/// </summary>
+	static void Stop();
+
+	/// <summary>
+	/// Queues a job, starting the workers on first use
+	/// </summary>
+	/// <param name="work">Runs on a worker thread, must not call API:: functions</param>
+	/// <param name="complete">Runs on the tick thread after work, can be nullptr</param>
+	/// <param name="context">Passed to both as is</param>
+	static void Submit(WorkerJob work, WorkerJob complete, void *context);
+
+	/// <summary>
+	/// Runs the completions of finished jobs, call at the start of every tick
+	/// </summary>
+	/// <returns name="completed">The number of completions run</returns>
+	static size_t Drain();
+
+	/// <summary>
+	/// Checks if the workers are started
+	/// </summary>
+	static bool IsRunning();
+
+	static WorkerPoolStats GetStats();
+	static void ResetStats();
+};
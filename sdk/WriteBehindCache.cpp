@@ -0,0 +1,357 @@
+/**
+File:
+	WriteBehindCache.cpp
+*/
+
+#include "../stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const size_t SampleCount = 1024;
+
+	struct Entry
+	{
+		std::vector<uint8_t> Value;
+		// The first change that is not written yet
+		Clock::time_point DirtySince;
+		bool Dirty = false;
+		// Of the entry's current node in DirtyOrder, older nodes of flushed or removed entries are skipped
+		uint64_t Sequence = 0;
+		bool InFlight = false;
+	};
+
+	struct QueuedKey
+	{
+		std::string Key;
+		uint64_t Sequence;
+	};
+
+	struct BatchItem
+	{
+		std::string Key;
+		std::vector<uint8_t> Value;
+		Clock::time_point DirtySince;
+		bool Written;
+	};
+
+	struct Batch
+	{
+		std::vector<BatchItem> Items;
+		uint64_t Microseconds = 0;
+	};
+
+	struct CacheState
+	{
+		std::unordered_map<std::string, Entry> Entries;
+		// Dirty entries by DirtySince, oldest first
+		std::deque<QueuedKey> DirtyOrder;
+		uint64_t NextSequence = 0;
+		// Owned by a worker until its completion ran
+		Batch *Pending = nullptr;
+
+		size_t BatchRecords = 64;
+		size_t BatchBytes = 64 * 1024;
+		uint32_t Delay = 500;
+
+		std::vector<uint64_t> Samples;
+		size_t NextSample = 0;
+		uint64_t BatchTotal = 0;
+		WriteBehindStats Stats;
+	};
+
+	CacheState &State()
+	{
+		static CacheState state;
+		return state;
+	}
+
+	void AddSample(CacheState &state, const Clock::time_point dirtySince)
+	{
+		const uint64_t milliseconds = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - dirtySince).count();
+		if (state.Samples.size() < SampleCount)
+			state.Samples.push_back(milliseconds);
+		else
+			state.Samples[state.NextSample] = milliseconds;
+		state.NextSample = (state.NextSample + 1) % SampleCount;
+	}
+
+	uint64_t Percentile(std::vector<uint64_t> &samples, const size_t percent)
+	{
+		const size_t rank = (samples.size() - 1) * percent / 100;
+		std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+		return samples[rank];
+	}
+
+	// Queues a clean entry, at the front for records older than everything queued
+	void MarkDirty(CacheState &state, const std::string &key, Entry &entry, const Clock::time_point since, const bool front = false)
+	{
+		entry.Dirty = true;
+		entry.DirtySince = since;
+		entry.Sequence = ++state.NextSequence;
+		if (front)
+			state.DirtyOrder.push_front({ key, entry.Sequence });
+		else
+			state.DirtyOrder.push_back({ key, entry.Sequence });
+	}
+
+	bool IsCurrent(const Entry &entry, const QueuedKey &queued)
+	{
+		return entry.Dirty && entry.Sequence == queued.Sequence;
+	}
+
+	void WriteBatch(void *context)
+	{
+		Batch &batch = *(Batch *)context;
+		const Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < batch.Items.size(); i++)
+		{
+			BatchItem &item = batch.Items[i];
+			item.Written = LogStore::Put(item.Key, item.Value.data(), item.Value.size());
+		}
+		batch.Microseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+	}
+
+	void FinishBatch(void *context)
+	{
+		CacheState &state = State();
+		Batch *batch = (Batch *)context;
+		// Backwards, so failed records go back to the front of the queue in their order
+		for (size_t i = batch->Items.size(); i-- > 0;)
+		{
+			const BatchItem &item = batch->Items[i];
+			std::unordered_map<std::string, Entry>::iterator it = state.Entries.find(item.Key);
+			if (it != state.Entries.end())
+				it->second.InFlight = false;
+
+			if (item.Written)
+			{
+				state.Stats.Written++;
+				AddSample(state, item.DirtySince);
+				continue;
+			}
+
+			// Retried first with the next batch, unless a newer change is waiting already. The batch was taken from the
+			// front, so nothing queued is older.
+			state.Stats.Failures++;
+			if (it != state.Entries.end() && !it->second.Dirty)
+				MarkDirty(state, it->first, it->second, item.DirtySince, true);
+		}
+
+		state.Stats.Batches++;
+		state.Stats.LastBatchMicroseconds = batch->Microseconds;
+		state.BatchTotal += batch->Microseconds;
+		state.Pending = nullptr;
+		delete batch;
+	}
+
+	// The batch in flight may hold an older value of a record, it has to land before anything written after it
+	void WaitForBatch(CacheState &state)
+	{
+		while (state.Pending)
+		{
+			if (WorkerPool::Drain() == 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+
+	bool WriteNow(CacheState &state, const std::string &key, Entry &entry)
+	{
+		if (!entry.Dirty)
+			return true;
+		if (!LogStore::Put(key, entry.Value.data(), entry.Value.size()))
+		{
+			state.Stats.Failures++;
+			return false;
+		}
+
+		entry.Dirty = false;
+		state.Stats.Written++;
+		state.Stats.ForcedFlushes++;
+		AddSample(state, entry.DirtySince);
+		return true;
+	}
+}
+
+void WriteBehindCache::Set(const std::string_view key, const void *data, const size_t size)
+{
+	CacheState &state = State();
+	std::unordered_map<std::string, Entry>::iterator it = state.Entries.find(std::string(key));
+	if (it == state.Entries.end())
+		it = state.Entries.emplace(std::string(key), Entry()).first;
+
+	Entry &entry = it->second;
+	entry.Value.assign((const uint8_t *)data, (const uint8_t *)data + size);
+	if (entry.Dirty)
+		state.Stats.Coalesced++;
+	else
+		MarkDirty(state, it->first, entry, Clock::now());
+}
+
+bool WriteBehindCache::Get(const std::string_view key, std::vector<uint8_t> &value)
+{
+	CacheState &state = State();
+	std::unordered_map<std::string, Entry>::const_iterator it = state.Entries.find(std::string(key));
+	if (it != state.Entries.end())
+	{
+		value = it->second.Value;
+		return true;
+	}
+
+	if (!LogStore::Get(key, value))
+		return false;
+	state.Entries[std::string(key)].Value = value;
+	return true;
+}
+
+size_t WriteBehindCache::Tick()
+{
+	CacheState &state = State();
+	if (state.Pending || state.DirtyOrder.empty() || !LogStore::IsOpen())
+		return 0;
+
+	const Clock::time_point now = Clock::now();
+	const Clock::duration delay = std::chrono::milliseconds(state.Delay);
+	std::unique_ptr<Batch> batch(new Batch());
+	size_t bytes = 0;
+	while (!state.DirtyOrder.empty() && batch->Items.size() < state.BatchRecords)
+	{
+		std::unordered_map<std::string, Entry>::iterator it = state.Entries.find(state.DirtyOrder.front().Key);
+		if (it == state.Entries.end() || !IsCurrent(it->second, state.DirtyOrder.front()))
+		{
+			// Flushed, removed or queued again since
+			state.DirtyOrder.pop_front();
+			continue;
+		}
+
+		Entry &entry = it->second;
+		// Oldest first, so the rest is not due either
+		if (now - entry.DirtySince < delay)
+			break;
+		if (!batch->Items.empty() && bytes + entry.Value.size() > state.BatchBytes)
+			break;
+
+		batch->Items.push_back({ it->first, entry.Value, entry.DirtySince, false });
+		bytes += it->first.size() + entry.Value.size();
+		entry.Dirty = false;
+		entry.InFlight = true;
+		state.DirtyOrder.pop_front();
+	}
+
+	const size_t queued = batch->Items.size();
+	if (queued == 0)
+		return 0;
+
+	state.Pending = batch.release();
+	WorkerPool::Submit(WriteBatch, FinishBatch, state.Pending);
+	return queued;
+}
+
+bool WriteBehindCache::Flush(const std::string_view key)
+{
+	CacheState &state = State();
+	std::unordered_map<std::string, Entry>::iterator it = state.Entries.find(std::string(key));
+	if (it == state.Entries.end())
+		return true;
+
+	if (it->second.InFlight)
+	{
+		WaitForBatch(state);
+		// The completions run by the wait may have changed the cache
+		it = state.Entries.find(std::string(key));
+		if (it == state.Entries.end())
+			return true;
+	}
+	return WriteNow(state, it->first, it->second);
+}
+
+bool WriteBehindCache::FlushAll()
+{
+	CacheState &state = State();
+	WaitForBatch(state);
+
+	bool written = true;
+	while (!state.DirtyOrder.empty())
+	{
+		const QueuedKey queued = state.DirtyOrder.front();
+		state.DirtyOrder.pop_front();
+		std::unordered_map<std::string, Entry>::iterator it = state.Entries.find(queued.Key);
+		if (it == state.Entries.end() || !IsCurrent(it->second, queued))
+			continue;
+
+		if (!WriteNow(state, it->first, it->second))
+			written = false;
+	}
+
+	// Failed records go back in line for the next try, oldest first
+	std::vector<std::unordered_map<std::string, Entry>::iterator> failed;
+	for (std::unordered_map<std::string, Entry>::iterator it = state.Entries.begin(); it != state.Entries.end(); ++it)
+	{
+		if (it->second.Dirty)
+			failed.push_back(it);
+	}
+	std::sort(failed.begin(), failed.end(), [](const std::unordered_map<std::string, Entry>::iterator &a, const std::unordered_map<std::string, Entry>::iterator &b)
+	{
+		return a->second.DirtySince < b->second.DirtySince;
+	});
+	for (size_t i = 0; i < failed.size(); i++)
+		MarkDirty(state, failed[i]->first, failed[i]->second, failed[i]->second.DirtySince);
+	return written;
+}
+
+bool WriteBehindCache::Remove(const std::string_view key)
+{
+	if (!Flush(key))
+		return false;
+
+	// The queue skips keys that are gone
+	State().Entries.erase(std::string(key));
+	return true;
+}
+
+void WriteBehindCache::SetBatchLimits(const size_t records, const size_t bytes)
+{
+	CacheState &state = State();
+	state.BatchRecords = records ? records : 1;
+	state.BatchBytes = bytes;
+}
+
+void WriteBehindCache::SetFlushDelay(const uint32_t milliseconds)
+{
+	State().Delay = milliseconds;
+}
+
+WriteBehindStats WriteBehindCache::GetStats()
+{
+	CacheState &state = State();
+	WriteBehindStats stats = state.Stats;
+	stats.Entries = state.Entries.size();
+	for (std::unordered_map<std::string, Entry>::const_iterator it = state.Entries.begin(); it != state.Entries.end(); ++it)
+	{
+		if (it->second.Dirty)
+		{
+			stats.Dirty++;
+			stats.DirtyBytes += it->second.Value.size();
+		}
+		if (it->second.InFlight)
+			stats.InFlight++;
+	}
+	if (stats.Batches)
+		stats.AverageBatchMicroseconds = (double)state.BatchTotal / (double)stats.Batches;
+
+	if (!state.Samples.empty())
+	{
+		std::vector<uint64_t> samples(state.Samples);
+		stats.P50Milliseconds = Percentile(samples, 50);
+		stats.P99Milliseconds = Percentile(samples, 99);
+		stats.MaxMilliseconds = *std::max_element(samples.begin(), samples.end());
+	}
+	return stats;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+struct WriteBehindStats
+{
+	size_t Entries = 0;
+	// Entries with changes not handed to the store yet
+	size_t Dirty = 0;
+	uint64_t DirtyBytes = 0;
+	// Entries in the batch being written
+	size_t InFlight = 0;
+	// Updates folded into a change that was not written yet
+	uint64_t Coalesced = 0;
+	uint64_t Written = 0;
+	uint64_t Batches = 0;
+	uint64_t ForcedFlushes = 0;
+	uint64_t Failures = 0;
+	// Time from the first unwritten change to the write, over the last 1024 writes
+	uint64_t P50Milliseconds = 0;
+	uint64_t P99Milliseconds = 0;
+	uint64_t MaxMilliseconds = 0;
+	uint64_t LastBatchMicroseconds = 0;
+	double AverageBatchMicroseconds = 0.0;
+};
+
+/// <summary>
+/// Write-behind cache in front of the LogStore for player records, e.g. position, appearance and stats per guid.
+/// Set only updates the cached copy and marks it dirty, repeated updates of a dirty record are written once.
+/// Every tick one small batch of the oldest dirty records is written on a WorkerPool thread, so saving never spikes.
+/// Flush writes a record at once, call it when the player leaves. Tick thread only.
+/// </summary>
+class WriteBehindCache
+{
+public:
+	/// <summary>
+	/// Updates a record and marks it dirty
+	/// </summary>
+	static void Set(const std::string_view key, const void *data, const size_t size);
+
+	/// <summary>
+	/// Gets a record from the cache, loading it from the LogStore on a miss
+	/// </summary>
+	/// <returns name="found">False if the record is neither cached nor stored</returns>
+	static bool Get(const std::string_view key, std::vector<uint8_t> &value);
+
+	/// <summary>
+	/// Hands the next batch of dirty records to a worker, call once per tick
+	/// </summary>
+	/// <returns name="queued">The number of records in the batch</returns>
+	static size_t Tick();
+
+	/// <summary>
+	/// Writes a dirty record now on the calling thread, waiting for the batch in flight first
+	/// </summary>
+	/// <returns name="written">False if the write failed, the record stays dirty then</returns>
+	static bool Flush(const std::string_view key);
+
+	/// <summary>
+	/// Writes every dirty record now, call from API_Close before LogStore::Close
+	/// </summary>
+	/// <returns name="written">False if any write failed</returns>
+	static bool FlushAll();
+
+	/// <summary>
+	/// Flushes a record and drops it from the cache, e.g. once its player disconnected
+	/// </summary>
+	static bool Remove(const std::string_view key);
+
+	/// <summary>
+	/// Sets the limits of a batch (64 records and 64 KB by default), a batch holds at least one record
+	/// </summary>
+	static void SetBatchLimits(const size_t records, const size_t bytes);
+
+	/// <summary>
+	/// Sets how long a record stays dirty before it is written (500 by default), to fold more updates into one write
+	/// </summary>
+	static void SetFlushDelay(const uint32_t milliseconds);
+
+	static WriteBehindStats GetStats();
+};
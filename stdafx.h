@@ -8,6 +8,14 @@
 #include <limits>
 #include <stdexcept>
 #include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <coroutine>
 
 #include "api.h"
 
@@ -20,6 +28,22 @@
 
 #include "sdk/CMaths.h"
 #include "sdk/Structs.h"
+#include "sdk/PackedStructs.h"
+
+// Strings
+#include "sdk/StringRef.h"
+#include "sdk/Utf.h"
+
+// Names
+#include "sdk/ModelHash.h"
+#include "sdk/Atom.h"
+
+// Vehicle Bookkeeping
+#include "sdk/PlateIndex.h"
+#include "sdk/VehicleCollector.h"
+
+// Entity Ownership
+#include "sdk/EntityManager.h"
 
 // API Function Imports
 #include "sdk/APICef.h"
@@ -31,4 +55,25 @@
 #include "sdk/APIObject.h"
 #include "sdk/APIPlayer.h"
 #include "sdk/APIServer.h"
-#include "sdk/APIVehicle.h"
\ No newline at end of file
+#include "sdk/APIVehicle.h"
+
+// Plugin Utilities
+#include "sdk/MappedFile.h"
+#include "sdk/MapFile.h"
+#include "sdk/EntityHandle.h"
+#include "sdk/EntityPool.h"
+#include "sdk/EventBus.h"
+#include "sdk/CommandRouter.h"
+#include "sdk/ChatFilter.h"
+#include "sdk/OutboundQueue.h"
+#include "sdk/JoinPipeline.h"
+#include "sdk/ProfileStore.h"
+#include "sdk/LogStore.h"
+#include "sdk/WriteBehindCache.h"
+#include "sdk/TickClock.h"
+#include "sdk/TimerWheel.h"
+#include "sdk/Task.h"
+#include "sdk/WorkerPool.h"
+#include "sdk/Parallel.h"
+#include "sdk/CommandBuffer.h"
+#include "sdk/SystemScheduler.h"
\ No newline at end of file